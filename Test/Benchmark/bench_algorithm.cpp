@@ -0,0 +1,215 @@
+/*
+ * Algorithm benchmarks, build with optimization on, e.g.
+ *   g++ -O2 -std=c++17 bench_algorithm.cpp -o bench_algorithm
+ *   ./bench_algorithm             run everything
+ *   ./bench_algorithm relocate    run one benchmark
+ */
+#include "../../algobase.h"
+#include "../../basic_string.h"
+#include "../../uninitialized.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+namespace bench
+{
+	using clock_type = std::chrono::steady_clock;
+
+	inline double seconds_since(clock_type::time_point start) {
+		return std::chrono::duration<double>(clock_type::now() - start).count();
+	}
+
+	using string_type = tinySTL::basic_string<char>;
+
+	/* what growing a buffer did before: move-construct each element, then destroy the old one */
+	template <typename T>
+	T* relocate_by_move(T* first, T* last, T* result) {
+		return tinySTL::unchecked_uninit_relocate(first, last, result, std::false_type{});
+	}
+
+	bool check_strings(const string_type* p, size_t count) {
+		for (size_t i = 0; i < count; ++i) {
+			if (p[i].size() != (i % 4 ? 5u : 28u))
+				return false;
+		}
+		return true;
+	}
+
+	void relocate() {
+		const size_t count = 10000000;
+		static_assert(tinySTL::is_trivially_relocatable<string_type>::value, "basic_string is relocated with memmove");
+		string_type* a = static_cast<string_type*>(std::malloc(count * sizeof(string_type)));
+		string_type* b = static_cast<string_type*>(std::malloc(count * sizeof(string_type)));
+		for (size_t i = 0; i < count; ++i)
+			::new((void*)(a + i)) string_type(i % 4 ? "short" : "a string that is long enough");
+		/* touch the destination once so neither side pays for the first page faults */
+		std::memset((void*)b, 0, count * sizeof(string_type));
+
+		std::printf("%-24s %10s %10s\n", "10M basic_string", "ms", "GB/s");
+		for (int round = 0; round < 3; ++round) {
+			auto start = clock_type::now();
+			relocate_by_move(a, a + count, b);
+			double move_secs = seconds_since(start);
+			start = clock_type::now();
+			tinySTL::uninitialized_relocate(b, b + count, a);
+			double copy_secs = seconds_since(start);
+			std::printf("%-24s %10.1f %10.2f\n", "move + destroy", move_secs * 1e3,
+				2.0 * count * sizeof(string_type) / move_secs / 1e9);
+			std::printf("%-24s %10.1f %10.2f\n", "uninitialized_relocate", copy_secs * 1e3,
+				2.0 * count * sizeof(string_type) / copy_secs / 1e9);
+		}
+		std::printf("contents %s\n", check_strings(a, count) ? "intact" : "CORRUPTED");
+		tinySTL::destroy(a, a + count);
+		std::free(a);
+		std::free(b);
+	}
+
+	void size_label(char* out, size_t len, size_t bytes) {
+		if (bytes >= ((size_t)1 << 20))
+			std::snprintf(out, len, "%zu MiB", bytes >> 20);
+		else if (bytes >= 1024)
+			std::snprintf(out, len, "%zu KiB", bytes >> 10);
+		else
+			std::snprintf(out, len, "%zu B", bytes);
+	}
+
+	/* the generic element loop fill_n used for every type before the SIMD kernels;
+	   the value has four different bytes so the compiler cannot turn it into memset */
+	template <typename T>
+	void fill_by_loop(T* first, size_t n, const T& value) {
+		for (; n > 0; --n, ++first)
+			*first = value;
+	}
+
+	/* bytes filled per second, repeating until about 2 GB have been written */
+	template <typename Fill>
+	double fill_rate(uint32_t* p, size_t n, Fill fill) {
+		size_t bytes = n * sizeof(uint32_t);
+		size_t rounds = bytes >= ((size_t)2 << 30) ? 1 : ((size_t)2 << 30) / bytes;
+		fill(p, n); // warm up: page faults and the first touch of the cache
+		auto start = clock_type::now();
+		for (size_t r = 0; r < rounds; ++r)
+			fill(p, n);
+		return (double)bytes * rounds / seconds_since(start) / 1e9;
+	}
+
+	void fill() {
+		const size_t max_bytes = (size_t)1 << 30;
+		uint32_t* p = static_cast<uint32_t*>(std::malloc(max_bytes));
+		const size_t saved = tinySTL::Simd::getNonTemporalThreshold();
+		std::printf("non-temporal stores above %zu KiB\n", saved >> 10);
+		std::printf("%-10s %10s %10s %10s %10s %10s\n", "uint32 GB/s", "loop", "sse2", "avx2", "avx512", "no nt");
+		for (size_t bytes = 64; bytes <= max_bytes; bytes *= 16) {
+			size_t n = bytes / sizeof(uint32_t);
+			double rates[5];
+			rates[0] = fill_rate(p, n, [](uint32_t* q, size_t k) { fill_by_loop(q, k, 0x01234567u); });
+			for (int level = tinySTL::SIMDSSE2; level <= tinySTL::SIMDAVX512; ++level) {
+				tinySTL::Simd::setLevel(level);
+				rates[level] = fill_rate(p, n, [](uint32_t* q, size_t k) { tinySTL::fill_n(q, k, 0x01234567u); });
+			}
+			tinySTL::Simd::setNonTemporalThreshold((size_t)-1);
+			rates[4] = fill_rate(p, n, [](uint32_t* q, size_t k) { tinySTL::fill_n(q, k, 0x01234567u); });
+			tinySTL::Simd::setNonTemporalThreshold(saved);
+			char label[32];
+			size_label(label, sizeof(label), bytes);
+			std::printf("%-10s %10.2f %10.2f %10.2f %10.2f %10.2f\n", label, rates[0], rates[1], rates[2], rates[3], rates[4]);
+		}
+		std::printf("contents %s\n", p[max_bytes / sizeof(uint32_t) - 1] == 0x01234567u ? "intact" : "CORRUPTED");
+		std::free(p);
+	}
+
+	/* the element loops equal, mismatch and lexicographical_compare ran before the SIMD kernels */
+	template <typename T>
+	size_t mismatch_by_loop(const T* a, const T* b, size_t n) {
+		size_t i = 0;
+		while (i < n && a[i] == b[i])
+			++i;
+		return i;
+	}
+
+	template <typename T>
+	bool less_by_loop(const T* a, const T* b, size_t n) {
+		for (size_t i = 0; i < n; ++i) {
+			if (a[i] < b[i])
+				return true;
+			if (b[i] < a[i])
+				return false;
+		}
+		return false;
+	}
+
+	/* bytes of one range scanned per second, repeating until about 2 GB have been compared */
+	template <typename Scan>
+	double scan_rate(size_t bytes, Scan scan) {
+		size_t rounds = ((size_t)2 << 30) / bytes;
+		size_t sink = scan();
+		auto start = clock_type::now();
+		for (size_t r = 0; r < rounds; ++r)
+			sink += scan();
+		double rate = (double)bytes * rounds / seconds_since(start) / 1e9;
+		if (sink == 1) // keeps the scans from being optimized away
+			std::printf("?");
+		return rate;
+	}
+
+	/* two equal key arrays that first differ in the last element, so every scan reads both to the end */
+	template <typename T>
+	void compare_table(const char* title, size_t max_bytes) {
+		size_t max_n = max_bytes / sizeof(T);
+		T* a = static_cast<T*>(std::malloc(max_bytes));
+		T* b = static_cast<T*>(std::malloc(max_bytes));
+		for (size_t i = 0; i < max_n; ++i)
+			a[i] = b[i] = static_cast<T>(i * 2654435761u);
+		std::printf("%-12s %10s %10s %10s %10s\n", title, "loop", "sse2", "avx2", "avx512");
+		for (size_t bytes = 64; bytes <= max_bytes; bytes *= 16) {
+			size_t n = bytes / sizeof(T);
+			b[n - 1] = a[n - 1] + 1;
+			double rates[4];
+			rates[0] = scan_rate(bytes, [=] { return mismatch_by_loop(a, b, n) + less_by_loop(a, b, n); });
+			for (int level = tinySTL::SIMDSSE2; level <= tinySTL::SIMDAVX512; ++level) {
+				tinySTL::Simd::setLevel(level);
+				rates[level] = scan_rate(bytes, [=] {
+					return (size_t)(tinySTL::mismatch(a, a + n, b).first - a) + tinySTL::lexicographical_compare(a, a + n, b, b + n);
+				});
+			}
+			b[n - 1] = a[n - 1];
+			char label[32];
+			size_label(label, sizeof(label), bytes);
+			std::printf("%-12s %10.2f %10.2f %10.2f %10.2f\n", label, rates[0], rates[1], rates[2], rates[3]);
+		}
+		std::free(a);
+		std::free(b);
+	}
+
+	/* mismatch followed by lexicographical_compare over the same two ranges, GB/s of one range */
+	void compare() {
+		compare_table<uint32_t>("uint32 GB/s", (size_t)64 << 20);
+		compare_table<uint64_t>("uint64 GB/s", (size_t)64 << 20);
+	}
+
+	struct entry {
+		const char* name;
+		void (*run)();
+	};
+
+	const entry benchmarks[] = {
+		{ "relocate", relocate },
+		{ "fill", fill },
+		{ "compare", compare },
+	};
+}
+
+int main(int argc, char** argv) {
+	for (auto& b : bench::benchmarks) {
+		if (argc > 1 && std::strcmp(argv[1], b.name) != 0)
+			continue;
+		std::printf("== %s\n", b.name);
+		b.run();
+	}
+	return 0;
+}
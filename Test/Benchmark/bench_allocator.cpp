@@ -0,0 +1,851 @@
+/*
+ * Allocator benchmarks, build with optimization on, e.g.
+ *   g++ -O2 -std=c++17 -pthread bench_allocator.cpp -o bench_allocator
+ *   ./bench_allocator                 run everything
+ *   ./bench_allocator thread_scaling  run one benchmark
+ */
+#include "../../allocator.h"
+#include "../../basic_string.h"
+#include "../../file_arena.h"
+#include "../../object_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bench
+{
+	using clock_type = std::chrono::steady_clock;
+
+	inline double seconds_since(clock_type::time_point start) {
+		return std::chrono::duration<double>(clock_type::now() - start).count();
+	}
+
+	struct malloc_backend {
+		static void* allocate(size_t n) { return std::malloc(n); }
+		static void deallocate(void* p, size_t) { std::free(p); }
+	};
+
+	/* every thread keeps a small window of live objects and churns through it */
+	template <typename Backend>
+	double small_object_churn(int threads, int ops) {
+		std::vector<std::thread> workers;
+		auto start = clock_type::now();
+		for (int t = 0; t < threads; ++t) {
+			workers.emplace_back([ops]() {
+				void* window[64] = { nullptr };
+				for (int i = 0; i < ops; ++i) {
+					size_t slot = (size_t)i & 63;
+					size_t n = ((size_t)i * 7 & 127) + 1;
+					if (window[slot])
+						Backend::deallocate(window[slot], ((size_t)(i - 64) * 7 & 127) + 1);
+					window[slot] = Backend::allocate(n);
+				}
+				for (int i = ops - 64; i < ops; ++i)
+					Backend::deallocate(window[(size_t)i & 63], ((size_t)i * 7 & 127) + 1);
+			});
+		}
+		for (auto& w : workers)
+			w.join();
+		return seconds_since(start);
+	}
+
+	void thread_scaling() {
+		const int ops = 2000000;
+		std::printf("%-8s %16s %16s\n", "threads", "alloc Mops/s", "malloc Mops/s");
+		for (int threads = 1; threads <= 32; threads *= 2) {
+			double a = small_object_churn<tinySTL::alloc>(threads, ops);
+			double m = small_object_churn<malloc_backend>(threads, ops);
+			std::printf("%-8d %16.1f %16.1f\n", threads,
+				threads * ops / a / 1e6, threads * ops / m / 1e6);
+		}
+	}
+
+	/* the same intrusive stack guarded by one mutex, the baseline for AtomicFreeList */
+	class locked_free_list {
+	public:
+		void push(tinySTL::FreeList* head, tinySTL::FreeList* tail) {
+			std::lock_guard<std::mutex> lock(mtx_);
+			tail->next = top_;
+			top_ = head;
+		}
+
+		tinySTL::FreeList* pop() {
+			std::lock_guard<std::mutex> lock(mtx_);
+			tinySTL::FreeList* p = top_;
+			if (p)
+				top_ = p->next;
+			return p;
+		}
+
+	private:
+		std::mutex mtx_;
+		tinySTL::FreeList* top_ = nullptr;
+	};
+
+	template <typename List>
+	double push_pop(int threads, int ops) {
+		List list;
+		std::vector<tinySTL::FreeList> nodes((size_t)threads * 16);
+		for (auto& node : nodes)
+			list.push(&node, &node);
+		std::vector<std::thread> workers;
+		auto start = clock_type::now();
+		for (int t = 0; t < threads; ++t) {
+			workers.emplace_back([&list, ops]() {
+				for (int i = 0; i < ops; ++i) {
+					if (auto p = list.pop())
+						list.push(p, p);
+				}
+			});
+		}
+		for (auto& w : workers)
+			w.join();
+		return seconds_since(start);
+	}
+
+	void central_list() {
+		const int ops = 1000000;
+		std::printf("%-8s %18s %18s\n", "threads", "lock-free Mops/s", "mutex Mops/s");
+		for (int threads = 1; threads <= 64; threads *= 2) {
+			double a = push_pop<tinySTL::AtomicFreeList>(threads, ops);
+			double m = push_pop<locked_free_list>(threads, ops);
+			std::printf("%-8d %18.1f %18.1f\n", threads,
+				threads * ops / a / 1e6, threads * ops / m / 1e6);
+		}
+	}
+
+	/* resident set size in MiB, -1 where /proc is not available */
+	double resident_mib() {
+		long pages = -1, resident = -1;
+		FILE* f = std::fopen("/proc/self/statm", "r");
+		if (!f)
+			return -1;
+		if (std::fscanf(f, "%ld %ld", &pages, &resident) != 2)
+			resident = -1;
+		std::fclose(f);
+		return resident < 0 ? -1 : resident * 4096.0 / (1024 * 1024);
+	}
+
+	void burst_then_idle() {
+		using pool = tinySTL::DefaultAllocTemplate<true, 7>;
+		const size_t count = 4000000; // 256 MiB of 64-byte objects
+		std::vector<void*> blocks(count);
+		std::printf("%-24s %10.1f MiB\n", "before burst", resident_mib());
+		for (size_t i = 0; i < count; ++i) {
+			blocks[i] = pool::allocate(64);
+			std::memset(blocks[i], 1, 64);
+		}
+		std::printf("%-24s %10.1f MiB\n", "after burst", resident_mib());
+		for (size_t i = 0; i < count; ++i)
+			pool::deallocate(blocks[i], 64);
+		std::vector<void*>().swap(blocks);
+		std::printf("%-24s %10.1f MiB\n", "all freed, idle", resident_mib());
+		auto start = clock_type::now();
+		size_t released = pool::trim();
+		std::printf("%-24s %10.1f MiB (released %zu MiB in %.1f ms)\n", "after trim()", resident_mib(),
+			released >> 20, seconds_since(start) * 1e3);
+	}
+
+	/* sizes spread log-uniformly over [8, 4096], like list nodes and string buffers */
+	std::vector<size_t> make_mixed_sizes(size_t count) {
+		std::mt19937 rng(42);
+		std::uniform_real_distribution<double> exp2(3.0, 12.0);
+		std::vector<size_t> sizes(count);
+		for (auto& n : sizes)
+			n = (size_t)std::pow(2.0, exp2(rng));
+		return sizes;
+	}
+
+	template <typename Backend>
+	void mixed_latency(const char* name, const std::vector<size_t>& sizes) {
+		const size_t window = 4096;
+		std::vector<void*> live(window, nullptr);
+		std::vector<size_t> liveSize(window, 0);
+		std::vector<double> ns;
+		ns.reserve(sizes.size());
+		auto total = clock_type::now();
+		for (size_t i = 0; i < sizes.size(); ++i) {
+			size_t slot = i % window;
+			if (live[slot])
+				Backend::deallocate(live[slot], liveSize[slot]);
+			auto start = clock_type::now();
+			live[slot] = Backend::allocate(sizes[i]);
+			ns.push_back(std::chrono::duration<double, std::nano>(clock_type::now() - start).count());
+			liveSize[slot] = sizes[i];
+		}
+		double secs = seconds_since(total);
+		for (size_t i = 0; i < window; ++i)
+			if (live[i])
+				Backend::deallocate(live[i], liveSize[i]);
+		std::sort(ns.begin(), ns.end());
+		auto pct = [&ns](double q) { return ns[(size_t)(q * (ns.size() - 1))]; };
+		std::printf("%-8s %10.1f %10.0f %10.0f %10.0f %10.0f\n", name, sizes.size() / secs / 1e6,
+			pct(0.5), pct(0.99), pct(0.999), ns.back());
+	}
+
+	void mixed_sizes() {
+		auto sizes = make_mixed_sizes(2000000);
+		size_t large = (size_t)std::count_if(sizes.begin(), sizes.end(),
+			[](size_t n) { return n > (size_t)tinySTL::SMALLBytes; });
+		std::printf("%zu of %zu requests are above %d bytes and used to go to malloc_alloc, "
+			"now none up to %d bytes do\n", large, sizes.size(), (int)tinySTL::SMALLBytes, (int)tinySTL::MAXBytes);
+		std::printf("%-8s %10s %10s %10s %10s %10s\n", "backend", "Mops/s", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+		mixed_latency<tinySTL::alloc>("alloc", sizes);
+		mixed_latency<malloc_backend>("malloc", sizes);
+	}
+
+	struct chase_node {
+		chase_node* next;
+		char payload[56];
+	};
+
+	/* link pool nodes in a random cycle and follow it, every hop is a likely cache and TLB miss */
+	template <typename Pool>
+	double chase_ns_per_hop(size_t count, size_t hops) {
+		std::vector<chase_node*> nodes(count);
+		for (auto& n : nodes)
+			n = static_cast<chase_node*>(Pool::allocate(sizeof(chase_node)));
+		std::vector<size_t> order(count);
+		for (size_t i = 0; i < count; ++i)
+			order[i] = i;
+		std::shuffle(order.begin(), order.end(), std::mt19937(7));
+		for (size_t i = 0; i < count; ++i)
+			nodes[order[i]]->next = nodes[order[(i + 1) % count]];
+
+		chase_node* cur = nodes[order[0]];
+		auto start = clock_type::now();
+		for (size_t i = 0; i < hops; ++i)
+			cur = cur->next;
+		double secs = seconds_since(start);
+		if (!cur)
+			std::printf("unreachable\n");
+		for (auto n : nodes)
+			Pool::deallocate(n, sizeof(chase_node));
+		return secs * 1e9 / hops;
+	}
+
+	void huge_page_chase() {
+		using small_pages = tinySTL::DefaultAllocTemplate<false, 8>;
+		using huge_pages = tinySTL::DefaultAllocTemplate<false, 9>;
+		huge_pages::setHugePageArena(true);
+		const size_t hops = 20000000;
+		std::printf("%-12s %16s %16s\n", "working set", "4K pages ns/hop", "THP arena ns/hop");
+		for (size_t mib = 16; mib <= 1024; mib *= 4) {
+			size_t count = mib * 1024 * 1024 / sizeof(chase_node);
+			double a = chase_ns_per_hop<small_pages>(count, hops);
+			double b = chase_ns_per_hop<huge_pages>(count, hops);
+			std::printf("%8zu MiB %16.1f %16.1f\n", mib, a, b);
+		}
+	}
+
+	/* the same churn with the statistics counters off and on */
+	void stats_overhead() {
+		using pool = tinySTL::DefaultAllocTemplate<true, 10>;
+		const int ops = 20000000;
+		small_object_churn<pool>(1, ops); // warm up the pool
+		double off = small_object_churn<pool>(1, ops);
+		pool::setStatsEnabled(true);
+		double on = small_object_churn<pool>(1, ops);
+		std::printf("%-10s %12s\n", "stats", "ns/op");
+		std::printf("%-10s %12.2f\n", "off", off / ops * 1e9);
+		std::printf("%-10s %12.2f\n", "on", on / ops * 1e9);
+		pool::getStats().print(stdout);
+	}
+
+	/* allocator<T, Alloc> churn with the heap profiler off and sampling every 512 KiB */
+	double profiled_churn(int ops) {
+		using node_alloc = tinySTL::allocator<char[48], tinySTL::alloc>;
+		char(*window[256])[48] = { nullptr };
+		auto start = clock_type::now();
+		for (int i = 0; i < ops; ++i) {
+			size_t slot = (size_t)i & 255;
+			node_alloc::deallocate(window[slot]);
+			window[slot] = node_alloc::allocate();
+		}
+		for (auto p : window)
+			node_alloc::deallocate(p);
+		return seconds_since(start);
+	}
+
+	void heap_profiler_overhead() {
+		const int ops = 20000000;
+		profiled_churn(ops);
+		double off = profiled_churn(ops);
+		tinySTL::heap_profiler::setSampleRate(512 * 1024);
+		double on = profiled_churn(ops);
+		tinySTL::heap_profiler::setSampleRate(0);
+		std::printf("%-10s %12s\n", "sampling", "ns/op");
+		std::printf("%-10s %12.2f\n", "off", off / ops * 1e9);
+		std::printf("%-10s %12.2f  (%+.1f%%)\n", "512 KiB", on / ops * 1e9, (on / off - 1) * 100);
+	}
+
+	/* grows a buffer to 1 GiB by appending 64 KiB pieces, doubling the capacity when full */
+	template <typename Grow>
+	double append_growth(Grow grow, size_t& copies) {
+		using byte_alloc = tinySTL::allocator<char, tinySTL::alloc>;
+		const size_t total = (size_t)1 << 30;
+		const size_t piece = 64 * 1024;
+		size_t cap = 2 * 1024 * 1024;
+		char* buf = byte_alloc::allocate(cap);
+		copies = 0;
+		auto start = clock_type::now();
+		for (size_t size = 0; size < total; size += piece) {
+			if (size + piece > cap) {
+				char* old = buf;
+				buf = grow(buf, cap, 2 * cap);
+				copies += buf != old;
+				cap *= 2;
+			}
+			std::memset(buf + size, (int)(size / piece), piece);
+		}
+		double t = seconds_since(start);
+		byte_alloc::deallocate(buf, cap);
+		return t;
+	}
+
+	void append_growth_1gib() {
+		using byte_alloc = tinySTL::allocator<char, tinySTL::alloc>;
+		size_t moved = 0;
+		/* what a container without reallocate does: allocate, copy, free */
+		double copy = append_growth([](char* p, size_t old_n, size_t new_n) {
+			char* q = byte_alloc::allocate(new_n);
+			std::memcpy(q, p, old_n);
+			byte_alloc::deallocate(p, old_n);
+			return q;
+		}, moved);
+		std::printf("%-14s %10s %10s\n", "growth", "seconds", "relocated");
+		std::printf("%-14s %10.3f %10zu\n", "copy", copy, moved);
+		double remap = append_growth([](char* p, size_t old_n, size_t new_n) {
+			return byte_alloc::reallocate(p, old_n, new_n);
+		}, moved);
+		std::printf("%-14s %10.3f %10zu\n", "reallocate", remap, moved);
+
+		/* the same growth through basic_string::append, which grows by half and reallocates in place */
+		const std::string piece(64 * 1024, 's');
+		auto start = clock_type::now();
+		size_t growths = 0;
+		moved = 0;
+		{
+			tinySTL::basic_string<char> str;
+			for (size_t size = 0; size < ((size_t)1 << 30); size += piece.size()) {
+				const char* old = str.c_str();
+				size_t cap = str.capacity();
+				str.append(piece.data(), piece.size());
+				growths += str.capacity() != cap;
+				moved += str.capacity() != cap && str.c_str() != old;
+			}
+		}
+		std::printf("%-14s %10.3f %10zu  (%zu growths)\n", "basic_string", seconds_since(start), moved, growths);
+	}
+
+	/* builds and tears down a 10k node list, one allocate per node versus allocate_batch */
+	struct list_node {
+		list_node* next;
+		long value;
+		long pad[2];
+	};
+
+	template <typename Pool>
+	void bulk_nodes_with() {
+		using node_alloc = tinySTL::allocator<list_node, Pool>;
+		const size_t count = 10000;
+		const int rounds = 1000;
+		std::vector<list_node*> nodes(count);
+		double t[2];
+		for (int batch = 0; batch < 2; ++batch) {
+			auto start = clock_type::now();
+			for (int r = 0; r < rounds; ++r) {
+				if (batch) {
+					node_alloc::allocate_batch(count, nodes.data());
+				}
+				else {
+					for (size_t i = 0; i < count; ++i)
+						nodes[i] = node_alloc::allocate();
+				}
+				for (size_t i = 0; i < count; ++i) {
+					nodes[i]->next = i + 1 < count ? nodes[i + 1] : nullptr;
+					nodes[i]->value = (long)i;
+				}
+				if (batch) {
+					node_alloc::deallocate_batch(nodes.data(), count);
+				}
+				else {
+					for (size_t i = 0; i < count; ++i)
+						node_alloc::deallocate(nodes[i]);
+				}
+			}
+			t[batch] = seconds_since(start) / rounds / count * 1e9;
+		}
+		std::printf("%12.2f %14.2f\n", t[0], t[1]);
+	}
+
+	void bulk_nodes() {
+		std::printf("%-20s %12s %14s\n", "pool", "ns/node", "batch ns/node");
+		std::printf("%-20s ", "alloc");
+		bulk_nodes_with<tinySTL::alloc>();
+		std::printf("%-20s ", "single_client_alloc");
+		bulk_nodes_with<tinySTL::single_client_alloc>();
+	}
+
+	/* one thread allocates and hands every object to another thread which frees it */
+	template <typename Backend>
+	double producer_consumer_with(size_t count) {
+		const size_t ring_size = 1024;
+		std::vector<std::atomic<void*>> ring(ring_size);
+		for (auto& slot : ring)
+			slot.store(nullptr, std::memory_order_relaxed);
+		auto start = clock_type::now();
+		std::thread consumer([&ring, count]() {
+			for (size_t i = 0; i < count; ++i) {
+				std::atomic<void*>& slot = ring[i % ring_size];
+				void* p;
+				while (!(p = slot.load(std::memory_order_acquire)))
+					std::this_thread::yield();
+				slot.store(nullptr, std::memory_order_release);
+				Backend::deallocate(p, 64);
+			}
+		});
+		for (size_t i = 0; i < count; ++i) {
+			std::atomic<void*>& slot = ring[i % ring_size];
+			while (slot.load(std::memory_order_acquire))
+				std::this_thread::yield();
+			void* p = Backend::allocate(64);
+			*(size_t*)p = i;
+			slot.store(p, std::memory_order_release);
+		}
+		consumer.join();
+		return seconds_since(start) / count * 1e9;
+	}
+
+	/* the same objects allocated and freed by one thread, in the same order */
+	template <typename Backend>
+	double alloc_free_with(size_t count) {
+		const size_t window = 1024;
+		std::vector<void*> ring(window, nullptr);
+		auto start = clock_type::now();
+		for (size_t i = 0; i < count; ++i) {
+			void*& slot = ring[i % window];
+			if (slot)
+				Backend::deallocate(slot, 64);
+			slot = Backend::allocate(64);
+			*(size_t*)slot = i;
+		}
+		for (auto p : ring)
+			Backend::deallocate(p, 64);
+		return seconds_since(start) / count * 1e9;
+	}
+
+	void producer_consumer() {
+		const size_t count = 20000000;
+		std::printf("%-10s %18s %20s %8s\n", "backend", "single ns/object", "cross-thread ns/object", "ratio");
+		double s = alloc_free_with<tinySTL::alloc>(count);
+		double c = producer_consumer_with<tinySTL::alloc>(count);
+		std::printf("%-10s %18.2f %20.2f %8.2f\n", "alloc", s, c, c / s);
+		s = alloc_free_with<malloc_backend>(count);
+		c = producer_consumer_with<malloc_backend>(count);
+		std::printf("%-10s %18.2f %20.2f %8.2f\n", "malloc", s, c, c / s);
+		/* without remote frees every object would pile up in the consumer's cache */
+		std::printf("%-10s %18.1f MiB\n", "resident", resident_mib());
+	}
+
+	/* a message holding its own buffer: every construction allocates */
+	struct message {
+		std::vector<char> payload;
+		long sequence = 0;
+
+		message() { payload.reserve(512); }
+	};
+
+	struct reset_message {
+		void operator()(message& m) const {
+			m.payload.clear();
+			m.sequence = 0;
+		}
+	};
+
+	struct new_backend {
+		static message* acquire() { return new message; }
+		static void release(message* m) { delete m; }
+	};
+
+	struct alloc_backend {
+		using pool = tinySTL::allocator<message, tinySTL::alloc>;
+		static message* acquire() { return ::new((void*)pool::allocate()) message; }
+		static void release(message* m) {
+			m->~message();
+			pool::deallocate(m);
+		}
+	};
+
+	template <typename Backend>
+	double message_churn(int ops) {
+		message* window[64] = { nullptr };
+		auto start = clock_type::now();
+		for (int i = 0; i < ops; ++i) {
+			message*& slot = window[(size_t)i & 63];
+			if (slot)
+				Backend::release(slot);
+			slot = Backend::acquire();
+			slot->payload.push_back((char)i);
+			slot->sequence = i;
+		}
+		for (auto m : window)
+			Backend::release(m);
+		return seconds_since(start) / ops * 1e9;
+	}
+
+	void object_pool() {
+		const int ops = 5000000;
+		using pool = tinySTL::object_pool<message>;
+		using cached_pool = tinySTL::object_pool<message, reset_message>;
+		std::printf("%-28s %10s\n", "backend", "ns/object");
+		std::printf("%-28s %10.2f\n", "new/delete", message_churn<new_backend>(ops));
+		std::printf("%-28s %10.2f\n", "tinySTL::alloc", message_churn<alloc_backend>(ops));
+		std::printf("%-28s %10.2f\n", "object_pool", message_churn<pool>(ops));
+		cached_pool::reserve(64);
+		std::printf("%-28s %10.2f\n", "object_pool, kept built", message_churn<cached_pool>(ops));
+	}
+
+	struct churn_node {
+		churn_node* next;
+		long value;
+		long pad[2];
+	};
+
+	/* a long random churn over a big live set, then a fresh list built in allocation order */
+	template <typename Backend>
+	void churn_then_iterate(const char* name) {
+		const size_t live_count = 1000000;
+		const size_t churn = 8000000;
+		const size_t list_count = 200000;
+		const int passes = 20;
+		std::vector<void*> live(live_count);
+		for (auto& p : live)
+			p = Backend::allocate(sizeof(churn_node));
+		std::mt19937_64 rng(7);
+		for (size_t i = 0; i < churn; ++i) {
+			void*& slot = live[rng() % live_count];
+			Backend::deallocate(slot, sizeof(churn_node));
+			slot = Backend::allocate(sizeof(churn_node));
+		}
+		/* half of the live set goes away, then the list fills the holes */
+		for (size_t i = 0; i < live_count / 2; ++i) {
+			size_t k = rng() % live.size();
+			Backend::deallocate(live[k], sizeof(churn_node));
+			live[k] = live.back();
+			live.pop_back();
+		}
+		churn_node* head = nullptr;
+		churn_node* tail = nullptr;
+		for (size_t i = 0; i < list_count; ++i) {
+			churn_node* n = (churn_node*)Backend::allocate(sizeof(churn_node));
+			n->next = nullptr;
+			n->value = (long)i;
+			(tail ? tail->next : head) = n;
+			tail = n;
+		}
+		std::vector<uintptr_t> pages;
+		for (churn_node* n = head; n; n = n->next)
+			pages.push_back((uintptr_t)n / 4096);
+		std::sort(pages.begin(), pages.end());
+		size_t distinct = std::unique(pages.begin(), pages.end()) - pages.begin();
+
+		auto start = clock_type::now();
+		long sum = 0;
+		for (int pass = 0; pass < passes; ++pass) {
+			for (churn_node* n = head; n; n = n->next)
+				sum += n->value;
+		}
+		double ns = seconds_since(start) / passes / list_count * 1e9;
+		std::printf("%-26s %12.2f %12zu   (%ld)\n", name, ns, distinct, sum % 10);
+
+		for (churn_node* n = head, *next; n; n = next) {
+			next = n->next;
+			Backend::deallocate(n, sizeof(churn_node));
+		}
+		for (auto p : live)
+			Backend::deallocate(p, sizeof(churn_node));
+	}
+
+	void slab_locality() {
+		std::printf("%-26s %12s %12s\n", "backend", "ns/node", "pages");
+		churn_then_iterate<malloc_backend>("malloc");
+		churn_then_iterate<tinySTL::single_client_alloc>("single_client_alloc");
+		churn_then_iterate<tinySTL::alloc>("alloc");
+		churn_then_iterate<tinySTL::single_client_slab_alloc>("single_client_slab_alloc");
+		churn_then_iterate<tinySTL::slab_alloc>("slab_alloc");
+	}
+
+	/* random inserts and erases on a map that stays around a fixed size */
+	template <typename Map>
+	double map_churn_ns(size_t keys, size_t ops) {
+		Map m;
+		std::mt19937 rng(11);
+		for (size_t i = 0; i < keys; ++i)
+			m[(int)(rng() % (2 * keys))] = (int)i;
+		auto start = clock_type::now();
+		for (size_t i = 0; i < ops; ++i) {
+			int k = (int)(rng() % (2 * keys));
+			if (i & 1)
+				m.erase(k);
+			else
+				m.emplace(k, (int)i);
+		}
+		double ns = seconds_since(start) / ops * 1e9;
+		if (m.size() > 2 * keys)
+			std::printf("unexpected size\n");
+		return ns;
+	}
+
+	template <typename Alloc>
+	using pool_map = std::map<int, int, std::less<int>, tinySTL::allocator<std::pair<const int, int>, Alloc>>;
+
+	void std_map() {
+		const size_t ops = 4000000;
+		std::printf("%-10s %14s %14s %14s %14s\n", "keys", "std::allocator", "alloc", "single_client", "slab_alloc");
+		for (size_t keys : { (size_t)1000, (size_t)100000, (size_t)1000000 }) {
+			std::printf("%-10zu %11.1f ns %11.1f ns %11.1f ns %11.1f ns\n", keys,
+				map_churn_ns<std::map<int, int>>(keys, ops),
+				map_churn_ns<pool_map<tinySTL::alloc>>(keys, ops),
+				map_churn_ns<pool_map<tinySTL::single_client_alloc>>(keys, ops),
+				map_churn_ns<pool_map<tinySTL::slab_alloc>>(keys, ops));
+		}
+	}
+
+	/* the first requests of a fresh pool, each one allocates and writes its object */
+	template <typename Pool>
+	void first_requests(const char* name, const std::vector<size_t>& sizes, double setup_ms) {
+		std::vector<void*> live(sizes.size());
+		std::vector<double> ns(sizes.size());
+		auto total = clock_type::now();
+		for (size_t i = 0; i < sizes.size(); ++i) {
+			auto start = clock_type::now();
+			live[i] = Pool::allocate(sizes[i]);
+			std::memset(live[i], 1, sizes[i]);
+			ns[i] = std::chrono::duration<double, std::nano>(clock_type::now() - start).count();
+		}
+		double us = seconds_since(total) * 1e6;
+		for (size_t i = 0; i < sizes.size(); ++i)
+			Pool::deallocate(live[i], sizes[i]);
+		std::sort(ns.begin(), ns.end());
+		auto pct = [&ns](double q) { return ns[(size_t)(q * (ns.size() - 1))]; };
+		std::printf("%-16s %10.2f %10.0f %8.0f %8.0f %8.0f %8.0f\n", name, setup_ms, us,
+			pct(0.5), pct(0.99), pct(0.999), ns.back());
+	}
+
+	template <typename Pool>
+	double prewarm_for(const std::vector<size_t>& sizes, bool lock) {
+		auto start = clock_type::now();
+		size_t counts[tinySTL::FREELISTS] = {};
+		for (size_t n : sizes)
+			++counts[Pool::getFreeListIdx(n)];
+		Pool::prewarm(counts);
+		if (lock && !Pool::setLockPages(true))
+			std::printf("(mlock refused, pages stay unlocked)\n");
+		return seconds_since(start) * 1e3;
+	}
+
+	void prewarm_latency() {
+		const size_t count = 10000;
+		std::vector<size_t> sizes(count);
+		std::mt19937 rng(5);
+		for (auto& n : sizes)
+			n = (size_t)8 << (rng() % 7); // 8 .. 512 bytes
+		std::printf("%-16s %10s %10s %8s %8s %8s %8s\n", "first 10k", "setup ms", "total us",
+			"p50 ns", "p99 ns", "p99.9 ns", "max ns");
+		using cold = tinySTL::DefaultAllocTemplate<true, 20>;
+		using warm = tinySTL::DefaultAllocTemplate<true, 21>;
+		using locked = tinySTL::DefaultAllocTemplate<true, 22>;
+		first_requests<cold>("cold", sizes, 0.0);
+		first_requests<warm>("prewarmed", sizes, prewarm_for<warm>(sizes, false));
+		first_requests<locked>("prewarmed+mlock", sizes, prewarm_for<locked>(sizes, true));
+		locked::setLockPages(false);
+	}
+
+	/* most requests are tiny, a few are large: the hot classes refill often, the cold ones rarely */
+	std::vector<size_t> make_skewed_sizes(size_t count) {
+		std::vector<size_t> sizes(count);
+		std::mt19937 rng(3);
+		for (auto& n : sizes) {
+			unsigned r = rng() % 100;
+			if (r < 70)
+				n = 8;
+			else if (r < 90)
+				n = 16 + 8 * (rng() % 3);
+			else if (r < 98)
+				n = 64 + 64 * (rng() % 2);
+			else
+				n = (size_t)512 << (rng() % 4);
+		}
+		return sizes;
+	}
+
+	template <typename Pool>
+	void skewed_churn(const char* name, const std::vector<size_t>& sizes) {
+		const size_t window = 50000;
+		Pool::setStatsEnabled(true);
+		std::vector<void*> live(window, nullptr);
+		std::vector<size_t> live_size(window, 0);
+		std::mt19937 rng(9);
+		auto start = clock_type::now();
+		for (size_t i = 0; i < sizes.size(); ++i) {
+			/* bursts: the window fills up and drains, so free lists grow and run dry in turn */
+			size_t slot = (i / 7 + rng() % 64) % window;
+			if (live[slot])
+				Pool::deallocate(live[slot], live_size[slot]);
+			live[slot] = Pool::allocate(sizes[i]);
+			live_size[slot] = sizes[i];
+		}
+		double secs = seconds_since(start);
+		tinySTL::AllocStats stats = Pool::getStats();
+		std::printf("%-20s %8.1f Mops/s  reFills %8llu  peak idle %8zu KiB  resident %8zu KiB\n", name,
+			sizes.size() / secs / 1e6, (unsigned long long)stats.reFills, stats.peakIdleBytes / 1024,
+			stats.residentBytes / 1024);
+		std::printf("    %8s %10s %8s\n", "size", "reFills", "batch");
+		for (auto& c : stats.classes) {
+			if (c.allocs)
+				std::printf("    %8zu %10llu %8zu\n", c.size, (unsigned long long)c.reFills, c.batchObjs);
+		}
+		for (size_t i = 0; i < window; ++i) {
+			if (live[i])
+				Pool::deallocate(live[i], live_size[i]);
+		}
+	}
+
+	void skewed_refill() {
+		auto sizes = make_skewed_sizes(10000000);
+		skewed_churn<tinySTL::DefaultAllocTemplate<false, 23>>("single_client_alloc", sizes);
+		skewed_churn<tinySTL::DefaultAllocTemplate<true, 24>>("alloc", sizes);
+	}
+
+	/* a string-keyed index kept in a file: rebuild it from scratch, or map the file the last run left */
+	using file_string = std::basic_string<char, std::char_traits<char>, tinySTL::allocator<char, tinySTL::shm_alloc>>;
+
+	struct file_record {
+		file_string key;
+		uint64_t value;
+	};
+
+	using file_index = std::vector<file_record, tinySTL::allocator<file_record, tinySTL::shm_alloc>>;
+
+	inline void make_key(size_t i, char* buf) {
+		std::snprintf(buf, 32, "user:%09llu:profile", (unsigned long long)(i * 2654435761u % 1000000000u));
+	}
+
+	uint64_t file_lookups(const file_index& index, size_t count, size_t lookups) {
+		uint64_t sum = 0;
+		char key[32];
+		for (size_t i = 0; i < lookups; ++i) {
+			make_key((i * 7919) % count, key);
+			auto it = std::lower_bound(index.begin(), index.end(), key,
+				[](const file_record& r, const char* k) { return r.key.compare(k) < 0; });
+			sum += it->value;
+		}
+		return sum;
+	}
+
+	void file_remap() {
+		const size_t count = 1000000, lookups = 100000;
+		const uint64_t layout = 1;
+		const char* path = "/tmp/tinystl_bench_file_arena";
+		char key[32];
+
+		auto start = clock_type::now();
+		std::map<std::string, uint64_t> heap;
+		for (size_t i = 0; i < count; ++i) {
+			make_key(i, key);
+			heap.emplace(key, i);
+		}
+		std::printf("%-28s %10.1f ms\n", "std::map rebuild (heap)", seconds_since(start) * 1e3);
+
+		tinySTL::file_arena file;
+		start = clock_type::now();
+		if (!file.create(path, 256 * 1024 * 1024, layout)) {
+			std::printf("cannot create %s\n", path);
+			return;
+		}
+		{
+			tinySTL::shm_scope scope(file);
+			file_index* index = ::new(file.allocate(sizeof(file_index))) file_index();
+			index->reserve(count);
+			for (size_t i = 0; i < count; ++i) {
+				make_key(i, key);
+				index->push_back({ file_string(key), i });
+			}
+			std::sort(index->begin(), index->end(),
+				[](const file_record& a, const file_record& b) { return a.key < b.key; });
+			file.setRoot(index);
+		}
+		double build_ms = seconds_since(start) * 1e3;
+		size_t used = file.size() - file.available();
+		auto closing = clock_type::now();
+		file.close();
+		double close_ms = seconds_since(closing) * 1e3;
+		std::printf("%-28s %10.1f ms  (close + msync %.1f ms)\n", "cold rebuild (file arena)",
+			build_ms + close_ms, close_ms);
+
+		start = clock_type::now();
+		if (!file.open(path, layout)) {
+			std::printf("cannot reopen %s\n", path);
+			return;
+		}
+		file_index* index = (file_index*)file.getRoot();
+		double open_ms = seconds_since(start) * 1e3;
+		uint64_t first = file_lookups(*index, count, 1);
+		double first_ms = seconds_since(start) * 1e3;
+		std::printf("%-28s %10.1f ms  (open + checksum of %zu MiB, first lookup at %.2f ms)\n", "remap",
+			open_ms, used >> 20, first_ms);
+
+		start = clock_type::now();
+		uint64_t sum = file_lookups(*index, count, lookups) + first;
+		std::printf("%-28s %10.1f ns/lookup  (checksum %llu)\n", "lookups after remap",
+			seconds_since(start) * 1e9 / lookups, (unsigned long long)sum);
+		file.close();
+		std::remove(path);
+	}
+
+	struct entry {
+		const char* name;
+		void (*run)();
+	};
+
+	const entry benchmarks[] = {
+		{ "thread_scaling", thread_scaling },
+		{ "central_list", central_list },
+		{ "burst_then_idle", burst_then_idle },
+		{ "mixed_sizes", mixed_sizes },
+		{ "huge_page_chase", huge_page_chase },
+		{ "stats_overhead", stats_overhead },
+		{ "heap_profiler_overhead", heap_profiler_overhead },
+		{ "append_growth_1gib", append_growth_1gib },
+		{ "bulk_nodes", bulk_nodes },
+		{ "producer_consumer", producer_consumer },
+		{ "object_pool", object_pool },
+		{ "slab_locality", slab_locality },
+		{ "std_map", std_map },
+		{ "prewarm_latency", prewarm_latency },
+		{ "skewed_refill", skewed_refill },
+		{ "file_remap", file_remap },
+	};
+}
+
+int main(int argc, char** argv) {
+	for (auto& b : bench::benchmarks) {
+		if (argc > 1 && std::strcmp(argv[1], b.name) != 0)
+			continue;
+		std::printf("== %s\n", b.name);
+		b.run();
+	}
+	return 0;
+}
@@ -0,0 +1,354 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+#include "../../algobase.h"
+#include "../../basic_string.h"
+#include "../../memory.h"
+#include "../../uninitialized.h"
+
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+	struct pod16 {
+		uint32_t a, b, c, d;
+	};
+
+	struct pod32 {
+		double x[4];
+	};
+
+	/* fills [offset, offset + count) of a guarded buffer and checks both the values and the guards */
+	template <typename T>
+	bool fill_at(size_t offset, size_t count, const T& value) {
+		std::vector<unsigned char> raw((count + 2 * 64) * sizeof(T) + 64, 0xEE);
+		T* first = reinterpret_cast<T*>(raw.data() + offset) + 64;
+		tinySTL::fill_n(first, count, value);
+		for (size_t i = 0; i < count; ++i) {
+			if (std::memcmp(first + i, &value, sizeof(T)) != 0)
+				return false;
+		}
+		const unsigned char* begin = reinterpret_cast<const unsigned char*>(first);
+		const unsigned char* end = reinterpret_cast<const unsigned char*>(first + count);
+		for (const unsigned char* p = raw.data(); p != raw.data() + raw.size(); ++p) {
+			if ((p < begin || p >= end) && *p != 0xEE)
+				return false;
+		}
+		return true;
+	}
+
+	template <typename T>
+	bool fill_all_shapes(const T& value) {
+		bool ok = true;
+		for (size_t offset = 0; offset < 64; offset += alignof(T))
+			for (size_t count = 0; count < 300; count += 1 + count / 8)
+				ok &= fill_at(offset, count, value);
+		return ok;
+	}
+}
+
+TEST_CASE("[Algorithm] fill_n writes every width at every alignment")
+{
+	for (int level = tinySTL::SIMDScalar; level <= tinySTL::SIMDAVX512; ++level) {
+		tinySTL::Simd::setLevel(level);
+		CHECK(fill_all_shapes<uint16_t>(0xA1B2));
+		CHECK(fill_all_shapes<int>(-123456789));
+		CHECK(fill_all_shapes<double>(3.25));
+		CHECK(fill_all_shapes(pod16{ 1, 2, 3, 4 }));
+		CHECK(fill_all_shapes(pod32{ { 1.5, -2.5, 3.5, -4.5 } }));
+	}
+	tinySTL::Simd::setLevel(tinySTL::SIMDAVX512);
+}
+
+TEST_CASE("[Algorithm] non-temporal stores past the threshold")
+{
+	size_t saved = tinySTL::Simd::getNonTemporalThreshold();
+	tinySTL::Simd::setNonTemporalThreshold(4096);
+	for (int level = tinySTL::SIMDSSE2; level <= tinySTL::SIMDAVX512; ++level) {
+		tinySTL::Simd::setLevel(level);
+		CHECK(fill_at<uint64_t>(8, 100000, 0x0123456789ABCDEFull));
+		CHECK(fill_at(4, 9999, pod16{ 9, 8, 7, 6 }));
+	}
+	tinySTL::Simd::setLevel(tinySTL::SIMDAVX512);
+	tinySTL::Simd::setNonTemporalThreshold(saved);
+}
+
+TEST_CASE("[Algorithm] fill and uninitialized_fill go through the same kernels")
+{
+	std::vector<double> v(1000, 0.0);
+	tinySTL::fill(v.data(), v.data() + v.size(), 7); // int converted once, like assignment
+	CHECK(v.front() == 7.0);
+	CHECK(v.back() == 7.0);
+
+	int ints[37] = {};
+	tinySTL::fill(ints + 1, ints + 36, 5);
+	CHECK(ints[0] == 0);
+	CHECK(ints[1] == 5);
+	CHECK(ints[35] == 5);
+	CHECK(ints[36] == 0);
+
+	std::vector<pod32> raw(513);
+	tinySTL::uninitialized_fill_n(raw.data(), raw.size(), pod32{ { 1, 2, 3, 4 } });
+	CHECK(raw[512].x[3] == 4.0);
+	tinySTL::uninitialized_fill(raw.data(), raw.data() + 100, pod32{ { 5, 6, 7, 8 } });
+	CHECK(raw[99].x[0] == 5.0);
+	CHECK(raw[100].x[0] == 1.0);
+}
+
+namespace {
+	/* 12 bytes, no padding; == compares every member, < only the key */
+	struct record {
+		uint32_t key;
+		uint32_t lo, hi;
+		bool operator==(const record& rhs) const { return key == rhs.key && lo == rhs.lo && hi == rhs.hi; }
+		bool operator<(const record& rhs) const { return key < rhs.key; }
+	};
+
+	enum class color : uint16_t { red, green, blue };
+
+	template <typename T>
+	T make_value(size_t i) {
+		T value;
+		std::memset(&value, 0, sizeof(T));
+		std::memcpy(&value, &i, sizeof(T) < sizeof(i) ? sizeof(T) : sizeof(i));
+		return value;
+	}
+
+	/* for every length and every position, flips one byte and checks mismatch finds that element */
+	template <typename T>
+	bool mismatch_all_shapes() {
+		std::vector<T> a(300), b(300);
+		for (size_t i = 0; i < a.size(); ++i)
+			a[i] = b[i] = make_value<T>(i * 2654435761u);
+		bool ok = true;
+		for (size_t n = 0; n < a.size(); n += 1 + n / 16) {
+			auto same = tinySTL::mismatch(a.data(), a.data() + n, b.data());
+			ok &= same.first == a.data() + n && same.second == b.data() + n;
+			ok &= tinySTL::equal(a.data(), a.data() + n, b.data());
+			for (size_t at = 0; at < n; ++at) {
+				unsigned char* bytes = reinterpret_cast<unsigned char*>(b.data() + at) + at % sizeof(T);
+				*bytes ^= 0x40;
+				auto diff = tinySTL::mismatch(a.data(), a.data() + n, b.data(), b.data() + n);
+				ok &= diff.first == a.data() + at && diff.second == b.data() + at;
+				ok &= !tinySTL::equal(a.data(), a.data() + n, b.data());
+				*bytes ^= 0x40;
+			}
+		}
+		return ok;
+	}
+}
+
+namespace tinySTL {
+	template <>
+	struct is_bitwise_comparable<record> : std::true_type {};
+}
+
+TEST_CASE("[Algorithm] mismatch and equal find the first differing element")
+{
+	static_assert(tinySTL::is_simd_comparable<const uint32_t, uint32_t>::value, "integers compare bytewise");
+	static_assert(tinySTL::is_simd_comparable<color, color>::value, "enums compare bytewise");
+	static_assert(!tinySTL::is_simd_comparable<double, double>::value, "-0.0 == 0.0 but the bytes differ");
+	for (int level = tinySTL::SIMDScalar; level <= tinySTL::SIMDAVX512; ++level) {
+		tinySTL::Simd::setLevel(level);
+		CHECK(mismatch_all_shapes<uint8_t>());
+		CHECK(mismatch_all_shapes<uint16_t>());
+		CHECK(mismatch_all_shapes<uint32_t>());
+		CHECK(mismatch_all_shapes<uint64_t>());
+		CHECK(mismatch_all_shapes<record>());
+	}
+	tinySTL::Simd::setLevel(tinySTL::SIMDAVX512);
+
+	int a[] = { 1, 2, 3, 4 };
+	int b[] = { 1, 2, 3 };
+	auto shorter = tinySTL::mismatch(a, a + 4, b, b + 3);
+	CHECK(shorter.first == a + 3);
+	CHECK(shorter.second == b + 3);
+	auto by_cmp = tinySTL::mismatch(a, a + 3, b, [](int x, int y) { return x == y && x < 3; });
+	CHECK(by_cmp.first == a + 2);
+}
+
+TEST_CASE("[Algorithm] lexicographical_compare orders by the typed value")
+{
+	std::vector<int32_t> a(100, 7), b(100, 7);
+	CHECK(!tinySTL::lexicographical_compare(a.data(), a.data() + 100, b.data(), b.data() + 100));
+	CHECK(tinySTL::lexicographical_compare(a.data(), a.data() + 99, b.data(), b.data() + 100));
+	b[70] = -1; // 0xFFFFFFFF as bytes, but smaller as int32_t
+	CHECK(!tinySTL::lexicographical_compare(a.data(), a.data() + 100, b.data(), b.data() + 100));
+	CHECK(tinySTL::lexicographical_compare(b.data(), b.data() + 100, a.data(), a.data() + 100));
+
+	std::vector<uint64_t> u(65, 1), v(65, 1);
+	v[64] = 2;
+	CHECK(tinySTL::lexicographical_compare(u.data(), u.data() + 65, v.data(), v.data() + 65));
+
+	/* records equivalent under < but not bitwise equal are skipped, like the element loop does */
+	record r[3] = { { 1, 0, 0 }, { 2, 5, 5 }, { 3, 0, 0 } };
+	record s[3] = { { 1, 0, 0 }, { 2, 6, 6 }, { 4, 0, 0 } };
+	CHECK(tinySTL::lexicographical_compare(r, r + 3, s, s + 3));
+	CHECK(!tinySTL::lexicographical_compare(s, s + 3, r, r + 3));
+	CHECK(!tinySTL::equal(r, r + 3, s));
+}
+
+namespace {
+	/* every object gets its own serial, so each destruction can be counted per object */
+	struct tracked {
+		static int next_serial;
+		static int destroyed[64];
+		static int throw_after; // the move constructor throws once this many moves have succeeded; -1 never
+
+		int serial;
+		int value;
+
+		explicit tracked(int v) : serial(next_serial++), value(v) {}
+		tracked(tracked&& other) : serial(-1), value(other.value) {
+			if (throw_after == 0)
+				throw std::runtime_error("move failed");
+			if (throw_after > 0)
+				--throw_after;
+			serial = next_serial++;
+			other.value = -1;
+		}
+		~tracked() { ++destroyed[serial]; }
+
+		static void reset() {
+			next_serial = 0;
+			throw_after = -1;
+			std::memset(destroyed, 0, sizeof(destroyed));
+		}
+	};
+
+	int tracked::next_serial = 0;
+	int tracked::destroyed[64];
+	int tracked::throw_after = -1;
+
+	/* owns a heap int; opts into relocation, so its destructor must not run while it is relocated */
+	struct handle {
+		static int destructions;
+		int* p;
+
+		explicit handle(int v) : p(new int(v)) {}
+		handle(handle&& other) noexcept : p(other.p) { other.p = nullptr; }
+		~handle() {
+			++destructions;
+			delete p;
+		}
+	};
+
+	int handle::destructions = 0;
+
+	struct stateful_deleter {
+		int tag;
+		void operator()(int* p) const { delete p; }
+	};
+
+	struct owning_deleter {
+		std::string name; // not trivially copyable, so neither is the unique_ptr holding it
+		void operator()(int* p) const { delete p; }
+	};
+
+	template <typename T>
+	T* raw_storage(size_t n) {
+		return static_cast<T*>(::operator new(n * sizeof(T)));
+	}
+}
+
+namespace tinySTL {
+	template <>
+	struct is_trivially_relocatable<handle> : std::true_type {};
+}
+
+TEST_CASE("[Algorithm] is_trivially_relocatable")
+{
+	static_assert(tinySTL::is_trivially_relocatable<int>::value, "trivially copyable");
+	static_assert(tinySTL::is_trivially_relocatable<const pod16>::value, "const T follows T");
+	static_assert(tinySTL::is_trivially_relocatable<tinySTL::unique_ptr<int>>::value, "empty default deleter");
+	static_assert(tinySTL::is_trivially_relocatable<tinySTL::unique_ptr<int, stateful_deleter>>::value,
+		"trivially copyable stateful deleter");
+	static_assert(!tinySTL::is_trivially_relocatable<tinySTL::unique_ptr<int, owning_deleter>>::value,
+		"follows the deleter");
+	static_assert(tinySTL::is_trivially_relocatable<tinySTL::shared_ptr<int>>::value, "pointer and control block");
+	static_assert(tinySTL::is_trivially_relocatable<tinySTL::weak_ptr<int>>::value, "pointer and control block");
+	static_assert(tinySTL::is_trivially_relocatable<tinySTL::basic_string<char>>::value, "no short string buffer");
+	static_assert(tinySTL::is_trivially_relocatable<const tinySTL::basic_string<char>>::value, "const T follows T");
+	static_assert(!tinySTL::is_trivially_relocatable<tracked>::value, "user-provided move and destructor");
+	static_assert(!tinySTL::is_trivially_relocatable<const tracked>::value, "const T follows T");
+}
+
+TEST_CASE("[Algorithm] relocate with memmove, including overlapping ranges")
+{
+	int ints[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+	CHECK(tinySTL::uninitialized_relocate(ints, ints + 6, ints + 3) == ints + 9); // forward overlap
+	for (int i = 0; i < 6; ++i)
+		CHECK(ints[3 + i] == i);
+	CHECK(tinySTL::relocate_n(ints + 3, 6, ints + 1) == ints + 7); // backward overlap
+	for (int i = 0; i < 6; ++i)
+		CHECK(ints[1 + i] == i);
+
+	handle::destructions = 0;
+	handle* h = raw_storage<handle>(8);
+	for (int i = 0; i < 5; ++i)
+		::new((void*)(h + i)) handle(i * 10);
+	CHECK(tinySTL::uninitialized_relocate(h, h + 5, h + 2) == h + 7);
+	CHECK(handle::destructions == 0); // moved bytewise, nothing destroyed or double-freed
+	for (int i = 0; i < 5; ++i)
+		CHECK(*h[2 + i].p == i * 10);
+	CHECK(tinySTL::relocate_n(h + 2, 5, h) == h + 5);
+	CHECK(*h[4].p == 40);
+	tinySTL::destroy(h, h + 5);
+	CHECK(handle::destructions == 5);
+	::operator delete(h);
+}
+
+TEST_CASE("[Algorithm] relocate by moving destroys each source exactly once")
+{
+	tracked::reset();
+	tracked* src = raw_storage<tracked>(8);
+	tracked* dst = raw_storage<tracked>(8);
+	for (int i = 0; i < 8; ++i)
+		::new((void*)(src + i)) tracked(i);
+	CHECK(tinySTL::uninitialized_relocate(src, src + 8, dst) == dst + 8);
+	for (int i = 0; i < 8; ++i) {
+		CHECK(tracked::destroyed[i] == 1);      // the sources
+		CHECK(tracked::destroyed[8 + i] == 0);  // the new objects are alive
+		CHECK(dst[i].value == i);
+	}
+
+	CHECK(tinySTL::relocate_n(dst, 8, src) == src + 8);
+	for (int i = 0; i < 8; ++i) {
+		CHECK(tracked::destroyed[8 + i] == 1);
+		CHECK(src[i].value == i);
+	}
+	tinySTL::destroy(src, src + 8);
+	::operator delete(src);
+	::operator delete(dst);
+}
+
+TEST_CASE("[Algorithm] relocate rethrows and unwinds a failed move")
+{
+	tracked::reset();
+	tracked* src = raw_storage<tracked>(8);
+	tracked* dst = raw_storage<tracked>(8);
+	for (int i = 0; i < 8; ++i)
+		::new((void*)(src + i)) tracked(i);
+
+	tracked::throw_after = 3;
+	CHECK_THROWS_AS(tinySTL::uninitialized_relocate(src, src + 8, dst), std::runtime_error);
+	for (int i = 0; i < 3; ++i)
+		CHECK(tracked::destroyed[8 + i] == 1); // the three built destination objects
+	for (int i = 0; i < 8; ++i)
+		CHECK(tracked::destroyed[i] == 0);     // no source was destroyed
+
+	tracked::throw_after = 5;
+	CHECK_THROWS_AS(tinySTL::relocate_n(src, 8, dst), std::runtime_error);
+	for (int i = 0; i < 5; ++i)
+		CHECK(tracked::destroyed[11 + i] == 1);
+	for (int i = 0; i < 8; ++i)
+		CHECK(tracked::destroyed[i] == 0);
+
+	tracked::throw_after = -1;
+	tinySTL::destroy(src, src + 8);
+	::operator delete(src);
+	::operator delete(dst);
+}
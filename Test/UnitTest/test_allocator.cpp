@@ -1,10 +1,38 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
+
+/* count the blocks shm_alloc refuses and the bad heap ids instead of asserting,
+   so the tests can hand them some */
+namespace {
+	int shm_foreign_blocks = 0;
+	int heap_invalid_ids = 0;
+}
+#define TINYSTL_SHM_FOREIGN_BLOCK(p) (void)++shm_foreign_blocks
+#define TINYSTL_HEAP_INVALID_ID(id) (void)++heap_invalid_ids
+
 #include "../../allocator.h"
+#include "../../file_arena.h"
+#include "../../heap_registry.h"
+#include "../../memory_resource.h"
+#include "../../object_pool.h"
+#include "../../shm_arena.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 TEST_CASE("[Allocator] alloc memory for int type")
 {
 	tinySTL::allocator<int> alloc;
@@ -24,8 +52,1659 @@ TEST_CASE("[Allocator] alloc memory for int type")
 
 TEST_CASE("[Allocator] instead of vector's default allocator")
 {
-	/* This allocator<> is incompatible with std... */
-	// int arr[5] = { 0,1,2,3,4 };
-	// std::vector<int, tinySTL::allocator<int>> vec{arr, arr + 5};
-	// CHECK(vec.size() == sizeof(arr) / sizeof(int));
-}
\ No newline at end of file
+	int arr[5] = { 0,1,2,3,4 };
+	std::vector<int, tinySTL::allocator<int>> vec{arr, arr + 5};
+	CHECK(vec.size() == sizeof(arr) / sizeof(int));
+
+	std::vector<int, tinySTL::allocator<int, tinySTL::alloc>> pooled(arr, arr + 5);
+	for (int i = 0; i < 10000; ++i)
+		pooled.push_back(i);
+	CHECK(pooled.size() == 10005);
+	CHECK(pooled[4] == 4);
+	CHECK(pooled.back() == 9999);
+
+	/* all instances are equal, so containers can swap and move their buffers */
+	std::vector<int, tinySTL::allocator<int, tinySTL::alloc>> other;
+	other = std::move(pooled);
+	CHECK(other.size() == 10005);
+	other.swap(pooled);
+	CHECK(pooled.size() == 10005);
+	bool equal = tinySTL::allocator<int, tinySTL::alloc>() == tinySTL::allocator<double, tinySTL::alloc>();
+	CHECK(equal);
+}
+
+TEST_CASE("[Allocator] std node containers on the pools")
+{
+	using pair_type = std::pair<const int, int>;
+	std::map<int, int, std::less<int>, tinySTL::allocator<pair_type, tinySTL::alloc>> ordered;
+	std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+		tinySTL::allocator<pair_type, tinySTL::slab_alloc>> hashed;
+	for (int i = 0; i < 20000; ++i) {
+		ordered[i] = i * 2;
+		hashed.emplace(i, i * 3);
+	}
+	for (int i = 0; i < 20000; i += 2) {
+		ordered.erase(i);
+		hashed.erase(i);
+	}
+	CHECK(ordered.size() == 10000);
+	CHECK(hashed.size() == 10000);
+	CHECK(ordered.begin()->second == 2);
+	CHECK(hashed.at(19999) == 19999 * 3);
+	CHECK(hashed.find(100) == hashed.end());
+
+	/* over-aligned elements keep their alignment inside std containers */
+	struct alignas(32) lane {
+		float v[8];
+	};
+	std::vector<lane, tinySTL::allocator<lane, tinySTL::alloc>> lanes(100);
+	CHECK((uintptr_t)lanes.data() % 32 == 0);
+	std::vector<char, tinySTL::aligned_allocator<char, 64>> bytes(1000);
+	CHECK((uintptr_t)bytes.data() % 64 == 0);
+}
+
+TEST_CASE("[Allocator] default alloc from many threads")
+{
+	const int threadNum = 8;
+	const int loops = 20000;
+	std::vector<std::thread> workers;
+	std::atomic<int> broken{ 0 };
+
+	for (int t = 0; t < threadNum; ++t) {
+		workers.emplace_back([t, &broken]() {
+			std::vector<std::pair<unsigned char*, size_t>> live;
+			for (int i = 0; i < loops; ++i) {
+				size_t n = (size_t)(i % 128) + 1;
+				auto p = static_cast<unsigned char*>(tinySTL::alloc::allocate(n));
+				std::memset(p, t, n);
+				live.emplace_back(p, n);
+				if (live.size() > 64) {
+					for (auto& blk : live) {
+						for (size_t k = 0; k < blk.second; ++k)
+							if (blk.first[k] != (unsigned char)t)
+								++broken;
+						tinySTL::alloc::deallocate(blk.first, blk.second);
+					}
+					live.clear();
+				}
+			}
+			for (auto& blk : live)
+				tinySTL::alloc::deallocate(blk.first, blk.second);
+		});
+	}
+	for (auto& w : workers)
+		w.join();
+
+	CHECK(broken == 0);
+
+	SUBCASE("free in another thread") {
+		std::vector<void*> blocks;
+		for (int i = 0; i < 1000; ++i)
+			blocks.push_back(tinySTL::alloc::allocate(32));
+		std::thread([&blocks]() {
+			for (auto p : blocks)
+				tinySTL::alloc::deallocate(p, 32);
+		}).join();
+		auto p = tinySTL::alloc::allocate(32);
+		CHECK(p);
+		tinySTL::alloc::deallocate(p, 32);
+	}
+}
+
+TEST_CASE("[Allocator] lock-free central free list under contention")
+{
+	const int nodeNum = 256;
+	const int threadNum = 8;
+	std::vector<tinySTL::FreeList> nodes(nodeNum);
+	tinySTL::AtomicFreeList list;
+	for (auto& node : nodes)
+		list.push(&node, &node);
+
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threadNum; ++t) {
+		workers.emplace_back([&list]() {
+			for (int i = 0; i < 100000; ++i) {
+				tinySTL::FreeList* head;
+				tinySTL::FreeList* tail;
+				if (i & 1) {
+					if (list.popBatch(head, tail, 4))
+						list.push(head, tail);
+				}
+				else if (auto p = list.pop()) {
+					list.push(p, p);
+				}
+			}
+		});
+	}
+	for (auto& w : workers)
+		w.join();
+
+	/* every node must come back exactly once */
+	std::vector<int> seen(nodeNum, 0);
+	int total = 0;
+	while (auto p = list.pop()) {
+		++seen[p - nodes.data()];
+		++total;
+	}
+	CHECK(total == nodeNum);
+	CHECK(std::count(seen.begin(), seen.end(), 1) == nodeNum);
+	CHECK(list.empty());
+}
+
+TEST_CASE("[Allocator] trim hands fully freed chunks back")
+{
+	using pool = tinySTL::DefaultAllocTemplate<false, 1>;
+	const size_t burst = 8 * tinySTL::CHUNKBytes / 64;
+
+	std::vector<void*> blocks;
+	for (size_t i = 0; i < burst; ++i)
+		blocks.push_back(pool::allocate(64));
+	for (auto p : blocks)
+		pool::deallocate(p, 64);
+
+	CHECK(pool::trim() >= 8 * (size_t)tinySTL::CHUNKBytes);
+	CHECK(pool::trim() == 0);
+
+	/* released chunks are reused afterwards */
+	auto p = static_cast<char*>(pool::allocate(64));
+	std::memset(p, 0x5a, 64);
+	CHECK(p[63] == 0x5a);
+	pool::deallocate(p, 64);
+
+	SUBCASE("live objects pin their chunk") {
+		using mt_pool = tinySTL::DefaultAllocTemplate<true, 1>;
+		std::vector<void*> objs;
+		for (size_t i = 0; i < burst; ++i)
+			objs.push_back(mt_pool::allocate(32));
+		void* keep = objs[0];
+		for (size_t i = 1; i < objs.size(); ++i)
+			mt_pool::deallocate(objs[i], 32);
+
+		size_t released = mt_pool::trim();
+		CHECK(released > 0);
+		std::memset(keep, 0x11, 32);
+		mt_pool::deallocate(keep, 32);
+		CHECK(mt_pool::trim() == (size_t)tinySTL::CHUNKBytes);
+	}
+}
+
+TEST_CASE("[Allocator] size classes up to MAXBytes come from the pool")
+{
+	using pool = tinySTL::DefaultAllocTemplate<false, 2>;
+	std::vector<std::pair<unsigned char*, size_t>> blocks;
+	for (size_t n = 1; n <= (size_t)tinySTL::MAXBytes; n += (n < 256 ? 1 : n / 7)) {
+		auto p = static_cast<unsigned char*>(pool::allocate(n));
+		std::memset(p, (int)(n & 0xff), n);
+		blocks.emplace_back(p, n);
+	}
+	/* no block may overlap the bytes of another */
+	bool intact = true;
+	for (auto& blk : blocks) {
+		for (size_t k = 0; k < blk.second; ++k)
+			intact = intact && blk.first[k] == (unsigned char)(blk.second & 0xff);
+	}
+	CHECK(intact);
+	for (auto& blk : blocks)
+		pool::deallocate(blk.first, blk.second);
+
+	SUBCASE("freed block is reused for the same class") {
+		void* a = pool::allocate(3000);
+		pool::deallocate(a, 3000);
+		void* b = pool::allocate(2900); // 2560 < 2900, 3000 <= 3072
+		CHECK(a == b);
+		pool::deallocate(b, 2900);
+	}
+}
+
+TEST_CASE("[Allocator] huge page arena carves chunks from aligned regions")
+{
+	using pool = tinySTL::DefaultAllocTemplate<false, 3>;
+	pool::setHugePageArena(true);
+
+	const size_t count = 2 * tinySTL::CHUNKBytes / 64;
+	std::vector<void*> blocks;
+	for (size_t i = 0; i < count; ++i)
+		blocks.push_back(pool::allocate(64));
+
+	/* the very first object sits right behind the header of the region's first chunk */
+	auto first = reinterpret_cast<uintptr_t>(blocks.front());
+	CHECK((first - tinySTL::CHUNKHeader) % tinySTL::HUGEBytes == 0);
+
+	/* later chunks follow inside the same 2 MiB region */
+	auto last = reinterpret_cast<uintptr_t>(blocks.back());
+	CHECK(last / tinySTL::HUGEBytes == first / tinySTL::HUGEBytes);
+
+	for (auto p : blocks)
+		pool::deallocate(p, 64);
+}
+
+TEST_CASE("[Allocator] monotonic arena behind tinySTL::allocator")
+{
+	using int_alloc = tinySTL::allocator<int, tinySTL::arena_alloc>;
+	tinySTL::monotonic_arena<256> arena;
+	const char* inline_begin = static_cast<const char*>(arena.allocate(0, 1));
+	arena.reset();
+
+	{
+		tinySTL::arena_scope scope(arena);
+		int* a = int_alloc::allocate(16);
+		int* b = int_alloc::allocate(16);
+		CHECK(reinterpret_cast<char*>(a) == inline_begin);
+		CHECK(b == a + 16);
+		int_alloc::deallocate(a, 16); // no-op, memory stays in use
+		CHECK(int_alloc::allocate(1) == b + 16);
+
+		/* overflow goes to the heap */
+		int* big = int_alloc::allocate(1024);
+		const char* p = reinterpret_cast<const char*>(big);
+		CHECK((p < inline_begin || p >= inline_begin + 256));
+		for (int i = 0; i < 1024; ++i)
+			big[i] = i;
+		CHECK(big[1023] == 1023);
+	}
+
+	/* the scope reset the arena: the inline buffer is handed out again */
+	CHECK(tinySTL::arena_alloc::get_arena() == nullptr);
+	CHECK(arena.allocate(8) == inline_begin);
+	CHECK_THROWS(int_alloc::allocate(1));
+
+	SUBCASE("heap-only arena keeps its first block across reset") {
+		tinySTL::monotonic_arena<> heap_arena;
+		void* first = heap_arena.allocate(64);
+		for (int i = 0; i < 100; ++i)
+			heap_arena.allocate(1000);
+		heap_arena.reset();
+		CHECK(heap_arena.allocate(64) == first);
+	}
+}
+
+TEST_CASE("[Allocator] statistics snapshot")
+{
+	using pool = tinySTL::DefaultAllocTemplate<false, 4>;
+	pool::setStatsEnabled(true);
+
+	std::vector<void*> blocks;
+	for (int i = 0; i < 10; ++i)
+		blocks.push_back(pool::allocate(24));
+	for (int i = 0; i < 4; ++i)
+		pool::deallocate(blocks[i], 24);
+	void* large = pool::allocate(tinySTL::MAXBytes + 1);
+	pool::deallocate(large, tinySTL::MAXBytes + 1);
+
+	tinySTL::AllocStats stats = pool::getStats();
+	const tinySTL::AllocStats::SizeClass* cls = nullptr;
+	for (auto& c : stats.classes) {
+		if (c.size == 24)
+			cls = &c;
+	}
+	REQUIRE(cls != nullptr);
+	CHECK(cls->allocs == 10);
+	CHECK(cls->frees == 4);
+	CHECK(cls->freeObjects == 20 - 10 + 4); // one refill of 20 objects
+	CHECK(stats.reFills == 1);
+	CHECK(stats.chunkAllocs == 1);
+	CHECK(stats.oomMallocs == 0);
+	CHECK(stats.largeAllocs == 1);
+	CHECK(stats.largeFrees == 1);
+	CHECK(stats.heapSize == tinySTL::CHUNKBytes);
+	CHECK(stats.residentBytes == stats.heapSize);
+	CHECK(stats.poolBytes == tinySTL::CHUNKBytes - tinySTL::CHUNKHeader - 20 * 24);
+	CHECK(stats.idleBytes == 14 * 24);
+	CHECK(stats.peakIdleBytes >= stats.idleBytes);
+
+	/* the JSON dump starts with the global numbers */
+	FILE* f = std::tmpfile();
+	REQUIRE(f != nullptr);
+	stats.printJson(f);
+	std::rewind(f);
+	char buf[64] = { 0 };
+	CHECK(std::fgets(buf, sizeof(buf), f) != nullptr);
+	CHECK(std::strncmp(buf, "{\"heapSize\":262144", 18) == 0);
+	std::fclose(f);
+
+	for (int i = 4; i < 10; ++i)
+		pool::deallocate(blocks[i], 24);
+}
+
+TEST_CASE("[Allocator] statistics keep the counters of exited threads")
+{
+	using pool = tinySTL::DefaultAllocTemplate<true, 4>;
+	pool::setStatsEnabled(true);
+	std::vector<std::thread> workers;
+	for (int t = 0; t < 4; ++t) {
+		workers.emplace_back([]() {
+			void* p[100];
+			for (auto& q : p)
+				q = pool::allocate(64);
+			for (auto q : p)
+				pool::deallocate(q, 64);
+		});
+	}
+	for (auto& w : workers)
+		w.join();
+	tinySTL::AllocStats stats = pool::getStats();
+	size_t idle = 0;
+	for (auto& c : stats.classes) {
+		if (c.size == 64) {
+			CHECK(c.allocs == 400);
+			CHECK(c.frees == 400);
+			CHECK(c.freeObjects >= 100); // every thread cache went back to the central list
+		}
+		idle += c.freeObjects * c.size; // so did the rest of each thread's carving region
+	}
+	CHECK(stats.idleBytes == idle);
+}
+
+TEST_CASE("[Allocator] sampling heap profiler")
+{
+	using profiler = tinySTL::heap_profiler;
+	using int_alloc = tinySTL::allocator<int, tinySTL::alloc>;
+	const size_t live_before = profiler::liveSamples();
+
+	SUBCASE("every allocation is sampled at rate 1") {
+		profiler::setSampleRate(1);
+		int_alloc::deallocate(int_alloc::allocate(100), 100); // the first one only starts the clock
+		std::vector<int*> blocks;
+		for (int i = 0; i < 50; ++i)
+			blocks.push_back(int_alloc::allocate(100));
+		profiler::setSampleRate(0);
+		CHECK(profiler::liveSamples() == live_before + 50);
+
+		FILE* f = std::tmpfile();
+		REQUIRE(f != nullptr);
+		profiler::dumpPprof(f);
+		std::rewind(f);
+		char buf[128] = { 0 };
+		CHECK(std::fgets(buf, sizeof(buf), f) != nullptr);
+		CHECK(std::strncmp(buf, "heap profile: ", 14) == 0);
+		CHECK(std::strstr(buf, "@ heap_v2/") != nullptr);
+		CHECK(std::fgets(buf, sizeof(buf), f) != nullptr);
+		CHECK(std::strncmp(buf, "1: 400 [1: 400] @ 0x", 20) == 0);
+		std::fclose(f);
+
+		for (auto p : blocks)
+			int_alloc::deallocate(p, 100);
+		CHECK(profiler::liveSamples() == live_before);
+	}
+
+	SUBCASE("sampled bytes estimate the live heap") {
+		profiler::setSampleRate(4096);
+		const size_t count = 100000;
+		std::vector<int*> blocks;
+		blocks.reserve(count);
+		for (size_t i = 0; i < count; ++i)
+			blocks.push_back(int_alloc::allocate(16));
+		profiler::setSampleRate(0);
+
+		double expected = (double)count * 16 * sizeof(int);
+		double estimated = (double)profiler::liveBytes();
+		CHECK(estimated > expected * 0.8);
+		CHECK(estimated < expected * 1.2);
+
+		for (auto p : blocks)
+			int_alloc::deallocate(p, 16);
+		CHECK(profiler::liveSamples() == live_before);
+	}
+}
+
+namespace
+{
+	struct alignas(64) padded_counter {
+		std::atomic<long> value;
+	};
+
+	struct alignas(32) simd_block {
+		float lanes[8];
+	};
+
+	template <typename T>
+	bool is_aligned(T* p, size_t align) {
+		return reinterpret_cast<uintptr_t>(p) % align == 0;
+	}
+
+	template <size_t Align, typename Alloc>
+	void check_aligned_allocator() {
+		using byte_alloc = tinySTL::aligned_allocator<char, Align, Alloc>;
+		const size_t sizes[] = { 1, 8, 24, 100, 200, 1000, 5000, 40000 };
+		std::vector<std::pair<char*, size_t>> blocks;
+		for (int round = 0; round < 50; ++round) {
+			for (size_t n : sizes) {
+				char* p = byte_alloc::allocate(n);
+				CHECK(is_aligned(p, Align));
+				std::memset(p, 0x5a, n);
+				blocks.emplace_back(p, n);
+			}
+		}
+		for (auto& b : blocks)
+			byte_alloc::deallocate(b.first, b.second);
+	}
+}
+
+TEST_CASE("[Allocator] over-aligned allocation")
+{
+	using pool = tinySTL::DefaultAllocTemplate<false, 5>;
+
+	SUBCASE("aligned_allocator on every backend") {
+		check_aligned_allocator<16, pool>();
+		check_aligned_allocator<32, pool>();
+		check_aligned_allocator<64, pool>();
+		check_aligned_allocator<4096, pool>();
+		check_aligned_allocator<32, tinySTL::alloc>();
+		check_aligned_allocator<64, tinySTL::malloc_alloc>();
+		check_aligned_allocator<256, tinySTL::malloc_alloc>();
+		check_aligned_allocator<64, tinySTL::new_alloc<char>>();
+		check_aligned_allocator<128, tinySTL::new_alloc<char>>();
+
+		tinySTL::monotonic_arena<100> arena;
+		tinySTL::arena_scope scope(arena);
+		check_aligned_allocator<64, tinySTL::arena_alloc>();
+	}
+
+	SUBCASE("allocator respects alignof(T)") {
+		for (int i = 0; i < 100; ++i) {
+			/* odd-sized neighbours keep startFree off the cache line */
+			void* odd = pool::allocate(24);
+			padded_counter* c = tinySTL::allocator<padded_counter, pool>::allocate(3);
+			simd_block* v = tinySTL::allocator<simd_block, pool>::allocate();
+			CHECK(is_aligned(c, 64));
+			CHECK(is_aligned(v, 32));
+			tinySTL::allocator<simd_block, pool>::deallocate(v);
+			tinySTL::allocator<padded_counter, pool>::deallocate(c, 3);
+			pool::deallocate(odd, 24);
+		}
+
+		simd_block* m = tinySTL::allocator<simd_block, tinySTL::malloc_alloc>::allocate(5);
+		CHECK(is_aligned(m, 32));
+		tinySTL::allocator<simd_block, tinySTL::malloc_alloc>::deallocate(m, 5);
+		padded_counter* n = tinySTL::allocator<padded_counter>::allocate(2); // new_alloc
+		CHECK(is_aligned(n, 64));
+		tinySTL::allocator<padded_counter>::deallocate(n, 2);
+	}
+
+	SUBCASE("aligned requests come from size classes, not over-allocation") {
+		void* a = pool::allocate(40, 64);
+		pool::deallocate(a, 40, 64);
+		void* b = pool::allocate(64); // the same 64-byte class
+		CHECK(a == b);
+		CHECK(is_aligned(b, 64));
+		pool::deallocate(b, 64);
+	}
+}
+
+TEST_CASE("[Allocator] in-place expansion and reallocate")
+{
+	using pool = tinySTL::DefaultAllocTemplate<false, 6>;
+	using byte_alloc = tinySTL::allocator<char, pool>;
+
+	SUBCASE("same size class grows in place") {
+		char* p = byte_alloc::allocate(130); // 160-byte class
+		CHECK(byte_alloc::try_expand(p, 130, 160));
+		CHECK_FALSE(byte_alloc::try_expand(p, 160, 161));
+		std::memset(p, 'a', 160);
+		char* q = byte_alloc::reallocate(p, 160, 1000);
+		CHECK(q[0] == 'a');
+		CHECK(q[159] == 'a');
+		byte_alloc::deallocate(q, 1000);
+	}
+
+	SUBCASE("mapped blocks grow with mremap and keep their contents") {
+		const size_t mib = 1024 * 1024;
+		char* p = byte_alloc::allocate(2 * mib);
+		for (size_t i = 0; i < 2 * mib; i += 4096)
+			p[i] = (char)(i / 4096);
+		char* q = byte_alloc::reallocate(p, 2 * mib, 64 * mib);
+		bool same = true;
+		for (size_t i = 0; i < 2 * mib; i += 4096)
+			same = same && q[i] == (char)(i / 4096);
+		CHECK(same);
+		q[64 * mib - 1] = 'z';
+		/* shrinking a mapped block always succeeds in place */
+		CHECK(byte_alloc::try_expand(q, 64 * mib, 8 * mib));
+		byte_alloc::deallocate(q, 8 * mib);
+	}
+
+	SUBCASE("malloc_alloc and new_alloc backends") {
+		using malloc_bytes = tinySTL::allocator<char, tinySTL::malloc_alloc>;
+		char* p = malloc_bytes::allocate(100);
+		std::strcpy(p, "tinySTL");
+		p = malloc_bytes::reallocate(p, 100, 100000);
+		CHECK(std::strcmp(p, "tinySTL") == 0);
+		malloc_bytes::deallocate(p, 100000);
+
+		using new_ints = tinySTL::allocator<int>;
+		int* a = new_ints::allocate(4);
+		for (int i = 0; i < 4; ++i)
+			a[i] = i;
+		CHECK_FALSE(new_ints::try_expand(a, 4, 8));
+		a = new_ints::reallocate(a, 4, 8);
+		CHECK(a[3] == 3);
+		new_ints::deallocate(a, 8);
+	}
+
+	SUBCASE("the last arena allocation grows in place") {
+		tinySTL::monotonic_arena<1024> arena;
+		tinySTL::arena_scope scope(arena);
+		using arena_bytes = tinySTL::allocator<char, tinySTL::arena_alloc>;
+		char* a = arena_bytes::allocate(100);
+		CHECK(arena_bytes::try_expand(a, 100, 496));
+		char* b = arena_bytes::allocate(10);
+		CHECK(b == a + 496);
+		CHECK_FALSE(arena_bytes::try_expand(a, 496, 600));
+	}
+}
+
+TEST_CASE("[Allocator] batch allocate and deallocate")
+{
+	struct node {
+		node* next;
+		long value;
+	};
+
+	SUBCASE("single client pool") {
+		using pool = tinySTL::DefaultAllocTemplate<false, 7>;
+		using node_alloc = tinySTL::allocator<node, pool>;
+		const size_t count = 10000;
+		std::vector<node*> nodes(count);
+		node_alloc::allocate_batch(count, nodes.data());
+		for (size_t i = 0; i < count; ++i) {
+			nodes[i]->next = i + 1 < count ? nodes[i + 1] : nullptr;
+			nodes[i]->value = (long)i;
+		}
+		std::vector<node*> sorted(nodes);
+		std::sort(sorted.begin(), sorted.end());
+		CHECK(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+		long sum = 0;
+		for (node* p = nodes[0]; p; p = p->next)
+			sum += p->value;
+		CHECK(sum == (long)(count * (count - 1) / 2));
+
+		node_alloc::deallocate_batch(nodes.data(), count);
+		/* the whole batch is back on the free list */
+		std::vector<node*> again(count);
+		node_alloc::allocate_batch(count, again.data());
+		std::sort(again.begin(), again.end());
+		CHECK(again == sorted);
+		node_alloc::deallocate_batch(again.data(), count);
+	}
+
+	SUBCASE("thread cached pool and the per-object fallback") {
+		using node_alloc = tinySTL::allocator<node, tinySTL::alloc>;
+		node* some[100];
+		node_alloc::allocate_batch(100, some);
+		for (auto p : some)
+			p->value = 1;
+		node_alloc::deallocate_batch(some, 100);
+
+		using new_node_alloc = tinySTL::allocator<node>;
+		new_node_alloc::allocate_batch(100, some);
+		for (auto p : some)
+			p->value = 2;
+		new_node_alloc::deallocate_batch(some, 100);
+	}
+}
+
+TEST_CASE("[Allocator] objects freed by another thread go back to their owner")
+{
+	using pool = tinySTL::DefaultAllocTemplate<true, 8>;
+	const int count = 1000;
+	std::vector<void*> blocks(count);
+	for (auto& p : blocks)
+		p = pool::allocate(48);
+	std::thread consumer([&blocks]() {
+		for (auto p : blocks)
+			pool::deallocate(p, 48);
+	});
+	consumer.join();
+
+	/* the producer gets the blocks back after what is left in its own cache, without carving anything new */
+	size_t cached = 0;
+	for (auto& c : pool::getStats().classes) {
+		if (c.size == 48)
+			cached = c.cachedObjects;
+	}
+	std::vector<void*> again(count);
+	for (auto& p : again)
+		p = pool::allocate(48);
+	std::sort(blocks.begin(), blocks.end());
+	std::sort(again.begin(), again.end());
+	std::vector<void*> returned;
+	std::set_intersection(again.begin(), again.end(), blocks.begin(), blocks.end(), std::back_inserter(returned));
+	CHECK(returned.size() == count - cached);
+	CHECK(pool::getStats().heapSize == tinySTL::CHUNKBytes);
+
+	/* objects freed after the owner exited still find their way back */
+	std::thread producer([&blocks]() {
+		for (auto& p : blocks)
+			p = pool::allocate(48);
+	});
+	producer.join();
+	for (auto p : blocks)
+		pool::deallocate(p, 48);
+	for (auto p : again)
+		pool::deallocate(p, 48);
+	CHECK(pool::trim() > 0);
+}
+
+namespace
+{
+	/* a cache living on top of a budgeted pool, shedding its blocks under pressure */
+	template <typename Pool>
+	struct block_cache {
+		std::vector<void*> blocks;
+		int soft_calls = 0;
+		int hard_calls = 0;
+
+		static size_t shrink(int level, size_t want, void* arg) {
+			block_cache* c = (block_cache*)arg;
+			++(level == tinySTL::MemoryBudget::SOFTLevel ? c->soft_calls : c->hard_calls);
+			size_t freed = 0;
+			while (freed < want && !c->blocks.empty()) {
+				Pool::deallocate(c->blocks.back(), 4096);
+				c->blocks.pop_back();
+				freed += 4096;
+			}
+			return freed;
+		}
+	};
+}
+
+TEST_CASE("[Allocator] memory budget sheds cached blocks before failing")
+{
+	using pool = tinySTL::DefaultAllocTemplate<false, 9>;
+	tinySTL::MemoryBudget& budget = pool::getBudget();
+	const size_t soft = 2 * tinySTL::CHUNKBytes;
+	const size_t hard = 4 * tinySTL::CHUNKBytes;
+	budget.setLimits(soft, hard);
+	block_cache<pool> cache;
+	int id = budget.addCallback(block_cache<pool>::shrink, &cache);
+	REQUIRE(id >= 0);
+
+	/* the cache keeps growing, crossing the soft limit makes it shed early */
+	for (int i = 0; i < 2000; ++i) {
+		cache.blocks.push_back(pool::allocate(4096));
+		CHECK(budget.used() <= hard);
+	}
+	CHECK(cache.soft_calls >= 1);
+	CHECK(cache.hard_calls == 0);
+	CHECK(cache.blocks.size() < 2000);
+
+	/* with only a hard limit it sheds when the next chunk would not fit */
+	budget.setLimits(0, hard);
+	for (int i = 0; i < 2000; ++i) {
+		cache.blocks.push_back(pool::allocate(4096));
+		CHECK(budget.used() <= hard);
+	}
+	CHECK(cache.hard_calls >= 1);
+
+	/* without anybody to shed memory the hard limit is final */
+	budget.removeCallback(id);
+	std::vector<void*> rest;
+	bool refused = false;
+	try {
+		for (int i = 0; i < 2000; ++i)
+			rest.push_back(pool::allocate(4096));
+	}
+	catch (const std::bad_alloc&) {
+		refused = true;
+	}
+	CHECK(refused);
+	CHECK(budget.used() <= hard);
+	CHECK_THROWS(pool::allocate(hard));
+
+	for (auto p : rest)
+		pool::deallocate(p, 4096);
+	for (auto p : cache.blocks)
+		pool::deallocate(p, 4096);
+	pool::trim();
+	CHECK(budget.used() == 0);
+
+	/* large blocks are charged and given back too */
+	budget.setLimits(0, 0);
+	void* big = pool::allocate(2 * tinySTL::MMAPBytes);
+	CHECK(budget.used() == 2 * tinySTL::MMAPBytes);
+	pool::deallocate(big, 2 * tinySTL::MMAPBytes);
+	CHECK(budget.used() == 0);
+}
+
+namespace
+{
+	/* owns a heap buffer, so constructing and destroying it is not free */
+	struct pooled_buffer {
+		static int constructed;
+		static int destroyed;
+		std::vector<char> bytes;
+		int id = 0;
+
+		pooled_buffer() : bytes() { bytes.reserve(256); ++constructed; }
+		explicit pooled_buffer(int i) : pooled_buffer() { id = i; }
+		~pooled_buffer() { ++destroyed; }
+	};
+	int pooled_buffer::constructed = 0;
+	int pooled_buffer::destroyed = 0;
+
+	struct reset_buffer {
+		void operator()(pooled_buffer& b) const {
+			b.bytes.clear();
+			b.id = 0;
+		}
+	};
+
+	struct large_record {
+		double values[35];
+		long id;
+	};
+}
+
+TEST_CASE("[Allocator] object pool keeps released objects constructed")
+{
+	using pool = tinySTL::ObjectPoolTemplate<pooled_buffer, reset_buffer, tinySTL::alloc, 1>;
+	pooled_buffer::constructed = pooled_buffer::destroyed = 0;
+	pooled_buffer* a = pool::acquire();
+	a->bytes.assign(100, 'x');
+	a->id = 7;
+	const char* storage = a->bytes.data();
+	pool::release(a);
+	CHECK(pooled_buffer::destroyed == 0);
+
+	/* the same object comes back reset, with its buffer still allocated */
+	pooled_buffer* b = pool::acquire();
+	CHECK(b == a);
+	CHECK(b->bytes.empty());
+	CHECK(b->id == 0);
+	CHECK(b->bytes.data() == storage);
+	CHECK(pooled_buffer::constructed == 1);
+
+	/* constructor arguments always build a fresh object */
+	pooled_buffer* c = pool::acquire(3);
+	CHECK(c->id == 3);
+	CHECK(pooled_buffer::constructed == 2);
+	pool::release(b);
+	pool::release(c);
+
+	/* reserve builds the objects up front */
+	pool::reserve(100);
+	CHECK(pooled_buffer::constructed == 102);
+	std::vector<pooled_buffer*> many;
+	for (int i = 0; i < 102; ++i)
+		many.push_back(pool::acquire());
+	CHECK(pooled_buffer::constructed == 102);
+	for (auto p : many)
+		pool::release(p);
+
+	CHECK(pool::trim() > 0);
+	CHECK(pooled_buffer::destroyed == 102);
+}
+
+TEST_CASE("[Allocator] object pool without reset destroys on release")
+{
+	using pool = tinySTL::ObjectPoolTemplate<pooled_buffer, void, tinySTL::alloc, 2>;
+	pooled_buffer::constructed = pooled_buffer::destroyed = 0;
+	pooled_buffer* a = pool::acquire(5);
+	CHECK(a->id == 5);
+	pool::release(a);
+	CHECK(pooled_buffer::destroyed == 1);
+	/* the slot is reused, the object is built again */
+	pooled_buffer* b = pool::acquire();
+	CHECK(b == a);
+	CHECK(pooled_buffer::constructed == 2);
+	pool::release(b);
+}
+
+TEST_CASE("[Allocator] object pool carves large objects from its own slabs")
+{
+	using pool = tinySTL::ObjectPoolTemplate<large_record, void, tinySTL::alloc, 3>;
+	std::vector<std::thread> workers;
+	std::vector<std::vector<large_record*>> kept(4);
+	for (int t = 0; t < 4; ++t) {
+		workers.emplace_back([t, &kept]() {
+			for (int round = 0; round < 10; ++round) {
+				large_record* p[100];
+				for (int i = 0; i < 100; ++i) {
+					p[i] = pool::acquire();
+					p[i]->id = t * 1000 + i;
+				}
+				for (int i = 0; i < 100; ++i) {
+					CHECK(p[i]->id == t * 1000 + i);
+					pool::release(p[i]);
+				}
+			}
+			for (int i = 0; i < 50; ++i)
+				kept[t].push_back(pool::acquire());
+		});
+	}
+	for (auto& w : workers)
+		w.join();
+
+	std::vector<large_record*> all;
+	for (auto& v : kept)
+		all.insert(all.end(), v.begin(), v.end());
+	std::sort(all.begin(), all.end());
+	CHECK(std::adjacent_find(all.begin(), all.end()) == all.end());
+	for (auto p : all) {
+		CHECK((uintptr_t)p % alignof(large_record) == 0);
+		pool::release(p);
+	}
+	/* slab slots are packed at their exact size (8 + 288), not at the 320-byte size class */
+	size_t gap = SIZE_MAX;
+	for (size_t i = 1; i < all.size(); ++i)
+		gap = std::min(gap, (size_t)((char*)all[i] - (char*)all[i - 1]));
+	CHECK(gap == 8 + sizeof(large_record));
+	CHECK(pool::trim() == 0);
+}
+
+TEST_CASE("[Allocator] slab backend reuses the fullest slab from its lowest slot")
+{
+	using slab = tinySTL::SlabAllocTemplate<false, 1>;
+	const size_t size = 32;
+	std::vector<char*> blocks;
+	/* fill three slabs exactly, the first block of a fourth one is given back at once */
+	auto slab_of = [](char* p) { return (uintptr_t)p / tinySTL::SLABBytes; };
+	int slabs = 1;
+	while (true) {
+		char* p = (char*)slab::allocate(size);
+		if (!blocks.empty() && slab_of(p) != slab_of(blocks.back()) && ++slabs == 4) {
+			slab::deallocate(p, size);
+			break;
+		}
+		blocks.push_back(p);
+	}
+	const size_t per_slab = blocks.size() / 3;
+	REQUIRE(blocks.size() == 3 * per_slab);
+	/* inside a slab blocks come out in address order */
+	CHECK(std::is_sorted(blocks.begin(), blocks.begin() + per_slab));
+
+	/* free 10 blocks from the first slab and 100 from the second, in scattered order */
+	std::vector<char*> first, second;
+	for (size_t i = 0; i < 10; ++i)
+		first.push_back(blocks[(i * 37) % per_slab]);
+	for (size_t i = 0; i < 100; ++i)
+		second.push_back(blocks[per_slab + (i * 7) % per_slab]);
+	for (auto p : first)
+		slab::deallocate(p, size);
+	for (auto p : second)
+		slab::deallocate(p, size);
+
+	/* the fuller first slab is refilled first, lowest address first */
+	std::sort(first.begin(), first.end());
+	std::sort(second.begin(), second.end());
+	for (size_t i = 0; i < first.size(); ++i)
+		CHECK(slab::allocate(size) == first[i]);
+	CHECK(slab::allocate(size) == second[0]);
+	slab::deallocate(second[0], size);
+
+	/* an emptied slab goes back whole: one is kept as a spare, trim releases it */
+	for (size_t i = 0; i < per_slab; ++i) {
+		if (!std::binary_search(second.begin(), second.end(), blocks[per_slab + i]))
+			slab::deallocate(blocks[per_slab + i], size);
+	}
+	for (size_t i = 0; i < per_slab; ++i)
+		slab::deallocate(blocks[2 * per_slab + i], size);
+	CHECK(slab::trim() == tinySTL::SLABBytes);
+	CHECK(slab::trim() == 0);
+	for (size_t i = 0; i < per_slab; ++i)
+		slab::deallocate(blocks[i], size);
+}
+
+TEST_CASE("[Allocator] slab backend from many threads")
+{
+	struct node {
+		node* next;
+		long value;
+	};
+	using node_alloc = tinySTL::allocator<node, tinySTL::slab_alloc>;
+	std::vector<std::thread> workers;
+	std::vector<std::vector<node*>> kept(4);
+	for (int t = 0; t < 4; ++t) {
+		workers.emplace_back([t, &kept]() {
+			std::vector<node*> live;
+			for (int i = 0; i < 20000; ++i) {
+				if (!live.empty() && i % 3 == 0) {
+					node_alloc::deallocate(live[(size_t)i % live.size()]);
+					live[(size_t)i % live.size()] = live.back();
+					live.pop_back();
+				}
+				node* p = node_alloc::allocate();
+				p->value = t;
+				live.push_back(p);
+			}
+			for (auto p : live)
+				CHECK(p->value == t);
+			kept[t] = live;
+		});
+	}
+	for (auto& w : workers)
+		w.join();
+	std::vector<node*> all;
+	for (auto& v : kept)
+		all.insert(all.end(), v.begin(), v.end());
+	std::sort(all.begin(), all.end());
+	CHECK(std::adjacent_find(all.begin(), all.end()) == all.end());
+	for (auto p : all)
+		node_alloc::deallocate(p);
+	/* a big object goes to the default pool */
+	void* big = tinySTL::slab_alloc::allocate(1000);
+	tinySTL::slab_alloc::deallocate(big, 1000);
+}
+
+/* forwards to new/delete and keeps count of what is still outstanding */
+class counting_resource : public tinySTL::memory_resource {
+public:
+	size_t outstanding = 0;
+	size_t calls = 0;
+
+protected:
+	void* do_allocate(size_t bytes, size_t align) override {
+		outstanding += bytes;
+		++calls;
+		return tinySTL::new_delete_resource()->allocate(bytes, align);
+	}
+
+	void do_deallocate(void* p, size_t bytes, size_t align) override {
+		outstanding -= bytes;
+		tinySTL::new_delete_resource()->deallocate(p, bytes, align);
+	}
+};
+
+TEST_CASE("[Allocator] monotonic buffer resource")
+{
+	counting_resource upstream;
+	alignas(64) char buffer[256];
+	tinySTL::monotonic_buffer_resource mono(buffer, sizeof(buffer), &upstream);
+
+	char* a = (char*)mono.allocate(100, 8);
+	char* b = (char*)mono.allocate(10, 32);
+	CHECK(a == buffer);
+	CHECK(b >= a + 100);
+	CHECK((uintptr_t)b % 32 == 0);
+	CHECK(upstream.calls == 0);
+
+	/* the buffer runs out, later blocks come from upstream and grow */
+	for (int i = 0; i < 100; ++i) {
+		void* p = mono.allocate(64, 16);
+		CHECK((uintptr_t)p % 16 == 0);
+		mono.deallocate(p, 64, 16);
+	}
+	CHECK(upstream.calls > 0);
+	CHECK(upstream.calls < 6);
+	CHECK(upstream.outstanding > 0);
+
+	mono.release();
+	CHECK(upstream.outstanding == 0);
+	CHECK(mono.allocate(8, 8) == buffer);
+
+	tinySTL::monotonic_buffer_resource bounded(buffer, sizeof(buffer), tinySTL::null_memory_resource());
+	bool thrown = false;
+	try {
+		bounded.allocate(1000);
+	}
+	catch (const std::bad_alloc&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+}
+
+TEST_CASE("[Allocator] pool resource reuses blocks and releases everything")
+{
+	counting_resource upstream;
+	{
+		tinySTL::unsynchronized_pool_resource pool(&upstream);
+		CHECK(pool.options().largest_required_pool_block == (size_t)tinySTL::MAXBytes);
+
+		void* a = pool.allocate(24, 8);
+		pool.deallocate(a, 24, 8);
+		CHECK(pool.allocate(20, 4) == a); // the same size class
+		size_t calls = upstream.calls;
+
+		std::vector<std::pair<void*, size_t>> blocks;
+		for (size_t n = 1; n < 3000; n += 37) {
+			size_t align = (size_t)1 << (n % 7);
+			unsigned char* p = (unsigned char*)pool.allocate(n, align);
+			CHECK((uintptr_t)p % align == 0);
+			std::memset(p, (int)(n & 0xff), n);
+			blocks.emplace_back(p, n);
+		}
+		for (auto& b : blocks) {
+			unsigned char* p = (unsigned char*)b.first;
+			CHECK(p[0] == (unsigned char)(b.second & 0xff));
+			CHECK(p[b.second - 1] == (unsigned char)(b.second & 0xff));
+		}
+		CHECK(upstream.calls > calls);
+
+		/* oversized and over-aligned requests go straight upstream */
+		void* big = pool.allocate(100000, 8);
+		void* wide = pool.allocate(100, 256);
+		CHECK((uintptr_t)wide % 256 == 0);
+		pool.deallocate(wide, 100, 256);
+		size_t before = upstream.outstanding;
+		pool.deallocate(big, 100000, 8);
+		CHECK(upstream.outstanding < before - 100000 + 64);
+
+		for (size_t i = 0; i < blocks.size(); i += 2)
+			pool.deallocate(blocks[i].first, blocks[i].second, (size_t)1 << (blocks[i].second % 7));
+		pool.allocate(200000, 16); // still live when the pool goes away
+	}
+	CHECK(upstream.outstanding == 0);
+}
+
+TEST_CASE("[Allocator] synchronized pool resource from many threads")
+{
+	counting_resource upstream;
+	tinySTL::synchronized_pool_resource pool(&upstream);
+	std::vector<std::thread> workers;
+	std::atomic<int> bad(0);
+	for (int t = 0; t < 4; ++t) {
+		workers.emplace_back([t, &pool, &bad]() {
+			std::vector<std::pair<unsigned char*, size_t>> live;
+			for (int i = 0; i < 20000; ++i) {
+				size_t n = 8 + (size_t)((i * 13 + t) % 300);
+				unsigned char* p = (unsigned char*)pool.allocate(n, 8);
+				std::memset(p, t, n);
+				live.emplace_back(p, n);
+				if (i % 2) {
+					auto victim = live[(size_t)i % live.size()];
+					if (victim.first[0] != t || victim.first[victim.second - 1] != t)
+						++bad;
+					pool.deallocate(victim.first, victim.second, 8);
+					live[(size_t)i % live.size()] = live.back();
+					live.pop_back();
+				}
+			}
+			for (auto& b : live)
+				pool.deallocate(b.first, b.second, 8);
+		});
+	}
+	for (auto& w : workers)
+		w.join();
+	CHECK(bad == 0);
+	pool.release();
+	CHECK(upstream.outstanding == 0);
+}
+
+TEST_CASE("[Allocator] polymorphic allocator propagates to nested containers")
+{
+	using pmr_string = std::basic_string<char, std::char_traits<char>, tinySTL::polymorphic_allocator<char>>;
+	counting_resource upstream;
+	tinySTL::unsynchronized_pool_resource pool(&upstream);
+	{
+		std::vector<pmr_string, tinySTL::polymorphic_allocator<pmr_string>> names(&pool);
+		for (int i = 0; i < 100; ++i)
+			names.emplace_back(std::string(40, (char)('a' + i % 26)).c_str());
+		for (auto& s : names)
+			CHECK(s.get_allocator().resource() == &pool);
+		CHECK(names[3] == pmr_string(40, 'd'));
+
+		using pmr_map = std::map<int, pmr_string, std::less<int>,
+			tinySTL::polymorphic_allocator<std::pair<const int, pmr_string>>>;
+		pmr_map index(&pool);
+		for (int i = 0; i < 50; ++i)
+			index[i] = names[i];
+		index.emplace(100, "a string long enough to leave the small buffer");
+		for (auto& kv : index)
+			CHECK(kv.second.get_allocator().resource() == &pool);
+		CHECK(index[7] == names[7]);
+
+		/* a copy uses the default resource */
+		auto copy = names;
+		CHECK(copy.get_allocator().resource() == tinySTL::get_default_resource());
+		CHECK(copy[5] == names[5]);
+		CHECK(upstream.outstanding > 0);
+	}
+	pool.release();
+	CHECK(upstream.outstanding == 0);
+
+	tinySTL::polymorphic_allocator<int> a(&pool), b(&pool);
+	tinySTL::polymorphic_allocator<double> c(a);
+	tinySTL::polymorphic_allocator<int> d;
+	CHECK(a == b);
+	CHECK(a == c);
+	CHECK(a != d);
+}
+
+TEST_CASE("[Allocator] resource scope behind tinySTL::allocator")
+{
+	struct node {
+		node* next;
+		int value;
+	};
+	using node_alloc = tinySTL::allocator<node, tinySTL::resource_alloc>;
+	counting_resource upstream;
+	tinySTL::monotonic_buffer_resource request(&upstream);
+	{
+		tinySTL::resource_scope scope(request);
+		CHECK(tinySTL::resource_alloc::get_resource() == &request);
+		node* head = nullptr;
+		for (int i = 0; i < 1000; ++i) {
+			node* n = node_alloc::allocate();
+			n->next = head;
+			n->value = i;
+			head = n;
+		}
+		int sum = 0;
+		for (node* n = head; n; n = n->next)
+			sum += n->value;
+		CHECK(sum == 999 * 1000 / 2);
+		CHECK(upstream.outstanding >= 1000 * sizeof(node));
+	}
+	CHECK(tinySTL::resource_alloc::get_resource() == tinySTL::get_default_resource());
+	request.release();
+	CHECK(upstream.outstanding == 0);
+}
+
+TEST_CASE("[Allocator] named heaps keep their own pools and statistics")
+{
+	using registry = tinySTL::heap_registry;
+	const int network = registry::open("network");
+	const int parser = registry::open("parser");
+	REQUIRE(network >= 0);
+	REQUIRE(parser >= 0);
+	CHECK(network != parser);
+	CHECK(registry::open("network") == network);
+	CHECK(registry::find("parser") == parser);
+	CHECK(registry::find("nobody") == -1);
+	CHECK(std::strcmp(registry::getName(network), "network") == 0);
+	CHECK(registry::open("a name that is far too long for the table") == -1);
+
+	/* a compile-time heap gets its name at a fixed id */
+	CHECK(registry::open("cache", 9));
+	CHECK_FALSE(registry::open("other", 9));
+	CHECK_FALSE(registry::open("cache", 10));
+	using cache_alloc = tinySTL::heap_alloc<9>;
+
+	registry::setStatsEnabled(network, true);
+	registry::setStatsEnabled(parser, true);
+	registry::setStatsEnabled(9, true);
+
+	std::vector<void*> net_blocks;
+	for (int i = 0; i < 5000; ++i)
+		net_blocks.push_back(registry::allocate(network, 64));
+	void* token = registry::allocate(parser, 64);
+	double* entry = tinySTL::allocator<double, cache_alloc>::allocate(4);
+
+	auto allocs = [](const tinySTL::AllocStats& s) {
+		uint64_t n = 0;
+		for (auto& c : s.classes)
+			n += c.allocs;
+		return n;
+	};
+	CHECK(allocs(registry::getStats(network)) == 5000);
+	CHECK(allocs(registry::getStats(parser)) == 1);
+	CHECK(allocs(registry::getStats(9)) == 1);
+	CHECK(allocs(cache_alloc::getStats()) == 1);
+
+	/* freeing the network objects does not touch the parser's free lists */
+	for (auto p : net_blocks)
+		registry::deallocate(network, p, 64);
+	CHECK(registry::getStats(network).idleBytes > 0);
+	CHECK(registry::getStats(parser).idleBytes < 64 * (size_t)tinySTL::TCACHEBatch);
+	CHECK(registry::trim(network) > 0);
+	CHECK(registry::getStats(parser).residentBytes == (size_t)tinySTL::CHUNKBytes);
+
+	FILE* out = std::tmpfile();
+	registry::report(out);
+	std::rewind(out);
+	char text[1024] = {};
+	size_t len = std::fread(text, 1, sizeof(text) - 1, out);
+	std::fclose(out);
+	CHECK(len > 0);
+	CHECK(std::strstr(text, "network") != nullptr);
+	CHECK(std::strstr(text, "parser") != nullptr);
+	CHECK(std::strstr(text, "cache") != nullptr);
+
+	registry::deallocate(parser, token, 64);
+	tinySTL::allocator<double, cache_alloc>::deallocate(entry, 4);
+	registry::trimAll();
+
+	/* the -1 from a failed open reaches no heap */
+	const int bad = registry::open("a name that is far too long for the table");
+	REQUIRE(bad == -1);
+	int before = heap_invalid_ids;
+	CHECK_THROWS_AS(registry::allocate(bad, 64), std::bad_alloc);
+	registry::deallocate(bad, token, 64);
+	registry::setStatsEnabled(bad, true);
+	registry::setTrimThreshold(bad, 4096);
+	CHECK(allocs(registry::getStats(bad)) == 0);
+	CHECK(registry::getStats(bad).residentBytes == 0);
+	CHECK(registry::getBudget(bad).used() == 0);
+	CHECK(registry::trim(bad) == 0);
+	CHECK_THROWS_AS(registry::allocate((int)tinySTL::MAXHeaps, 8), std::bad_alloc);
+	CHECK(heap_invalid_ids == before + 9);
+	CHECK(registry::getName(bad) == nullptr);
+}
+
+TEST_CASE("[Allocator] prewarmed pools serve the first requests without refilling")
+{
+	using pool = tinySTL::DefaultAllocTemplate<false, 10>;
+	pool::setStatsEnabled(true);
+	pool::prewarm(48, 3000);
+	size_t counts[tinySTL::FREELISTS] = {};
+	counts[0] = 500;                                  // 8 bytes
+	counts[tinySTL::FREELISTS - 1] = 4;               // MAXBytes
+	pool::prewarm(counts);
+	pool::prewarm(tinySTL::MAXBytes + 1, 10);         // ignored
+	tinySTL::AllocStats before = pool::getStats();
+	CHECK(before.idleBytes >= 48 * 3000 + 8 * 500 + 4 * (size_t)tinySTL::MAXBytes);
+
+	std::vector<void*> blocks;
+	for (int i = 0; i < 3000; ++i)
+		blocks.push_back(pool::allocate(48));
+	for (int i = 0; i < 500; ++i)
+		blocks.push_back(pool::allocate(8));
+	for (int i = 0; i < 4; ++i)
+		blocks.push_back(pool::allocate(tinySTL::MAXBytes));
+	tinySTL::AllocStats after = pool::getStats();
+	CHECK(after.chunkAllocs == before.chunkAllocs);
+	CHECK(after.reFills == before.reFills);
+
+#if defined(__linux__)
+	/* the pages under the objects are already mapped in */
+	size_t page = tinySTL::SystemPages::pageSize();
+	bool resident = true;
+	for (void* p : blocks) {
+		unsigned char vec = 0;
+		void* base = (void*)((uintptr_t)p & ~(uintptr_t)(page - 1));
+		if (mincore(base, page, &vec) != 0 || !(vec & 1))
+			resident = false;
+	}
+	CHECK(resident);
+#endif
+	for (size_t i = 0; i < blocks.size(); ++i)
+		pool::deallocate(blocks[i], i < 3000 ? 48 : i < 3500 ? 8 : (size_t)tinySTL::MAXBytes);
+
+	/* locking may be refused by RLIMIT_MEMLOCK, trim must work either way */
+	pool::setLockPages(true);
+	void* extra = pool::allocate(64);
+	pool::deallocate(extra, 64);
+	CHECK(pool::trim() > 0);
+	pool::setLockPages(false);
+}
+
+TEST_CASE("[Allocator] prewarmed objects are shared by all threads")
+{
+	using pool = tinySTL::DefaultAllocTemplate<true, 11>;
+	pool::setStatsEnabled(true);
+	pool::prewarm(32, 4000);
+	uint64_t chunks = pool::getStats().chunkAllocs;
+	std::vector<std::thread> workers;
+	for (int t = 0; t < 4; ++t) {
+		workers.emplace_back([]() {
+			std::vector<void*> live;
+			for (int i = 0; i < 900; ++i)
+				live.push_back(pool::allocate(32));
+			for (auto p : live)
+				pool::deallocate(p, 32);
+		});
+	}
+	for (auto& w : workers)
+		w.join();
+	CHECK(pool::getStats().chunkAllocs == chunks);
+}
+
+TEST_CASE("[Allocator] refill batches grow for hot classes and shrink for idle ones")
+{
+	using pool = tinySTL::DefaultAllocTemplate<false, 12>;
+	pool::setStatsEnabled(true);
+	auto size_class = [](const tinySTL::AllocStats& s, size_t size) {
+		for (auto& c : s.classes) {
+			if (c.size == size)
+				return c;
+		}
+		return tinySTL::AllocStats::SizeClass();
+	};
+
+	/* a hot class doubles its batch every time it runs dry, up to REFILLMax */
+	std::vector<void*> hot;
+	for (int i = 0; i < 20000; ++i)
+		hot.push_back(pool::allocate(8));
+	auto c8 = size_class(pool::getStats(), 8);
+	CHECK(c8.batchObjs == (size_t)tinySTL::REFILLMax);
+	CHECK(c8.reFills < 60); // 20000 / 20 with a fixed batch
+
+	/* a class used once stays at the default, a big class stays within REFILLBytes */
+	void* cold = pool::allocate(128);
+	CHECK(size_class(pool::getStats(), 128).reFills == 1);
+	std::vector<void*> big;
+	for (int i = 0; i < 50; ++i)
+		big.push_back(pool::allocate(16384));
+	size_t big_batch = size_class(pool::getStats(), 16384).batchObjs;
+	CHECK(big_batch * 16384 <= (size_t)tinySTL::REFILLBytes);
+	CHECK(big_batch >= 1);
+
+	/* a long idle list shrinks the batch when trim looks at it */
+	for (auto p : hot)
+		pool::deallocate(p, 8);
+	pool::trim();
+	CHECK(size_class(pool::getStats(), 8).batchObjs == (size_t)tinySTL::REFILLMax / 2);
+	pool::trim();
+	CHECK(size_class(pool::getStats(), 8).batchObjs == (size_t)tinySTL::REFILLMax / 4);
+
+	pool::deallocate(cold, 128);
+	for (auto p : big)
+		pool::deallocate(p, 16384);
+}
+
+TEST_CASE("[Allocator] an overflowing thread cache shrinks the batch")
+{
+	using pool = tinySTL::DefaultAllocTemplate<true, 12>;
+	pool::setStatsEnabled(true);
+	std::vector<void*> blocks;
+	for (int i = 0; i < 5000; ++i)
+		blocks.push_back(pool::allocate(40));
+	size_t grown = 0;
+	for (auto& c : pool::getStats().classes) {
+		if (c.size == 40)
+			grown = c.batchObjs;
+	}
+	CHECK(grown > (size_t)tinySTL::TCACHEBatch);
+	for (auto p : blocks)
+		pool::deallocate(p, 40);
+	size_t shrunk = 0;
+	for (auto& c : pool::getStats().classes) {
+		if (c.size == 40)
+			shrunk = c.batchObjs;
+	}
+	CHECK(shrunk < grown);
+	CHECK(shrunk >= (size_t)tinySTL::REFILLMin);
+}
+
+TEST_CASE("[Allocator] offset pointers survive being copied to another address")
+{
+	int values[4] = { 10, 20, 30, 40 };
+	struct holder {
+		tinySTL::offset_ptr<int> p;
+	};
+	holder a{ values + 1 };
+	CHECK(a.p.get() == values + 1);
+	CHECK(*a.p == 20);
+	CHECK(a.p[2] == 40);
+
+	/* a copy recomputes the offset for its own address */
+	holder* b = new holder(a);
+	CHECK(b->p.get() == values + 1);
+	b->p += 2;
+	CHECK(*b->p == 40);
+	CHECK(b->p - a.p == 2);
+	CHECK(a.p < b->p);
+	delete b;
+
+	tinySTL::offset_ptr<int> null;
+	CHECK(null == nullptr);
+	CHECK(null.get() == nullptr);
+	CHECK_FALSE(null);
+	tinySTL::offset_ptr<const void> erased = a.p;
+	tinySTL::offset_ptr<const int> back = static_cast<tinySTL::offset_ptr<const int>>(erased);
+	CHECK(back == a.p);
+	bool to_self = std::pointer_traits<tinySTL::offset_ptr<int>>::pointer_to(values[3]).get() == values + 3;
+	CHECK(to_self);
+}
+
+#if !defined(_WIN32)
+namespace {
+	template <typename T>
+	using shm_vector = std::vector<T, tinySTL::allocator<T, tinySTL::shm_alloc>>;
+	/* std::basic_string rather than tinySTL::basic_string: the latter has no Alloc parameter
+	   and keeps a raw buffer pointer, which does not survive a remap at another address */
+	using shm_string = std::basic_string<char, std::char_traits<char>, tinySTL::allocator<char, tinySTL::shm_alloc>>;
+
+	struct shm_index {
+		shm_vector<shm_string> names;
+		shm_vector<int> ids;
+	};
+
+	std::string shm_name(const char* prefix, int i) {
+		return std::string(prefix) + std::to_string(i) + " with enough text to leave the small buffer";
+	}
+
+	/* allocates and frees blocks of many classes, each stamped with a per-process byte;
+	   a block handed to both processes at once shows up as a broken stamp */
+	bool shm_churn(tinySTL::mapped_arena_base& arena, unsigned char stamp, int rounds) {
+		const size_t sizes[] = { 8, 24, 64, 200, 1024, 5000, 40000 };
+		std::vector<std::pair<void*, size_t>> live;
+		bool ok = true;
+		for (int r = 0; r < rounds; ++r) {
+			for (int i = 0; i < 300; ++i) {
+				size_t n = sizes[(i + r) % (sizeof(sizes) / sizeof(sizes[0]))];
+				void* p = arena.allocate(n);
+				std::memset(p, stamp, n);
+				live.push_back({ p, n });
+			}
+			for (auto& b : live) {
+				for (size_t k = 0; k < b.second; k += 7)
+					ok &= ((unsigned char*)b.first)[k] == stamp;
+				arena.deallocate(b.first, b.second);
+			}
+			live.clear();
+		}
+		return ok;
+	}
+}
+
+TEST_CASE("[Allocator] shared memory arena across forked processes")
+{
+	std::string name = "/tinystl_test_" + std::to_string((long)getpid());
+	tinySTL::shm_arena::remove(name.c_str());
+	tinySTL::shm_arena arena;
+	REQUIRE(arena.create(name.c_str(), 64 * 1024 * 1024));
+
+	shm_index* index;
+	{
+		tinySTL::shm_scope scope(arena);
+		index = ::new(arena.allocate(sizeof(shm_index))) shm_index();
+		for (int i = 0; i < 200; ++i) {
+			index->names.push_back(shm_name("parent ", i).c_str());
+			index->ids.push_back(i);
+		}
+		index->names.push_back("short");
+		arena.setRoot(index);
+	}
+
+	pid_t child = fork();
+	REQUIRE(child >= 0);
+	if (child == 0) {
+		/* a second mapping of the same memory lands at another address */
+		tinySTL::shm_arena view;
+		bool ok = view.open(name.c_str()) && view.base() != arena.base();
+		if (ok) {
+			tinySTL::shm_scope scope(view);
+			shm_index* seen = (shm_index*)view.getRoot();
+			ok = view.contains(seen) && seen->names.size() == 201 && seen->names[150].c_str() == shm_name("parent ", 150)
+				&& seen->names.back() == "short" && seen->ids[199] == 199;
+			ok &= shm_churn(view, 0xC1, 40);
+			for (int i = 0; ok && i < 100; ++i) {
+				seen->names.push_back(shm_name("child ", i).c_str());
+				seen->ids.push_back(-i);
+			}
+		}
+		_exit(ok ? 0 : 1);
+	}
+
+	CHECK(shm_churn(arena, 0x9A, 40));
+	int status = 0;
+	REQUIRE(waitpid(child, &status, 0) == child);
+	CHECK(WIFEXITED(status));
+	CHECK(WEXITSTATUS(status) == 0);
+
+	/* what the child appended through its own mapping reads fine through ours */
+	CHECK(index->names.size() == 301);
+	CHECK(index->names[150].c_str() == shm_name("parent ", 150));
+	CHECK(index->names[201 + 99].c_str() == shm_name("child ", 99));
+	CHECK(index->ids.back() == -99);
+	{
+		tinySTL::shm_scope scope(arena);
+		index->~shm_index();
+		arena.deallocate(index, sizeof(shm_index));
+	}
+
+	/* another process cannot open a name that is gone */
+	CHECK(tinySTL::shm_arena::remove(name.c_str()));
+	tinySTL::shm_arena gone;
+	CHECK_FALSE(gone.open(name.c_str()));
+	tinySTL::shm_arena twice;
+	CHECK(twice.create(name.c_str(), 4096));
+	CHECK_FALSE(arena.create(name.c_str(), 4096));
+	CHECK(tinySTL::shm_arena::remove(name.c_str()));
+}
+
+TEST_CASE("[Allocator] blocks freed outside their arena's scope are left alone")
+{
+	std::string nameA = "/tinystl_test_a_" + std::to_string((long)getpid());
+	std::string nameB = "/tinystl_test_b_" + std::to_string((long)getpid());
+	tinySTL::shm_arena::remove(nameA.c_str());
+	tinySTL::shm_arena::remove(nameB.c_str());
+	tinySTL::shm_arena a, b;
+	REQUIRE(a.create(nameA.c_str(), 1024 * 1024));
+	REQUIRE(b.create(nameB.c_str(), 1024 * 1024));
+
+	auto fill = [&](tinySTL::shm_arena& arena) {
+		tinySTL::shm_scope scope(arena);
+		auto* v = new shm_vector<int>(1000, 7);
+		v->push_back(8);
+		return v;
+	};
+
+	SUBCASE("destroyed outside any scope") {
+		shm_vector<int>* v = fill(a);
+		size_t left = a.available();
+		int before = shm_foreign_blocks;
+		delete v;
+		CHECK(shm_foreign_blocks == before + 1);
+		CHECK(a.available() == left);
+
+		tinySTL::shm_scope scope(a);
+		shm_vector<int> w(100, 1);
+		CHECK(a.contains(w.data()));
+	}
+
+	SUBCASE("destroyed under another arena's scope") {
+		shm_vector<int>* v = fill(a);
+		size_t bytes = v->capacity() * sizeof(int);
+		size_t left = b.available();
+		int before = shm_foreign_blocks;
+		{
+			tinySTL::shm_scope scope(b);
+			delete v;
+		}
+		CHECK(shm_foreign_blocks == before + 1);
+		CHECK(b.available() == left);
+
+		/* had the block gone onto b's free list, b would hand out memory inside a */
+		tinySTL::shm_scope scope(b);
+		for (int i = 0; i < 4; ++i) {
+			void* p = tinySTL::shm_alloc::allocate(bytes);
+			CHECK(b.contains(p));
+			CHECK_FALSE(a.contains(p));
+			tinySTL::shm_alloc::deallocate(p, bytes);
+		}
+		CHECK(shm_foreign_blocks == before + 1);
+	}
+
+	SUBCASE("reallocate copies a foreign block without freeing it") {
+		shm_vector<int>* v = fill(a);
+		size_t bytes = v->capacity() * sizeof(int);
+		int before = shm_foreign_blocks;
+		tinySTL::shm_scope scope(b);
+		CHECK_FALSE(tinySTL::shm_alloc::tryExpand(v->data(), bytes, bytes));
+		int* q = (int*)tinySTL::shm_alloc::reallocate(v->data(), bytes, bytes * 2);
+		CHECK(b.contains(q));
+		CHECK(q[999] == 7);
+		CHECK(q[1000] == 8);
+		CHECK(shm_foreign_blocks == before + 2);
+		tinySTL::shm_alloc::deallocate(q, bytes * 2);
+		tinySTL::shm_scope back(a);
+		delete v;
+		CHECK(shm_foreign_blocks == before + 2);
+	}
+
+	CHECK(tinySTL::shm_arena::remove(nameA.c_str()));
+	CHECK(tinySTL::shm_arena::remove(nameB.c_str()));
+}
+
+namespace {
+	struct file_entry {
+		shm_string key;
+		long value;
+	};
+
+	using file_index = shm_vector<file_entry>;
+	const uint64_t file_layout = 0x1001;
+
+	long file_lookup(const file_index& index, const std::string& key) {
+		auto it = std::lower_bound(index.begin(), index.end(), key,
+			[](const file_entry& e, const std::string& k) { return e.key.compare(k.c_str()) < 0; });
+		return it != index.end() && it->key.c_str() == key ? it->value : -1;
+	}
+}
+
+TEST_CASE("[Allocator] file arena brings an index back after reopening")
+{
+	std::string path = "/tmp/tinystl_file_arena_" + std::to_string((long)getpid());
+	{
+		tinySTL::file_arena file;
+		REQUIRE(file.create(path.c_str(), 8 * 1024 * 1024, file_layout));
+		tinySTL::shm_scope scope(file);
+		file_index* index = ::new(file.allocate(sizeof(file_index))) file_index();
+		for (int i = 0; i < 1000; ++i)
+			index->push_back({ shm_name("key ", i).c_str(), i * 10L });
+		std::sort(index->begin(), index->end(),
+			[](const file_entry& a, const file_entry& b) { return a.key < b.key; });
+		file.setRoot(index);
+	}
+	{
+		/* a restarted process finds the index through the root and keeps adding to it */
+		tinySTL::file_arena file;
+		REQUIRE(file.open(path.c_str(), file_layout));
+		file_index* index = (file_index*)file.getRoot();
+		REQUIRE(index);
+		CHECK(index->size() == 1000);
+		CHECK(file_lookup(*index, shm_name("key ", 777)) == 7770);
+		CHECK(file_lookup(*index, "missing") == -1);
+		tinySTL::shm_scope scope(file);
+		index->push_back({ "~last", -5 });
+
+		/* the file is locked while it is open */
+		tinySTL::file_arena other;
+		CHECK_FALSE(other.open(path.c_str(), file_layout));
+	}
+	{
+		tinySTL::file_arena file;
+		REQUIRE(file.open(path.c_str(), file_layout));
+		file_index* index = (file_index*)file.getRoot();
+		CHECK(index->size() == 1001);
+		CHECK(file_lookup(*index, "~last") == -5);
+	}
+
+	/* another layout of the root object is not mistaken for this one */
+	tinySTL::file_arena file;
+	CHECK_FALSE(file.open(path.c_str(), file_layout + 1));
+
+	/* a process that dies while the file is open leaves it unusable */
+	pid_t child = fork();
+	REQUIRE(child >= 0);
+	if (child == 0) {
+		tinySTL::file_arena crashed;
+		_exit(crashed.open(path.c_str(), file_layout) ? 0 : 1);
+	}
+	int status = 0;
+	REQUIRE(waitpid(child, &status, 0) == child);
+	CHECK(WEXITSTATUS(status) == 0);
+	CHECK_FALSE(file.open(path.c_str(), file_layout));
+
+	/* a closed file with one byte changed fails the checksum */
+	REQUIRE(file.create(path.c_str(), 1024 * 1024, file_layout));
+	{
+		tinySTL::shm_scope scope(file);
+		file.setRoot(::new(file.allocate(sizeof(file_index))) file_index(100, { "value", 1 }));
+	}
+	file.close();
+	REQUIRE(file.open(path.c_str(), file_layout));
+	file.close();
+	FILE* f = std::fopen(path.c_str(), "r+b");
+	REQUIRE(f);
+	std::fseek(f, (long)tinySTL::SystemPages::pageSize() + 600, SEEK_SET); // inside the first objects
+	int c = std::fgetc(f);
+	std::fseek(f, -1, SEEK_CUR);
+	std::fputc(c ^ 0x40, f);
+	std::fclose(f);
+	CHECK_FALSE(file.open(path.c_str(), file_layout));
+	std::remove(path.c_str());
+}
+#endif
@@ -0,0 +1,42 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+#include "../../basic_string.h"
+
+#include <cstring>
+
+TEST_CASE("[String] append grows the capacity geometrically")
+{
+	tinySTL::basic_string<char> s;
+	size_t growths = 0;
+	size_t cap = s.capacity();
+	for (int i = 0; i < 100000; ++i) {
+		s.push_back((char)('a' + i % 26));
+		if (s.capacity() != cap) {
+			CHECK(s.capacity() >= cap + cap / 2);
+			cap = s.capacity();
+			++growths;
+		}
+	}
+	CHECK(growths <= 20); // 32 * 1.5^20 > 100000; growing by exactly the appended size would be ~100000
+	CHECK(s.size() == 100000u);
+	CHECK(s.c_str()[99999] == (char)('a' + 99999 % 26));
+	CHECK(s.c_str()[100000] == '\0');
+
+	tinySTL::basic_string<char> t("x");
+	growths = 0;
+	cap = t.capacity();
+	for (int i = 0; i < 1000; ++i) {
+		t.append("0123456789");
+		growths += t.capacity() != cap;
+		cap = t.capacity();
+	}
+	CHECK(growths <= 15);
+	CHECK(t.size() == 10001u);
+	CHECK(std::strncmp(t.c_str() + 9991, "0123456789", 10) == 0);
+
+	t.reserve(50000);
+	CHECK(t.capacity() > 50000u);
+	t.shrink_to_fit();
+	CHECK(t.capacity() == t.size() + 1); // room for the terminator stays
+	CHECK(t.c_str()[t.size()] == '\0');
+}
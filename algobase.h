@@ -1,9 +1,11 @@
 #pragma once
 
 #include <cstring>
+#include <type_traits>
 
 #include "util.h"
 #include "iterator.h"
+#include "simd.h"
 
 namespace tinySTL {
 
@@ -268,6 +270,19 @@ namespace tinySTL {
 		return true;
 	}
 
+	// ָͬһis_bitwise_comparable͵ָ룬Simd::mismatchֽڱȽ
+	template <class Tp, class Up>
+	struct is_simd_comparable : std::integral_constant<bool,
+		std::is_same<typename std::remove_cv<Tp>::type, typename std::remove_cv<Up>::type>::value &&
+		is_bitwise_comparable<typename std::remove_cv<Tp>::type>::value> {};
+
+	template<typename Tp, typename Up>
+	typename std::enable_if<is_simd_comparable<Tp, Up>::value, bool>::type
+		equal(Tp* first1, Tp* last1, Up* first2) {
+		const auto n = static_cast<size_t>(last1 - first1);
+		return Simd::mismatch(first1, first2, n, sizeof(Tp)) == n;
+	}
+
 	template<typename InputIter1, typename InputIter2, typename Compare>
 	bool equal(InputIter1 first1, InputIter1 last1, InputIter2 first2, Compare cmp) {
 		for (; first1 != last1; ++first1, ++first2) {
@@ -281,12 +296,35 @@ namespace tinySTL {
 
 	template<typename OutputIter, typename Size, typename T>
 	OutputIter unchecked_fill_n(OutputIter first, Size n, const T& value) {
-		while (n--) {
+		for (; n > 0; --n, ++first) {
 			*first = value;
 		}
 		return first;
 	}
 
+	// ƽɸơΪ2/4/8/16/32ֽڵֵͣǰֽڸƣԽSimd::fill
+	// ֵͲͬʱֻ֮תתһֽٰ
+	template <class Tp, class Up>
+	struct is_simd_fillable : std::integral_constant<bool,
+		std::is_trivially_copyable<Tp>::value && std::is_trivially_copy_assignable<Tp>::value &&
+		!std::is_const<Tp>::value && !std::is_volatile<Tp>::value &&
+		(sizeof(Tp) == 2 || sizeof(Tp) == 4 || sizeof(Tp) == 8 || sizeof(Tp) == 16 || sizeof(Tp) == 32) &&
+		(std::is_same<typename std::remove_cv<Up>::type, Tp>::value ||
+			(std::is_arithmetic<Tp>::value && std::is_arithmetic<Up>::value))> {};
+
+	template <class Tp, class Size, class Up>
+	typename ::std::enable_if<is_simd_fillable<Tp, Up>::value, Tp*>::type
+		unchecked_fill_n(Tp* first, Size n, const Up& value)
+	{
+		if (n > 0)
+		{
+			const Tp tmp = static_cast<Tp>(value);
+			Simd::fill(first, (size_t)(n), &tmp, sizeof(Tp));
+			return first + n;
+		}
+		return first;
+	}
+
 	// Ϊ one-byte ṩػ汾
 	template <class Tp, class Size, class Up>
 	typename ::std::enable_if<
@@ -360,8 +398,28 @@ namespace tinySTL {
 		return first1 == last1 && first2 != last2;
 	}
 
+	//  is_simd_comparable ͵İ汾ͬǰ׺ֻȽϵһ鲻ͬԪء
+	// ֽڲͬԪ < Կܵȼ(ֻȽϼPOD)ʱһԪؼ
+	template<typename Tp, typename Up>
+	typename std::enable_if<is_simd_comparable<Tp, Up>::value, bool>::type
+		lexicographical_compare(Tp* first1, Tp* last1, Up* first2, Up* last2) {
+		const auto len1 = static_cast<size_t>(last1 - first1);
+		const auto len2 = static_cast<size_t>(last2 - first2);
+		const auto len = tinySTL::min(len1, len2);
+		for (size_t i = 0; i < len; ++i) {
+			i += Simd::mismatch(first1 + i, first2 + i, len - i, sizeof(Tp));
+			if (i == len)
+				break;
+			if (first1[i] < first2[i])
+				return true;
+			if (first2[i] < first1[i])
+				return false;
+		}
+		return len1 < len2;
+	}
+
 	//  const unsigned char* ػ汾
-	bool lexicographical_compare(const unsigned char* first1,
+	inline bool lexicographical_compare(const unsigned char* first1,
 		const unsigned char* last1,
 		const unsigned char* first2,
 		const unsigned char* last2)
@@ -374,23 +432,57 @@ namespace tinySTL {
 		return result != 0 ? result < 0 : len1 < len2;
 	}
 
-	// mismatch ƽбȽУҵһƥԪأһԵֱָвƥԪ
+	// mismatch ƽбȽУҵһƥԪأһԵֱָвƥԪء
+	// ֻlast1ʱڶٺ͵һһlast2ʱһеĽβֹͣ
 
 	template<typename Iter1, typename Iter2>
-	tinySTL::pair<Iter1, Iter2> mismatch(Iter1 first1, Iter2 last1,
-		Iter2 first2, Iter2 last2) {
+	tinySTL::pair<Iter1, Iter2> mismatch(Iter1 first1, Iter1 last1, Iter2 first2) {
 		while (first1 != last1 && *first1 == *first2) {
 			++first1; ++first2;
 		}
 		return tinySTL::pair<Iter1, Iter2>(first1, first2);
 	}
 
+	template<typename Iter1, typename Iter2>
+	tinySTL::pair<Iter1, Iter2> mismatch(Iter1 first1, Iter1 last1,
+		Iter2 first2, Iter2 last2) {
+		while (first1 != last1 && first2 != last2 && *first1 == *first2) {
+			++first1; ++first2;
+		}
+		return tinySTL::pair<Iter1, Iter2>(first1, first2);
+	}
+
 	template<typename Iter1, typename Iter2, typename Compare>
-	tinySTL::pair<Iter1, Iter2> mismatch(Iter1 first1, Iter2 last1,
-		Iter2 first2, Iter2 last2, Compare cmp) {
+	tinySTL::pair<Iter1, Iter2> mismatch(Iter1 first1, Iter1 last1,
+		Iter2 first2, Compare cmp) {
 		while (first1 != last1 && cmp(*first1, *first2)) {
 			++first1; ++first2;
 		}
 		return tinySTL::pair<Iter1, Iter2>(first1, first2);
 	}
+
+	template<typename Iter1, typename Iter2, typename Compare>
+	tinySTL::pair<Iter1, Iter2> mismatch(Iter1 first1, Iter1 last1,
+		Iter2 first2, Iter2 last2, Compare cmp) {
+		while (first1 != last1 && first2 != last2 && cmp(*first1, *first2)) {
+			++first1; ++first2;
+		}
+		return tinySTL::pair<Iter1, Iter2>(first1, first2);
+	}
+
+	//  is_simd_comparable ͵İ汾 Simd::mismatch ҵһͬλ
+	template<typename Tp, typename Up>
+	typename std::enable_if<is_simd_comparable<Tp, Up>::value, tinySTL::pair<Tp*, Up*>>::type
+		mismatch(Tp* first1, Tp* last1, Up* first2) {
+		const auto i = Simd::mismatch(first1, first2, static_cast<size_t>(last1 - first1), sizeof(Tp));
+		return tinySTL::pair<Tp*, Up*>(first1 + i, first2 + i);
+	}
+
+	template<typename Tp, typename Up>
+	typename std::enable_if<is_simd_comparable<Tp, Up>::value, tinySTL::pair<Tp*, Up*>>::type
+		mismatch(Tp* first1, Tp* last1, Up* first2, Up* last2) {
+		const auto len = tinySTL::min(static_cast<size_t>(last1 - first1), static_cast<size_t>(last2 - first2));
+		const auto i = Simd::mismatch(first1, first2, len, sizeof(Tp));
+		return tinySTL::pair<Tp*, Up*>(first1 + i, first2 + i);
+	}
 }
\ No newline at end of file
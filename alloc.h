@@ -1,7 +1,30 @@
 #pragma once
 
 #include <new>
+#include <atomic>
+#include <cassert>
 #include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <climits>
+#include <cstring>
+#include <mutex>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <intrin.h>
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#endif
 
 namespace tinySTL {
 
@@ -18,20 +41,315 @@ namespace tinySTL {
 	// ͿˣFreeList16ֱСΪ8, 16, 24, 32, 40, 48, 
 	// 56, 64, 72, 80, 88, 86, 96, 104, 112, 120, 128ֽڴСڴ
 	// ˡ
+	// 128ֽڵĶҲ8ֽһൽûԴ128ֽڵ
+	// 32KBʹüĵڶ㣺ÿ2(2^k, 2^(k+1)]ٵȷֳ4160
+	// 192224256320384448512Ƭ25%һֻ32
 	enum {
 		ALIGN = 8,
 	};
 
 	enum {
-		MAXBytes = 128,
+		MAXBytes = 32 * 1024,
+	};
+
+	enum {
+		SMALLBytes = 128,                // SMALLBytesĶȻ8ֽڷֵ
+		SMALLShift = 7,                  // log2(SMALLBytes)
+		SMALLLists = SMALLBytes / ALIGN, // 16
+		STEPSPerPow2 = 4,
+		FREELISTS = SMALLLists + STEPSPerPow2 * (15 - SMALLShift), // 15 = log2(MAXBytes)
+	};
+
+	// SMALLBytesĶӰҳspanз֣һrefillҪSPANBytesֽڣ
+	// 󲻻νؿԽҳ
+	enum {
+		PAGEBytes = 4096,
+		SPANBytes = 64 * 1024,
+	};
+
+	// ̰߳汾ÿ߳ԼһFreeList棬һδڴȡ
+	// TCACHEBatch(SPANBytes㣬)̻߳ĳһ
+	// ʱٹ黹һڴأ̻߳
+	enum {
+		TCACHEBatch = 20,
+	};
+
+	// һĴСӦĬֵʼһÿȡһ(reFill)ͷ
+	// ̻߳trimʱֿREFILLIdleͼ롣ȵСһȡ
+	// ٸõĵڻһ[REFILLMin, REFILLMax]֮䣬Ҳ
+	// REFILLBytesֽ(󵵿REFILLMin)
+	enum {
+		REFILLMin = 4,
+		REFILLMax = 512,
+		REFILLBytes = SPANBytes,
+		REFILLIdle = 4,
+	};
+
+	// ڴزÿmallocһСڴ棬ǰCHUNKBytes롢С̶chunk
+	// ϵͳ롣һַĨλҵchunkͷtrimʱ
+	// ͳƳЩchunkϵĶѾȫͷţЩchunkҳϵͳ
+	enum {
+		CHUNKBytes = 256 * 1024,
+		CHUNKHeader = 64, // chunkͷռõֽڣ֮Ŀռзֶ
 	};
 
+	// ҳarenaģʽ£chunkٵӳ䣬ǴӰHUGEBytesĴг
+	// MADV_HUGEPAGEں2MB͸ҳӳ䣬ȵҳϣ
+	// ԼTLB miss
 	enum {
-		FREELISTS = 16,
+		HUGEBytes = 2 * 1024 * 1024,
+	};
+
+	// ÿһĶ󶼰ԼСλ(MAXAlign)3296160ֽڵĵ32
+	// ֽڶ룬64192256ֽڵĵ64ֽڶ롣뵽AֻҪһСAı
+	// ĵȡĶȻAģضٵMAXAlignĶ뽻һ
+	enum {
+		MAXAlign = 64, // дС
+	};
+
+	// СMMAPBytesĴڴ治mallocֱӰҳӳ䣬reallocateʱmremapں
+	// ŲҳҪֽڸ
+	enum {
+		MMAPBytes = 1024 * 1024,
+	};
+
+	/*
+	 * 汾ŵջ(Treiber stack)̰߳汾ʵ֡
+	 * ֻһָCASABA⣺߳Aջpp->next֮󱻹߳
+	 * pְpѹȥACASȻɹȴѱߵp->nextŻջ
+	 * ԰ջָһÿ޸Ķһİ汾Ŵͬһ64λһCAS
+	 * 汾ŲͬCASͻʧܡ64λƽ̨ûַֻ̬е48λЧFreeList
+	 * 8ֽڶ룬ָ3λֻռ45λʣµ19λ汾š
+	 */
+	class AtomicFreeList {
+	public:
+		constexpr AtomicFreeList() noexcept : top(0) {}
+		AtomicFreeList(const AtomicFreeList&) = delete;
+		AtomicFreeList& operator=(const AtomicFreeList&) = delete;
+
+		// һȡջеĽ
+		FreeList* popAll() noexcept {
+			uint64_t old = top.load(std::memory_order_acquire);
+			while (!top.compare_exchange_weak(old, pack(nullptr, getTag(old) + 1),
+				std::memory_order_acquire, std::memory_order_acquire));
+			return getPtr(old);
+		}
+
+		// head...tailһһѹջ
+		void push(FreeList* head, FreeList* tail) noexcept {
+			uint64_t old = top.load(std::memory_order_relaxed);
+			do {
+				storeNext(tail, getPtr(old));
+			} while (!top.compare_exchange_weak(old, pack(head, getTag(old) + 1),
+				std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		FreeList* pop() noexcept {
+			uint64_t old = top.load(std::memory_order_acquire);
+			while (FreeList* p = getPtr(old)) {
+				/* pѱ̵߳дʱnextû壬汾ѱ䣬CASȻʧ */
+				FreeList* next = loadNext(p);
+				if (top.compare_exchange_weak(old, pack(next, getTag(old) + 1),
+					std::memory_order_acquire, std::memory_order_acquire))
+					return p;
+			}
+			return nullptr;
+		}
+
+		// ൯maxCnt㣬nullptrβʵʵĸ
+		size_t popBatch(FreeList*& head, FreeList*& tail, size_t maxCnt) noexcept {
+			size_t cnt = 0;
+			head = tail = nullptr;
+			for (; cnt < maxCnt; ++cnt) {
+				FreeList* p = pop();
+				if (!p)
+					break;
+				storeNext(p, nullptr);
+				if (tail)
+					storeNext(tail, p);
+				else
+					head = p;
+				tail = p;
+			}
+			return cnt;
+		}
+
+		bool empty() const noexcept {
+			return !getPtr(top.load(std::memory_order_relaxed));
+		}
+
+	private:
+		static_assert(sizeof(void*) <= sizeof(uint64_t), "pointer must fit in 64 bits");
+
+		enum : uint64_t {
+			PTRBits = sizeof(void*) == 8 ? 45 : 32,
+			PTRMask = (uint64_t(1) << PTRBits) - 1,
+			PTRShift = sizeof(void*) == 8 ? 3 : 0,
+		};
+
+		// 64λƽָ̨ռ48λַ(3λ45λ)汾ռʣµ19λ
+		static_assert(sizeof(void*) != 8 || (PTRBits + PTRShift == 48 && 64 - PTRBits == 19),
+			"AtomicFreeList packs a 48-bit address and a 19-bit tag");
+		static_assert(alignof(FreeList) >= (size_t(1) << PTRShift), "FreeList nodes must keep the low bits zero");
+
+		static uint64_t pack(FreeList* p, uint64_t tag) noexcept {
+			// 5ҳַ48λĽ̻ԣŪַĸλ
+			assert(getPtr((uint64_t)(uintptr_t)p >> PTRShift) == p);
+			return ((uint64_t)(uintptr_t)p >> PTRShift) | (tag << PTRBits);
+		}
+
+		// popp->next͵p̸߳дp->nextǲģ߶relaxedԭӷʲŲݾ
+		static FreeList* loadNext(FreeList* p) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+			return __atomic_load_n(&p->next, __ATOMIC_RELAXED);
+#else
+			return *static_cast<FreeList* volatile*>(&p->next); // MSVCvolatileдָԭӵ
+#endif
+		}
+
+		static void storeNext(FreeList* p, FreeList* next) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+			__atomic_store_n(&p->next, next, __ATOMIC_RELAXED);
+#else
+			*static_cast<FreeList* volatile*>(&p->next) = next;
+#endif
+		}
+
+		static FreeList* getPtr(uint64_t v) noexcept {
+			return (FreeList*)(uintptr_t)((v & PTRMask) << PTRShift);
+		}
+
+		static uint64_t getTag(uint64_t v) noexcept {
+			return v >> PTRBits;
+		}
+
+		std::atomic<uint64_t> top;
 	};
 
 	using MALLOCALLOCFUN = void(*)();
 
+	// ڴѹصlevelԽֵ(MemoryBudget::SOFTLevel/HARDLevel)wantϣ
+	// ͷŵֽʵͷŵֽûпͷŵľͷ0
+	using PRESSUREFUN = size_t(*)(int level, size_t want, void* arg);
+
+	/*
+	 * ÿڴһݵڴԤ㣬ȡԭֻһvoid(*)()ڴľʱűõ
+	 * OOMڴϵͳҪڴ֮ǰchargeϵͳ֮release
+	 * Խʱһ"ѹ"ڴڲʱעĻصû
+	 * ֮ϵͳchargeᳬӲʱchargeʧܣڴصûصҪͷ
+	 * Ĳ֣ͷŲ׳bad_allocϵͳľ֮ǰͻ
+	 * óڴ棬зͬʱoomMallocʧܡ
+	 * صע˳ãصпͷ(ҲԷ)ڴ棬ᱻǶ״
+	 */
+	class MemoryBudget {
+	public:
+		enum {
+			SOFTLevel = 1,
+			HARDLevel = 2,
+			MAXCallbacks = 16,
+		};
+
+		constexpr MemoryBudget() noexcept : usedBytes(0), softLimit(0), hardLimit(0), pressure(false),
+			callbacks(), callbackMutex() {}
+		MemoryBudget(const MemoryBudget&) = delete;
+		MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+		// 0ʾ
+		void setLimits(size_t soft, size_t hard) noexcept {
+			softLimit.store(soft, std::memory_order_relaxed);
+			hardLimit.store(hard, std::memory_order_relaxed);
+		}
+		size_t getSoftLimit() const noexcept { return softLimit.load(std::memory_order_relaxed); }
+		size_t getHardLimit() const noexcept { return hardLimit.load(std::memory_order_relaxed); }
+		size_t used() const noexcept { return usedBytes.load(std::memory_order_relaxed); }
+
+		// עص֮עıţصʱ-1
+		int addCallback(PRESSUREFUN f, void* arg = nullptr) {
+			std::lock_guard<std::mutex> guard(callbackMutex);
+			for (int i = 0; i < (int)MAXCallbacks; ++i) {
+				if (!callbacks[i].fun) {
+					callbacks[i].fun = f;
+					callbacks[i].arg = arg;
+					return i;
+				}
+			}
+			return -1;
+		}
+
+		void removeCallback(int id) {
+			std::lock_guard<std::mutex> guard(callbackMutex);
+			if (id >= 0 && id < (int)MAXCallbacks)
+				callbacks[id].fun = nullptr;
+		}
+
+		// bytesֽڡᳬӲʱ룬falseԽʱ
+		// ѹɵںʵʱrelieve
+		bool charge(size_t bytes) noexcept {
+			size_t hard = hardLimit.load(std::memory_order_relaxed);
+			size_t old = usedBytes.load(std::memory_order_relaxed);
+			do {
+				if (hard && old + bytes > hard)
+					return false;
+			} while (!usedBytes.compare_exchange_weak(old, old + bytes, std::memory_order_relaxed));
+			size_t soft = softLimit.load(std::memory_order_relaxed);
+			if (soft && old <= soft && old + bytes > soft)
+				pressure.store(true, std::memory_order_relaxed);
+			return true;
+		}
+
+		void release(size_t bytes) noexcept { usedBytes.fetch_sub(bytes, std::memory_order_relaxed); }
+
+		// ǷԽ֮ûѹڴ·ϼ
+		bool underPressure() const noexcept { return pressure.load(std::memory_order_relaxed); }
+
+		// εûصֱͷwantֽڣͷŵֽڳڴص
+		// ʱãصٴδʱֱӷ0
+		size_t relieve(int level, size_t want);
+
+	private:
+		struct Callback {
+			PRESSUREFUN fun;
+			void* arg;
+		};
+
+		std::atomic<size_t> usedBytes;
+		std::atomic<size_t> softLimit;
+		std::atomic<size_t> hardLimit;
+		std::atomic<bool> pressure;
+		Callback callbacks[MAXCallbacks];
+		std::mutex callbackMutex;
+	};
+
+	inline size_t MemoryBudget::relieve(int level, size_t want) {
+		static thread_local bool relieving = false;
+		if (relieving)
+			return 0;
+		relieving = true;
+		pressure.store(false, std::memory_order_relaxed);
+		size_t freed = 0;
+		/* ȸһݣصעᡢעصҲ */
+		Callback todo[MAXCallbacks];
+		{
+			std::lock_guard<std::mutex> guard(callbackMutex);
+			std::memcpy(todo, callbacks, sizeof(todo));
+		}
+		for (Callback& c : todo) {
+			if (freed >= want)
+				break;
+			if (!c.fun)
+				continue;
+			try {
+				freed += c.fun(level, want - freed, c.arg);
+			}
+			catch (...) {
+				relieving = false;
+				throw;
+			}
+		}
+		relieving = false;
+		return freed;
+	}
+
 	/*
 	 * ʹtemplate<int inst>еķͱinstԻһ鲻ͬľ̬Ա
 	 * reference to https://zhuanlan.zhihu.com/p/337711951
@@ -39,32 +357,113 @@ namespace tinySTL {
 	template <int inst>
 	class MallocAllocTemplate {									  // һռ
 	private:
-		static void* oomMalloc(size_t n);						  // mallocʧʱãoomΪout of memory
+		static void* oomMalloc(size_t n, size_t align);			  // mallocʧʱãoomΪout of memory
+		static void* oomRealloc(void* p, size_t n);               // reallocʧʱҪͷڴ
+
+		static void* systemMalloc(size_t n, size_t align) {
+			if (align <= alignof(std::max_align_t)) // mallocĶ
+				return std::malloc(n);
+#if defined(_WIN32)
+			return _aligned_malloc(n, align);
+#else
+			void* p;
+			return posix_memalign(&p, align, n) == 0 ? p : nullptr;
+#endif
+		}
 
 		static MALLOCALLOCFUN MallocAllocOomHandler;              // Ĭϲ
+		static MemoryBudget budget;                               // һ֪ͷŵĴСֻĻص
 	public:
 		static void* allocate(size_t n);
+		// align䣬align2
+		static void* allocate(size_t n, size_t align) {
+			void* result = systemMalloc(n, align);
+			return result ? result : oomMalloc(n, align);
+		}
 
 		static void deallocate(void* p) { std::free(p); }
+		static void deallocate(void* p, size_t /* n */) { std::free(p); }
+		static void deallocate(void* p, size_t /* n */, size_t align) {
+#if defined(_WIN32)
+			if (align > alignof(std::max_align_t)) {
+				_aligned_free(p);
+				return;
+			}
+#endif
+			(void)align;
+			std::free(p);
+		}
+
+		// ܷԭذpչnֽ(ڰڴ)glibcmalloc_usable_size
+		// Windows_expandƽֻ̨вʱųɹ
+		static bool tryExpand(void* p, size_t oldSize, size_t n) {
+#if defined(_WIN32)
+			(void)oldSize;
+			return _expand(p, n) != nullptr;
+#elif defined(__GLIBC__)
+			(void)oldSize;
+			return malloc_usable_size(p) >= n;
+#else
+			(void)p;
+			return n <= oldSize;
+#endif
+		}
+
+		// glibcmmapĴڴreallocʱʹmremap
+		static void* reallocate(void* p, size_t /* oldSize */, size_t n) {
+			return oomRealloc(p, n);
+		}
 
 		static MALLOCALLOCFUN SetMallocHandler(MALLOCALLOCFUN f); // OOM_malloc** лصfreeMemorosڴ棬ʹmallocɹ
 
+		// mallocʧʱεעѹصͷŲڴʱŵSetMallocHandler
+		// õĴ
+		static MemoryBudget& getBudget() { return budget; }
+
 	};
 
 	template<int inst>
 	MALLOCALLOCFUN MallocAllocTemplate<inst>::MallocAllocOomHandler = nullptr; // Ĭϲ
 
 	template<int inst>
-	void* MallocAllocTemplate<inst>::oomMalloc(size_t n) {
+	MemoryBudget MallocAllocTemplate<inst>::budget;
+
+	template<int inst>
+	void* MallocAllocTemplate<inst>::oomMalloc(size_t n, size_t align) {
 		MALLOCALLOCFUN myMallocHandler;
 		void* result;
 		while (true) {
-			myMallocHandler = MallocAllocOomHandler; // ûڴ治㴦׳쳣
-			if (!myMallocHandler)
-				throw std::bad_alloc();
-			(*myMallocHandler)();
-			if (result = std::malloc(n))
+			if (!budget.relieve(MemoryBudget::HARDLevel, n)) {
+				myMallocHandler = MallocAllocOomHandler; // ûڴ治㴦׳쳣
+				if (!myMallocHandler)
+					throw std::bad_alloc();
+				(*myMallocHandler)();
+			}
+			result = systemMalloc(n, align);
+			if (result)
+				break;
+		}
+		return result;
+	}
+
+	template<int inst>
+	void* MallocAllocTemplate<inst>::oomRealloc(void* p, size_t n) {
+		MALLOCALLOCFUN myMallocHandler;
+		void* result;
+		/*
+		 * һreallocҲѭڵreallocһΡʧܺٽԵĻ
+		 * GCC 12֮prealloc֮ʹ(-Wuse-after-free)ʵʧʱpֲ
+		 */
+		while (true) {
+			result = std::realloc(p, n);
+			if (result)
 				break;
+			if (!budget.relieve(MemoryBudget::HARDLevel, n)) {
+				myMallocHandler = MallocAllocOomHandler;
+				if (!myMallocHandler)
+					throw std::bad_alloc();
+				(*myMallocHandler)();
+			}
 		}
 		return result;
 	}
@@ -74,7 +473,7 @@ namespace tinySTL {
 		void* result = 0;
 		result = std::malloc(n); // mallocʧ
 		if (!result)
-			oomMalloc(n);
+			result = oomMalloc(n, 0);
 		return result;
 	}
 
@@ -87,6 +486,193 @@ namespace tinySTL {
 
 	using malloc_alloc = MallocAllocTemplate<0>;
 
+	/*
+	 * ֱϵͳ밴ҳӳڴ棬ڴصchunk
+	 * discardֻ黹ҳַȻЧ(ٴηʱ0)Լʹ߳
+	 * ָڴľָȥҲֶδ
+	 */
+	struct SystemPages {
+		static size_t pageSize() {
+#if defined(_WIN32)
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			return (size_t)info.dwPageSize;
+#else
+			return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+		}
+
+		// bytesֽڡalignڴ棬ʧܷnullptr
+		static void* reserve(size_t bytes, size_t align) {
+#if defined(_WIN32)
+			for (int retry = 0; retry < 8; ++retry) {
+				/* ȶռһЩַռҵλãͷźλ */
+				char* raw = (char*)VirtualAlloc(nullptr, bytes + align, MEM_RESERVE, PAGE_NOACCESS);
+				if (!raw)
+					return nullptr;
+				char* aligned = (char*)(((uintptr_t)raw + align - 1) & ~(uintptr_t)(align - 1));
+				VirtualFree(raw, 0, MEM_RELEASE);
+				void* p = VirtualAlloc(aligned, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+				if (p)
+					return p;
+			}
+			return nullptr;
+#else
+			char* raw = (char*)mmap(nullptr, bytes + align, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (raw == (char*)MAP_FAILED)
+				return nullptr;
+			/* ӳalignֽڣٰͷβĲֻȥ */
+			char* aligned = (char*)(((uintptr_t)raw + align - 1) & ~(uintptr_t)(align - 1));
+			if (aligned != raw)
+				munmap(raw, aligned - raw);
+			if (raw + align != aligned)
+				munmap(aligned + bytes, raw + align - aligned);
+			return aligned;
+#endif
+		}
+
+		// ں͸ҳӳڴ档ں˲֧THP߲Linuxʱʲô
+		// falseڴȻʹãֻǻ4KBҳ
+		static bool adviseHuge(void* p, size_t bytes) {
+#if defined(MADV_HUGEPAGE)
+			return madvise(p, bytes, MADV_HUGEPAGE) == 0;
+#else
+			(void)p;
+			(void)bytes;
+			return false;
+#endif
+		}
+
+		// ڴڴУᱻʧ(糬RLIMIT_MEMLOCK)ʱfalse
+		static bool lock(void* p, size_t bytes) {
+#if defined(_WIN32)
+			return VirtualLock(p, bytes) != 0;
+#else
+			return mlock(p, bytes) == 0;
+#endif
+		}
+
+		static void unlock(void* p, size_t bytes) {
+#if defined(_WIN32)
+			VirtualUnlock(p, bytes);
+#else
+			munlock(p, bytes);
+#endif
+		}
+
+		static void discard(void* p, size_t bytes) {
+#if defined(_WIN32)
+			VirtualAlloc(p, bytes, MEM_RESET, PAGE_READWRITE);
+#elif defined(MADV_DONTNEED)
+			madvise(p, bytes, MADV_DONTNEED);
+#endif
+		}
+
+		static size_t roundUp(size_t bytes) {
+			size_t page = pageSize();
+			return (bytes + page - 1) & ~(page - 1);
+		}
+
+		// ӳbytesֽ(ȡҳ)ʧܷnullptr
+		static void* map(size_t bytes) {
+#if defined(_WIN32)
+			return VirtualAlloc(nullptr, roundUp(bytes), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+			void* p = mmap(nullptr, roundUp(bytes), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			return p == MAP_FAILED ? nullptr : p;
+#endif
+		}
+
+		static void unmap(void* p, size_t bytes) {
+#if defined(_WIN32)
+			(void)bytes;
+			VirtualFree(p, 0, MEM_RELEASE);
+#else
+			munmap(p, roundUp(bytes));
+#endif
+		}
+
+		// mapõһڴĳnewBytesֽڡmayMoveΪfalseʱֻԭչĵַ
+		// ռ䱻ռþʧܣΪtrueʱں˿԰ҳŲµַ֧ʱnullptr
+		static void* remap(void* p, size_t oldBytes, size_t newBytes, bool mayMove) {
+#if defined(MREMAP_MAYMOVE)
+			void* q = mremap(p, roundUp(oldBytes), roundUp(newBytes), mayMove ? MREMAP_MAYMOVE : 0);
+			return q == MAP_FAILED ? nullptr : q;
+#else
+			(void)p;
+			(void)oldBytes;
+			(void)newBytes;
+			(void)mayMove;
+			return nullptr;
+#endif
+		}
+	};
+
+	/*
+	 * DefaultAllocTemplate::getStats()صͳƿաֻsetStatsEnabled
+	 * ֮ŻۼƣȡڴشСЩ״̬ǿԶ
+	 */
+	struct AllocStats {
+		struct SizeClass {
+			size_t size;           // һĶС
+			uint64_t allocs;
+			uint64_t frees;
+			size_t freeObjects;    // (̰߳汾Ϊ)ϵĶ
+			size_t cachedObjects;  // ߳Լ̻߳еĶ
+			uint64_t reFills;      // һȡաĴ
+			size_t batchObjs;      // һreFillȡٸreFillͿĳȵ
+		};
+
+		SizeClass classes[FREELISTS];
+		uint64_t largeAllocs;      // MAXBytesֱӽһķ
+		uint64_t largeFrees;
+		uint64_t reFills;
+		uint64_t chunkAllocs;
+		uint64_t oomMallocs;       // ϵͳ벻chunkֻȥһڴĴ
+		size_t poolBytes;          // startFree..endFree֮仹ûзֵֽ
+		size_t heapSize;           // ϵͳȫֽ
+		size_t residentBytes;      // heapSizeмȥtrimѾ黹Ĳ
+		size_t idleBytes;          // еֽ̻߳
+		size_t peakResidentBytes;  // ʷֵ
+		size_t peakIdleBytes;
+
+		void print(FILE* out) const {
+			std::fprintf(out, "heapSize %zu, resident %zu (peak %zu), pool %zu, idle %zu (peak %zu)\n",
+				heapSize, residentBytes, peakResidentBytes, poolBytes, idleBytes, peakIdleBytes);
+			std::fprintf(out, "reFill %llu, chunkAlloc %llu, oomMalloc %llu, large alloc/free %llu/%llu\n",
+				(unsigned long long)reFills, (unsigned long long)chunkAllocs, (unsigned long long)oomMallocs,
+				(unsigned long long)largeAllocs, (unsigned long long)largeFrees);
+			std::fprintf(out, "%8s %14s %14s %10s %10s %10s %8s\n", "size", "allocs", "frees", "free", "cached",
+				"reFills", "batch");
+			for (const SizeClass& c : classes) {
+				if (!c.allocs && !c.frees && !c.freeObjects && !c.cachedObjects)
+					continue;
+				std::fprintf(out, "%8zu %14llu %14llu %10zu %10zu %10llu %8zu\n", c.size,
+					(unsigned long long)c.allocs, (unsigned long long)c.frees, c.freeObjects, c.cachedObjects,
+					(unsigned long long)c.reFills, c.batchObjs);
+			}
+		}
+
+		void printJson(FILE* out) const {
+			std::fprintf(out, "{\"heapSize\":%zu,\"residentBytes\":%zu,\"peakResidentBytes\":%zu,"
+				"\"poolBytes\":%zu,\"idleBytes\":%zu,\"peakIdleBytes\":%zu,", heapSize, residentBytes,
+				peakResidentBytes, poolBytes, idleBytes, peakIdleBytes);
+			std::fprintf(out, "\"reFills\":%llu,\"chunkAllocs\":%llu,\"oomMallocs\":%llu,"
+				"\"largeAllocs\":%llu,\"largeFrees\":%llu,\"classes\":[",
+				(unsigned long long)reFills, (unsigned long long)chunkAllocs, (unsigned long long)oomMallocs,
+				(unsigned long long)largeAllocs, (unsigned long long)largeFrees);
+			for (size_t i = 0; i < (size_t)FREELISTS; ++i) {
+				const SizeClass& c = classes[i];
+				std::fprintf(out, "%s{\"size\":%zu,\"allocs\":%llu,\"frees\":%llu,\"freeObjects\":%zu,"
+					"\"cachedObjects\":%zu,\"reFills\":%llu,\"batchObjs\":%zu}", i ? "," : "", c.size,
+					(unsigned long long)c.allocs, (unsigned long long)c.frees, c.freeObjects, c.cachedObjects,
+					(unsigned long long)c.reFills, c.batchObjs);
+			}
+			std::fprintf(out, "]}\n");
+		}
+	};
+
 	template <bool threads, int inst>
 	class DefaultAllocTemplate {
 	private:
@@ -95,26 +681,367 @@ namespace tinySTL {
 		static size_t heapSize;
 		static union FreeList* freeList[FREELISTS];
 
+	public:
+		// 漸Ļ֣memory_resourceеĳءshm_arenaеӳͬĵ
+		// ԼĿ
+		static size_t getLog2(size_t x) { // xMAXBytesȡ
+#if defined(_MSC_VER)
+			unsigned long r;
+			_BitScanReverse(&r, (unsigned long)x);
+			return (size_t)r;
+#elif defined(__GNUC__)
+			return (size_t)(31 - __builtin_clz((unsigned)x));
+#else
+			size_t r = 0;
+			while (x >>= 1)
+				++r;
+			return r;
+#endif
+		}
+
 		static size_t getFreeListIdx(size_t bytes) { 
 			/* õֽڶӦӦȡλã0ʼ */
-			return (bytes + (size_t)ALIGN - 1) / (size_t)ALIGN - 1;
+			if (bytes <= (size_t)SMALLBytes)
+				return (bytes + (size_t)ALIGN - 1) / (size_t)ALIGN - 1;
+			/* bytes(2^k, 2^(k+1)]УȷΪSTEPSPerPow2ÿstepֽ */
+			size_t k = getLog2(bytes - 1);
+			size_t step = ((size_t)1 << k) / (size_t)STEPSPerPow2;
+			return (size_t)SMALLLists + (k - (size_t)SMALLShift) * (size_t)STEPSPerPow2
+				+ (bytes - ((size_t)1 << k) + step - 1) / step - 1;
+		}
+
+		static size_t getClassSize(size_t idx) { // idxڴС
+			if (idx < (size_t)SMALLLists)
+				return (idx + 1) * (size_t)ALIGN;
+			size_t j = idx - (size_t)SMALLLists;
+			size_t base = (size_t)1 << ((size_t)SMALLShift + j / (size_t)STEPSPerPow2);
+			return base + (j % (size_t)STEPSPerPow2 + 1) * (base / (size_t)STEPSPerPow2);
+		}
+
+		static size_t getClassAlign(size_t size) { // һȻ
+			size_t align = size & (~size + 1);
+			return align < (size_t)MAXAlign ? align : (size_t)MAXAlign;
+		}
+
+		// 뵽alignʹһСȡalignıҴСҲalign
+		// һһĶȻalignġҲʱ0
+		static size_t getAlignedSize(size_t n, size_t align) {
+			size_t bytes = ((n ? n : 1) + align - 1) & ~(align - 1);
+			if (bytes > (size_t)MAXBytes)
+				return 0;
+			size_t idx = getFreeListIdx(bytes);
+			while (idx < (size_t)FREELISTS && (getClassSize(idx) & (align - 1)))
+				++idx;
+			return idx < (size_t)FREELISTS ? getClassSize(idx) : 0;
 		}
 
+	private:
 		static size_t getRoundUp(size_t bytes) { // ֽȡ8ı
 			/* 
 			 * ~(ALIGN-1)ʾ11...1000ȼȥ8ȼ
 			 * [(bytes+7)/8]*8λЧ
 			 * reference to https://www.zhihu.com/question/41043015
 			 */
+			if (bytes > (size_t)SMALLBytes) // ڶֱȡڵĴС
+				return getClassSize(getFreeListIdx(bytes));
 			return (bytes + (size_t)ALIGN - 1) & (~(ALIGN - 1));
 		}
 
+		// һĬϸСTCACHEBatchSPANBytesΪֹ黹
+		// ̵߳ĶҲܳһ
+		static int getRefillObjs(size_t size) {
+			if (size <= (size_t)SMALLBytes)
+				return (int)TCACHEBatch;
+			size_t objs = (size_t)SPANBytes / size;
+			return objs > (size_t)TCACHEBatch ? (int)TCACHEBatch : (int)objs;
+		}
+
+		// idxǰһĸûеʱĬֵ
+		static int getBatch(size_t idx) {
+			int batch = batchObjs[idx].load(std::memory_order_relaxed);
+			return batch ? batch : getRefillObjs(getClassSize(idx));
+		}
+		// һޣREFILLBytes
+		static int getMaxBatch(size_t idx) {
+			size_t objs = (size_t)REFILLBytes / getClassSize(idx);
+			return objs < (size_t)REFILLMax ? (int)(objs ? objs : 1) : (int)REFILLMax;
+		}
+		static int getMinBatch(size_t idx) {
+			int most = getMaxBatch(idx);
+			return most < (int)REFILLMin ? most : (int)REFILLMin;
+		}
+		// ȡʱʱ롣߳ͬʱʱֻһα仯Ӱȷ
+		static void growBatch(size_t idx) {
+			int batch = getBatch(idx);
+			int most = getMaxBatch(idx);
+			batchObjs[idx].store(batch < most / 2 ? 2 * batch : most, std::memory_order_relaxed);
+		}
+		static void shrinkBatch(size_t idx) {
+			int batch = getBatch(idx);
+			int least = getMinBatch(idx);
+			batchObjs[idx].store(batch / 2 > least ? batch / 2 : least, std::memory_order_relaxed);
+		}
+
 		static void* reFill(size_t n); // ڴ,nʾҪڴĴС
-		static char* chunkAlloc(size_t size, int& objs); // ڴڴobjsÿsizeС
+		// ڴڴobjsÿsizeСsharedΪtrueʱ̰߳汾Ҳӹ
+		// ڴз֣ɵ߳poolMutexгchunkκ߳
+		static char* chunkAlloc(size_t size, int& objs, bool shared = false);
+
+		/*
+		 * ÿchunkͷ¼ϵͳchunktrimʱȰfreeBytes㣬
+		 * ٰѿڴʣռ䰴chunkۼȥڿÿռchunk
+		 * ˵ѾûдĶˡ
+		 */
+		struct ThreadCache;
+
+		struct ChunkHeader {
+			ChunkHeader* next;         // chunkɵ
+			ChunkHeader* nextReleased; // ҳѹ黹ȴõchunk
+			size_t freeBytes;
+			std::atomic<ThreadCache*> owner; // chunkзֶ̣߳߳˳Ϊ
+			bool released;
+			bool pinned;               // ϵͳʧʱһõchunkܹ黹
+		};
+		static_assert(sizeof(ChunkHeader) <= (size_t)CHUNKHeader, "chunk header too large");
+
+		static ChunkHeader* chunkList;
+		static ChunkHeader* releasedChunks;
+		static std::atomic<size_t> idleBytes;  // еֽ
+		static size_t trimMark;                // һtrim֮ʣµĿֽ
+		static size_t trimThreshold;
+		static bool hugeArena;   // ǷӴҳзchunk
+		static bool lockedPages; // chunkǷmlockڴУpoolMutex
+		static std::atomic<int> batchObjs[FREELISTS]; // ÿһһĸ0ʾĬֵ
+		static char* arenaFree;  // ǰҳлûгȥĲ
+		static char* arenaEnd;
+
+		static ChunkHeader* getChunk(char* p) {
+			return (ChunkHeader*)((uintptr_t)p & ~(uintptr_t)(CHUNKBytes - 1));
+		}
+
+		static char* newChunk(ThreadCache* owner);
+		static void stashLeftover(char* p, size_t bytes); // вͷɵ󵵹ҵ
+		static void addIdle(size_t bytes, bool add);
+		static void checkTrim();
+
+		/*
+		 * threadsΪtrueʱfreeListʹã̹߳centralList
+		 * startFreeendFreeheapSizeΪڴأpoolMutexֻ
+		 * ҲҪзڴʱŻÿ߳һThreadCacheͷŶ
+		 * ̻߳ɣҪκԭӲֻȡ/黹ʱŷ
+		 */
+		/*
+		 * ̰߳汾ÿ̴߳Լchunkзֶ(startFree/endFree)chunkͷ
+		 * owner߳ͷЩʱŽԼĻ棬ѹownerremoteFree
+		 * һߵߵownerڱ̻߳˵ʱȡء
+		 * ͷŷȰͬһownerĶremoteBatchܳһһһCAS
+		 * "һ̷߳䡢һ߳ͷ"ˮУڴص̣߳
+		 * ǶѻͷŷĻ
+		 * ߳˳ThreadCacheͷţǹretiredCaches̸߳ã
+		 * ͷŷõownerָЧģ˳ѹĶɸȡء
+		 */
+		struct RemoteBatch {
+			ThreadCache* owner;
+			FreeList* head;
+			FreeList* tail;
+			size_t count;
+		};
+
+		struct ThreadCache {
+			FreeList* freeList[FREELISTS];
+			size_t listSize[FREELISTS];
+			AtomicFreeList remoteFree[FREELISTS];
+			RemoteBatch remoteBatch[FREELISTS]; // ׼̵߳Ķ
+			char* startFree;
+			char* endFree;
+			ThreadCache* nextRetired;
+		};
+
+		struct ThreadCacheReaper { // ߳˳ʱѻеĶ󻹸ڴ
+			~ThreadCacheReaper() { releaseThreadCache(); }
+		};
+
+		static AtomicFreeList centralList[FREELISTS];
+		static std::mutex poolMutex;
+		static thread_local ThreadCache* threadCache;
+		static thread_local bool threadCacheDead; // ̻߳Ѿգ֮ķֱڴ
+		static ThreadCache* retiredCaches;        // ˳̵߳Ļ棬poolMutex
+
+		static ThreadCache* getThreadCache();
+		static void releaseThreadCache();
+		static void* threadAllocate(size_t n);
+		static void threadDeallocate(void* p, size_t n);
+		static void returnToCentral(FreeList* head, FreeList* tail, size_t cnt, size_t idx); // һһ
+		static FreeList* takeFromCentral(size_t idx); // ȡһ
+		static void drainRemote(ThreadCache* tc, size_t idx); // ̻߳Ķȡ̻߳
+		static void flushRemote(ThreadCache* tc, size_t idx); // µĶ󻹸ǵowner
+		static void flushThreadCache(ThreadCache* tc);        // ̻߳еĶ󶼻
+
+		/*
+		 * ͳƼÿ߳һݣֻ߳޸ģҪԭӵĶ--дͨload/store
+		 * ͹(atomicֻΪ˻ʱȡݾ)̵߳ļstatsListϣ
+		 * getStatsʱۼӣ߳˳ʱԼļretiredStats
+		 */
+		enum {
+			STATAlloc = 0,                // ÿһķ
+			STATFree = FREELISTS,         // ÿһͷŴ
+			STATClassReFill = 2 * FREELISTS, // ÿһreFill
+			STATLargeAlloc = 3 * FREELISTS,
+			STATLargeFree,
+			STATReFill,
+			STATChunkAlloc,
+			STATOomMalloc,
+			STATCount,
+		};
+
+		struct StatsCounters {
+			std::atomic<uint64_t> count[STATCount];
+			StatsCounters* next;
+		};
+
+		struct StatsReaper {
+			~StatsReaper() { releaseStatsCounters(); }
+		};
+
+		static std::atomic<bool> statsEnabled;
+		static StatsCounters* statsList;
+		static StatsCounters retiredStats;
+		static std::mutex statsMutex;
+		static thread_local StatsCounters* statsCounters;
+		static thread_local bool statsDead;
+		static std::atomic<size_t> centralCount[FREELISTS]; // ϵĶֻ಻
+		static size_t releasedBytes;
+		static size_t peakResidentBytes;
+		static std::atomic<size_t> peakIdleBytes;
+
+		static StatsCounters* getStatsCounters();
+		static void releaseStatsCounters();
+
+		static void countStat(size_t which, uint64_t cnt = 1) {
+			if (!statsEnabled.load(std::memory_order_relaxed))
+				return;
+			StatsCounters* c = getStatsCounters();
+			if (c)
+				c->count[which].store(c->count[which].load(std::memory_order_relaxed) + cnt, std::memory_order_relaxed);
+			else
+				retiredStats.count[which].fetch_add(cnt, std::memory_order_relaxed);
+		}
+
+		static MemoryBudget budget; // ͳӳchunkʹڴ
+
+		// ڴԤֽӳİҳ
+		static size_t getLargeBytes(size_t n) {
+			return n < (size_t)MMAPBytes ? n : SystemPages::roundUp(n);
+		}
+		// ûصͷڴ棬ٰchunkеҳϵͳǷнչ
+		// ܳpoolMutex
+		static bool relievePressure(int level, size_t want);
+		// Խ޺µѹﴦֻڲ·ϵ
+		static void checkPressure() {
+			if (!budget.underPressure())
+				return;
+			size_t used = budget.used();
+			size_t soft = budget.getSoftLimit();
+			relievePressure(MemoryBudget::SOFTLevel, used > soft ? used - soft : 0);
+		}
+		// bytesֽڣᳬӲʱҪͷţȻŲ¾׳bad_alloc
+		static void chargeBudget(size_t bytes);
+		// oldBytesĳnewBytesĲȼԤ㣬resizeʧ˻
+		template <typename Resize>
+		static bool resizeInBudget(size_t oldBytes, size_t newBytes, Resize resize) {
+			if (newBytes > oldBytes && !budget.charge(newBytes - oldBytes))
+				return false;
+			bool ok = resize();
+			if (ok ? newBytes < oldBytes : newBytes > oldBytes)
+				budget.release(ok ? oldBytes - newBytes : newBytes - oldBytes);
+			return ok;
+		}
+		// Ԥϵͳڴ治ʱreFill׳bad_allocʱѾҪͷź
+		static void* budgetReFill(size_t n);
+
+		static void notePeakResident() { // ʱҪpoolMutex
+			if (heapSize - releasedBytes > peakResidentBytes)
+				peakResidentBytes = heapSize - releasedBytes;
+		}
 
 	public:
 		static void* allocate(size_t n);
 		static void deallocate(void* p, size_t n);
+		// alignMAXAlignʱӴСΪalignĵз䣬򽻸һ
+		// ͷʱҪͬnalign
+		static void* allocate(size_t n, size_t align) {
+			if (align <= (size_t)ALIGN)
+				return allocate(n);
+			size_t size = align <= (size_t)MAXAlign ? getAlignedSize(n, align) : 0;
+			if (size)
+				return allocate(size);
+			countStat(STATLargeAlloc);
+			chargeBudget(n);
+			try {
+				return malloc_alloc::allocate(n, align);
+			}
+			catch (...) {
+				budget.release(n);
+				throw;
+			}
+		}
+		static void deallocate(void* p, size_t n, size_t align) {
+			if (align <= (size_t)ALIGN)
+				return deallocate(p, n);
+			size_t size = align <= (size_t)MAXAlign ? getAlignedSize(n, align) : 0;
+			if (size)
+				return deallocate(p, size);
+			countStat(STATLargeFree);
+			malloc_alloc::deallocate(p, n, align);
+			budget.release(n);
+		}
+
+		// ԭذoldSizeֽڵpĳnewSizeֽڣɹҪnewSizeͷšͬһĶ
+		// ǳɹmallocĴ鿴mallocӳĴ鳢ԲŲmremap
+		static bool tryExpand(void* p, size_t oldSize, size_t newSize);
+		// ԭչʱӳĴmremapƣmallocĴreallocķ
+		// ռֽڸơֻڿ԰ֽڰƵĶ
+		static void* reallocate(void* p, size_t oldSize, size_t newSize);
+
+		// һȡcountnֽڵĶŵoutСժ̻߳/ϵĶ
+		// ʱֱӴڴзٰ֣гĶҵһȡ
+		static void allocateBatch(size_t n, size_t count, void** out);
+		// һι黹countnֽڵĶȰǴһιһؿ
+		static void deallocateBatch(size_t n, void** ptrs, size_t count);
+
+		// ѶѾȫͷŵchunkҳϵͳع黹ֽ̰߳汾
+		// ֻܿͱ̵߳Ļ棬̻߳еĶڵchunkᱻ黹
+		static size_t trim();
+		// еֽһtrimbytesʱԶtrim0ʾر
+		static void setTrimThreshold(size_t bytes) { trimThreshold = bytes; }
+		// /رմҳarenaģʽֻӰ֮chunkӦڵһη֮ǰá
+		// trim黹ҳеchunkʱں˻ҳ4KBҳ
+		static void setHugePageArena(bool on) { hugeArena = on; }
+
+		/*
+		 * ʱԤȣΪnֽһ׼countзֳֽ֮дһ飬ҳ
+		 * ǰӳãٹҵ(̰߳汾ÿ̵߳һreFill
+		 * ȡ)֮ĵһȱҳreFill̰߳汾ӹڴз֣
+		 * Щκ̣߳ĸ߳ͷžĸ̵߳Ļ
+		 * nMAXBytesʱʲô
+		 */
+		static void prewarm(size_t n, size_t count);
+		// counts[i]ǵiҪ׼ĶһFREELISTS
+		static void prewarm(const size_t* counts);
+		// chunk(֮)mlockڴУⱻٴȱҳonΪfalseʱ
+		// ǷȫɹʧʱѾĲֱtrim黹chunk֮ǰȽ
+		static bool setLockPages(bool on);
+
+		// ڴصԤ㡣chunkʹڴ涼룬setLimitsӲޣ
+		// addCallbackעѹصԽ޻ߵӲʱȵûصϵͳ
+		// Ѷ󻹻trimѿеchunkϵͳӲͷŲʱ׳bad_alloc
+		static MemoryBudget& getBudget() { return budget; }
+
+		// /رշȼرʱ·ֻһж
+		static void setStatsEnabled(bool on) { statsEnabled.store(on, std::memory_order_relaxed); }
+		// ̵߳ļõǰͳƿա̰߳汾
+		// ܺͷ䡢ͷͬʱ
+		static AllocStats getStats();
 	};
 
 	template <bool threads, int inst>
@@ -129,13 +1056,115 @@ namespace tinySTL {
 	template <bool threads, int inst>
 	FreeList* DefaultAllocTemplate<threads, inst>::freeList[FREELISTS] = { nullptr };
 
+	template <bool threads, int inst>
+	AtomicFreeList DefaultAllocTemplate<threads, inst>::centralList[FREELISTS];
+
+	template <bool threads, int inst>
+	typename DefaultAllocTemplate<threads, inst>::ChunkHeader*
+		DefaultAllocTemplate<threads, inst>::chunkList = nullptr;
+
+	template <bool threads, int inst>
+	typename DefaultAllocTemplate<threads, inst>::ChunkHeader*
+		DefaultAllocTemplate<threads, inst>::releasedChunks = nullptr;
+
+	template <bool threads, int inst>
+	std::atomic<size_t> DefaultAllocTemplate<threads, inst>::idleBytes{ 0 };
+
+	template <bool threads, int inst>
+	size_t DefaultAllocTemplate<threads, inst>::trimMark = 0;
+
+	template <bool threads, int inst>
+	size_t DefaultAllocTemplate<threads, inst>::trimThreshold = 0;
+
+	template <bool threads, int inst>
+	bool DefaultAllocTemplate<threads, inst>::hugeArena = false;
+
+	template <bool threads, int inst>
+	bool DefaultAllocTemplate<threads, inst>::lockedPages = false;
+
+	template <bool threads, int inst>
+	std::atomic<int> DefaultAllocTemplate<threads, inst>::batchObjs[FREELISTS];
+
+	template <bool threads, int inst>
+	char* DefaultAllocTemplate<threads, inst>::arenaFree = nullptr;
+
+	template <bool threads, int inst>
+	char* DefaultAllocTemplate<threads, inst>::arenaEnd = nullptr;
+
+	template <bool threads, int inst>
+	std::mutex DefaultAllocTemplate<threads, inst>::poolMutex;
+
+	template <bool threads, int inst>
+	thread_local typename DefaultAllocTemplate<threads, inst>::ThreadCache*
+		DefaultAllocTemplate<threads, inst>::threadCache = nullptr;
+
+	template <bool threads, int inst>
+	thread_local bool DefaultAllocTemplate<threads, inst>::threadCacheDead = false;
+
+	template <bool threads, int inst>
+	typename DefaultAllocTemplate<threads, inst>::ThreadCache*
+		DefaultAllocTemplate<threads, inst>::retiredCaches = nullptr;
+
+	template <bool threads, int inst>
+	std::atomic<bool> DefaultAllocTemplate<threads, inst>::statsEnabled{ false };
+
+	template <bool threads, int inst>
+	typename DefaultAllocTemplate<threads, inst>::StatsCounters*
+		DefaultAllocTemplate<threads, inst>::statsList = nullptr;
+
+	template <bool threads, int inst>
+	typename DefaultAllocTemplate<threads, inst>::StatsCounters
+		DefaultAllocTemplate<threads, inst>::retiredStats;
+
+	template <bool threads, int inst>
+	std::mutex DefaultAllocTemplate<threads, inst>::statsMutex;
+
+	template <bool threads, int inst>
+	thread_local typename DefaultAllocTemplate<threads, inst>::StatsCounters*
+		DefaultAllocTemplate<threads, inst>::statsCounters = nullptr;
+
+	template <bool threads, int inst>
+	thread_local bool DefaultAllocTemplate<threads, inst>::statsDead = false;
+
+	template <bool threads, int inst>
+	std::atomic<size_t> DefaultAllocTemplate<threads, inst>::centralCount[FREELISTS];
+
+	template <bool threads, int inst>
+	size_t DefaultAllocTemplate<threads, inst>::releasedBytes = 0;
+
+	template <bool threads, int inst>
+	size_t DefaultAllocTemplate<threads, inst>::peakResidentBytes = 0;
+
+	template <bool threads, int inst>
+	std::atomic<size_t> DefaultAllocTemplate<threads, inst>::peakIdleBytes{ 0 };
+
+	template <bool threads, int inst>
+	MemoryBudget DefaultAllocTemplate<threads, inst>::budget;
+
 	template<bool threads, int inst>
 	void* DefaultAllocTemplate<threads, inst>::allocate(size_t n) {
 		void* ret;
+		countStat(MAXBytes < n ? (size_t)STATLargeAlloc : STATAlloc + getFreeListIdx(n));
 		// _MAXBYTESֽΪǴڴ棬ֱӵһռ
 		if (MAXBytes < n) { 
-
-			ret = malloc_alloc::allocate(n);
+			size_t bytes = getLargeBytes(n);
+			chargeBudget(bytes);
+			if (n < (size_t)MMAPBytes) {
+				try {
+					ret = malloc_alloc::allocate(n);
+				}
+				catch (...) {
+					budget.release(bytes);
+					throw;
+				}
+			}
+			else if (!(ret = SystemPages::map(n))) {
+				budget.release(bytes);
+				throw std::bad_alloc();
+			}
+		}
+		else if (threads) {
+			ret = threadAllocate(n);
 		}
 		else {
 			// myFreeListָnȡ8ĵַ
@@ -143,7 +1172,7 @@ namespace tinySTL {
 			FreeList* result = *nowLoc;
 			if (!result) {
 				/* ûпռʱз */
-				ret = reFill(getRoundUp(n));
+				ret = budgetReFill(getRoundUp(n));
 			}
 			else {
 				/* 
@@ -152,6 +1181,7 @@ namespace tinySTL {
 				 */
 				*nowLoc = result->next; 
 				ret = result;
+				addIdle(getRoundUp(n), false);
 			}
 		}
 		return ret;
@@ -159,27 +1189,239 @@ namespace tinySTL {
 
 	template <bool threads, int inst>
 	void DefaultAllocTemplate<threads, inst>::deallocate(void* p, size_t n) {
+		countStat(MAXBytes < n ? (size_t)STATLargeFree : STATFree + getFreeListIdx(n));
 		if (MAXBytes < n) {
-			malloc_alloc::deallocate(p);
+			if (n < (size_t)MMAPBytes)
+				malloc_alloc::deallocate(p);
+			else
+				SystemPages::unmap(p, n);
+			budget.release(getLargeBytes(n));
+		}
+		else if (threads) {
+			threadDeallocate(p, n);
 		}
 		else {
 			FreeList* q = (FreeList*)p;
 			FreeList** nowLoc = freeList + getFreeListIdx(n);
 			q->next = *nowLoc;
 			*nowLoc = q; // ָpͷ
+			addIdle(getRoundUp(n), true);
+			checkTrim();
 		}
 	}
 
+	template <bool threads, int inst>
+	bool DefaultAllocTemplate<threads, inst>::tryExpand(void* p, size_t oldSize, size_t newSize) {
+		if (oldSize <= (size_t)MAXBytes || newSize <= (size_t)MAXBytes) {
+			/* Сͬһʱʲô */
+			return oldSize <= (size_t)MAXBytes && newSize <= (size_t)MAXBytes &&
+				getFreeListIdx(oldSize) == getFreeListIdx(newSize);
+		}
+		if (oldSize < (size_t)MMAPBytes || newSize < (size_t)MMAPBytes) {
+			return oldSize < (size_t)MMAPBytes && newSize < (size_t)MMAPBytes &&
+				resizeInBudget(oldSize, newSize, [=]() { return malloc_alloc::tryExpand(p, oldSize, newSize); });
+		}
+		size_t oldBytes = SystemPages::roundUp(oldSize);
+		size_t newBytes = SystemPages::roundUp(newSize);
+		return resizeInBudget(oldBytes, newBytes, [=]() {
+			if (newBytes < oldBytes)
+				SystemPages::unmap((char*)p + newBytes, oldBytes - newBytes);
+			return newBytes <= oldBytes || SystemPages::remap(p, oldSize, newSize, false);
+		});
+	}
+
+	template <bool threads, int inst>
+	void* DefaultAllocTemplate<threads, inst>::reallocate(void* p, size_t oldSize, size_t newSize) {
+		if (tryExpand(p, oldSize, newSize))
+			return p;
+		/* Ԥʱ˻ص¿ռ·allocateҪͷڴ */
+		if (oldSize >= (size_t)MMAPBytes && newSize >= (size_t)MMAPBytes) {
+			void* q = nullptr;
+			if (resizeInBudget(getLargeBytes(oldSize), getLargeBytes(newSize),
+				[&]() { return (q = SystemPages::remap(p, oldSize, newSize, true)) != nullptr; }))
+				return q;
+		}
+		else if (oldSize > (size_t)MAXBytes && oldSize < (size_t)MMAPBytes &&
+			newSize > (size_t)MAXBytes && newSize < (size_t)MMAPBytes) {
+			void* q = nullptr;
+			if (resizeInBudget(oldSize, newSize, [&]() {
+				try {
+					q = malloc_alloc::reallocate(p, oldSize, newSize);
+				}
+				catch (const std::bad_alloc&) {
+					return false;
+				}
+				return true;
+			}))
+				return q;
+		}
+		void* q = allocate(newSize);
+		std::memcpy(q, p, oldSize < newSize ? oldSize : newSize);
+		deallocate(p, oldSize);
+		return q;
+	}
+
+	template <bool threads, int inst>
+	void DefaultAllocTemplate<threads, inst>::allocateBatch(size_t n, size_t count, void** out) {
+		if (MAXBytes < n) {
+			for (size_t i = 0; i < count; ++i)
+				out[i] = allocate(n);
+			return;
+		}
+		size_t idx = getFreeListIdx(n);
+		size_t size = getClassSize(idx);
+		size_t got = 0;
+		countStat(STATAlloc + idx, count);
+		ThreadCache* tc = threads ? getThreadCache() : nullptr;
+		if (threads) {
+			/* ȴ̻߳ȡ */
+			if (tc) {
+				if (!tc->freeList[idx])
+					drainRemote(tc, idx);
+				FreeList* p = tc->freeList[idx];
+				for (; p && got < count; p = p->next)
+					out[got++] = p;
+				tc->freeList[idx] = p;
+				tc->listSize[idx] -= got;
+			}
+			/* һժ£òĲѹȥ */
+			if (got < count && !centralList[idx].empty()) {
+				FreeList* p = centralList[idx].popAll();
+				size_t taken = 0;
+				for (; p && got < count; p = p->next, ++taken)
+					out[got++] = p;
+				if (p) {
+					FreeList* tail = p;
+					while (tail->next)
+						tail = tail->next;
+					centralList[idx].push(p, tail);
+				}
+				centralCount[idx].fetch_sub(taken, std::memory_order_relaxed);
+				addIdle(taken * size, false);
+			}
+		}
+		else {
+			FreeList* p = freeList[idx];
+			size_t taken = 0;
+			for (; p && got < count; p = p->next, ++taken)
+				out[got++] = p;
+			freeList[idx] = p;
+			addIdle(taken * size, false);
+		}
+		if (got == count)
+			return;
+
+		/* ϵĲʣµֱӴڴз */
+		std::unique_lock<std::mutex> lock(poolMutex, std::defer_lock);
+		if (threads && !tc)
+			lock.lock();
+		try {
+			while (got < count) {
+				size_t want = count - got;
+				int objs = want > (size_t)INT_MAX / size ? INT_MAX / (int)size : (int)want;
+				countStat(STATChunkAlloc);
+				char* chunk = chunkAlloc(size, objs);
+				for (int i = 0; i < objs; ++i)
+					out[got++] = chunk + (size_t)i * size;
+			}
+		}
+		catch (const std::bad_alloc&) {
+			/* ڴ治ʱѾȡĶҪȥϵͳóڴ */
+			if (lock.owns_lock())
+				lock.unlock();
+			deallocateBatch(n, out, got);
+			if (!relievePressure(MemoryBudget::HARDLevel, count * size))
+				throw;
+			allocateBatch(n, count, out);
+			return;
+		}
+		if (lock.owns_lock())
+			lock.unlock();
+		checkPressure();
+	}
+
+	template <bool threads, int inst>
+	void DefaultAllocTemplate<threads, inst>::deallocateBatch(size_t n, void** ptrs, size_t count) {
+		if (!count)
+			return;
+		if (MAXBytes < n) {
+			for (size_t i = 0; i < count; ++i)
+				deallocate(ptrs[i], n);
+			return;
+		}
+		size_t idx = getFreeListIdx(n);
+		countStat(STATFree + idx, count);
+		/* ȴһ */
+		FreeList* head = (FreeList*)ptrs[0];
+		FreeList* tail = head;
+		for (size_t i = 1; i < count; ++i) {
+			FreeList* q = (FreeList*)ptrs[i];
+			tail->next = q;
+			tail = q;
+		}
+		tail->next = nullptr;
+		if (threads) {
+			ThreadCache* tc = getThreadCache();
+			size_t batch = (size_t)getBatch(idx);
+			if (tc && tc->listSize[idx] + count <= 2 * batch) {
+				tail->next = tc->freeList[idx];
+				tc->freeList[idx] = head;
+				tc->listSize[idx] += count;
+				return;
+			}
+			/* ̻߳Ų¾ֻҪһCAS */
+		}
+		returnToCentral(head, tail, count, idx);
+		checkTrim();
+	}
+
 	template<bool threads, int inst>
 	void* DefaultAllocTemplate<threads, inst>::reFill(size_t n) {
-		/*  */
-		int objs = 20;
+		/* һȡˣһζȡһЩ */
+		size_t idx = getFreeListIdx(n);
+		int objs = getBatch(idx);
+		growBatch(idx);
+		countStat(STATReFill);
+		countStat(STATClassReFill + idx);
+		FreeList** myFreeList = freeList + idx;
+		ThreadCache* tc = nullptr;
+		std::unique_lock<std::mutex> lock(poolMutex, std::defer_lock);
+		if (threads) {
+			/* ߳ʱǱ̵߳Ļ棬̻߳ѻʱֻȡһ */
+			tc = getThreadCache();
+			objs = tc ? objs : 1;
+			/* ̹߳黹Ķʱֱժһؼзڴ */
+			FreeList* head;
+			FreeList* tail;
+			size_t cnt = centralList[idx].popBatch(head, tail, (size_t)objs);
+			if (cnt) {
+				centralCount[idx].fetch_sub(cnt, std::memory_order_relaxed);
+				addIdle(cnt * n, false);
+				if (tc) {
+					tail->next = tc->freeList[idx];
+					tc->freeList[idx] = head->next;
+					tc->listSize[idx] += cnt - 1;
+				}
+				return head;
+			}
+			if (!tc)
+				lock.lock(); // ̻߳ѻʱзֹڴ
+		}
+		countStat(STATChunkAlloc);
 		char* chunk = chunkAlloc(n, objs);    // ΪûУҪڴ룬ٹҵ
+		if (threads) {
+			if (!tc)
+				return chunk;
+			myFreeList = tc->freeList + idx;
+			tc->listSize[idx] += objs - 1;
+		}
 		if (1 == objs) // ɹĿռֻһֱӷ
 			return chunk;
+		if (!threads)
+			addIdle((objs - 1) * n, true);
 
 		FreeList* ret = (FreeList*)chunk;
-		FreeList** myFreeList = freeList + getFreeListIdx(n);
+		FreeList* rest = *myFreeList; // ѹص֮ǰϻ˶󣬽¶
 		*myFreeList = (FreeList*)(chunk + n); // ΪʲônΪɵchunkڴҪʹõģ˺һchunk
 		FreeList* cur = *myFreeList;
 		FreeList* next = nullptr;
@@ -189,15 +1431,38 @@ namespace tinySTL {
 			cur->next = next;
 			cur = next;
 		}
-		cur->next = nullptr;
+		cur->next = rest;
 		return ret;
 	}
 
 	template<bool threads, int inst>
-	char* DefaultAllocTemplate<threads, inst>::chunkAlloc(size_t size, int& objs) {
+	char* DefaultAllocTemplate<threads, inst>::chunkAlloc(size_t size, int& objs, bool shared) {
+		/* 
+		 * ̰߳汾ӱ߳ԼstartFree/endFreeз֣Ҫֻchunkʱ
+		 * ż̻߳ѻʱʹùڴأɵ߼
+		 */
+		ThreadCache* tc = threads && !shared ? threadCache : nullptr;
+		char*& startFree = tc ? tc->startFree : DefaultAllocTemplate::startFree;
+		char*& endFree = tc ? tc->endFree : DefaultAllocTemplate::endFree;
 		char* result = nullptr;
 		/* ηҪпռ */
 		size_t totalBytes = size * objs;
+		if (size > (size_t)SMALLBytes && startFree) {
+			/* ҳ߽翪ʼз֣ͷҵСϣŲ¾Ͳ */
+			char* aligned = (char*)(((uintptr_t)startFree + PAGEBytes - 1) & ~(uintptr_t)(PAGEBytes - 1));
+			if (aligned != startFree && aligned + totalBytes <= endFree) {
+				stashLeftover(startFree, aligned - startFree);
+				startFree = aligned;
+			}
+		}
+		/* һȻз֣һ󶼷Ų¾͵ڴѾ */
+		size_t align = getClassAlign(size);
+		char* aligned = (char*)(((uintptr_t)startFree + align - 1) & ~(uintptr_t)(align - 1));
+		if (aligned != startFree) {
+			char* start = aligned + size <= endFree ? aligned : endFree;
+			stashLeftover(startFree, start - startFree);
+			startFree = start;
+		}
 		/* ڴʣռ */
 		size_t leftBytes = endFree - startFree;
 		if (leftBytes >= totalBytes) {
@@ -215,42 +1480,895 @@ namespace tinySTL {
 		}
 		else {
 			/* һĿڴ涼޷ṩ */
-			size_t newBytes = 2 * totalBytes + getRoundUp(heapSize >> 4); // һλ2λ16
-			if (leftBytes > 0) {
-				/* дһЩռ뵽 */
-				FreeList** nowLoc = freeList + getFreeListIdx(leftBytes);
-				((FreeList*)startFree)->next = *nowLoc;
-				*nowLoc = (FreeList*)startFree;
-			}
+			/* дһЩռ뵽 */
+			stashLeftover(startFree, leftBytes);
 
-			startFree = (char*)std::malloc(newBytes);
+			std::unique_lock<std::mutex> lock(poolMutex, std::defer_lock);
+			if (tc)
+				lock.lock();
+			startFree = newChunk(tc);
 			if (!startFree) { 
+				endFree = nullptr;
+				countStat(STATOomMalloc);
 				/* 
 				 * ʧܵĻϵͳѾûڴˣʱǾҪ
 				 * һnڴ飬ûеĻǾ͵һռ 
 				 */
-				for (size_t i = size; i < (size_t)MAXBytes; i += (size_t)ALIGN) {
-					FreeList** nowLoc = freeList + getFreeListIdx(i);
-					FreeList* p = *nowLoc;
+				for (size_t i = getFreeListIdx(size); i < (size_t)FREELISTS; ++i) {
+					FreeList* p = takeFromCentral(i);
 					if (p) {
 						startFree = (char*)p;
-						*nowLoc = p->next;
-						endFree = startFree + i;
-						return chunkAlloc(size, objs);
+						endFree = startFree + getClassSize(i);
+						if (lock.owns_lock())
+							lock.unlock();
+						return chunkAlloc(size, objs, shared);
 					}
 				}
-				/* ûڴʹʱֻܵһռ */
-				endFree = nullptr;
-				startFree = (char*)malloc_alloc::allocate(newBytes);
+				/* 
+				 * ûڴʹʱֻܵһռ䣬Ҫһchunk
+				 * С룬chunkû黹ΪpinnedԤʱ׳bad_alloc
+				 * ɲĵҪͷڴ
+				 */
+				if (!budget.charge(2 * (size_t)CHUNKBytes))
+					throw std::bad_alloc();
+				char* raw;
+				try {
+					raw = (char*)malloc_alloc::allocate(2 * (size_t)CHUNKBytes);
+				}
+				catch (...) {
+					budget.release(2 * (size_t)CHUNKBytes);
+					throw;
+				}
+				ChunkHeader* chunk = getChunk(raw + CHUNKBytes);
+				chunk->next = chunkList;
+				chunk->nextReleased = nullptr;
+				chunk->freeBytes = 0;
+				chunk->owner.store(tc, std::memory_order_relaxed);
+				chunk->released = false;
+				chunk->pinned = true;
+				chunkList = chunk;
+				heapSize += 2 * (size_t)CHUNKBytes;
+				notePeakResident();
+				startFree = (char*)chunk + CHUNKHeader;
+			}
+
+			endFree = (char*)getChunk(startFree) + CHUNKBytes;
+			if (lock.owns_lock())
+				lock.unlock();
+			return chunkAlloc(size, objs, shared);
+		}
+	}
+
+	template <bool threads, int inst>
+	typename DefaultAllocTemplate<threads, inst>::ThreadCache*
+	DefaultAllocTemplate<threads, inst>::getThreadCache() {
+		ThreadCache* tc = threadCache;
+		if (tc || threadCacheDead)
+			return tc;
+		/* һʹʱע߳˳ʱĻն */
+		static thread_local ThreadCacheReaper reaper;
+		(void)reaper;
+		{
+			/* ȸ˳̵߳Ļ棬remoteFreeϿܻж֮ᱻȡ */
+			std::lock_guard<std::mutex> guard(poolMutex);
+			tc = retiredCaches;
+			if (tc)
+				retiredCaches = tc->nextRetired;
+		}
+		if (!tc)
+			tc = new (malloc_alloc::allocate(sizeof(ThreadCache))) ThreadCache();
+		threadCache = tc;
+		return tc;
+	}
+
+	template <bool threads, int inst>
+	void DefaultAllocTemplate<threads, inst>::releaseThreadCache() {
+		ThreadCache* tc = threadCache;
+		threadCache = nullptr;
+		threadCacheDead = true;
+		if (!tc)
+			return;
+		flushThreadCache(tc);
+
+		std::lock_guard<std::mutex> guard(poolMutex);
+		/* ̵߳chunkowner֮߳ͷŵĶֱӻ */
+		for (ChunkHeader* chunk = chunkList; chunk; chunk = chunk->next) {
+			if (chunk->owner.load(std::memory_order_relaxed) == tc)
+				chunk->owner.store(nullptr, std::memory_order_relaxed);
+		}
+		stashLeftover(tc->startFree, tc->endFree - tc->startFree);
+		tc->startFree = tc->endFree = nullptr;
+		/* owner֮ǰͶtcܻ߳̿ѹȡһΣʣµ */
+		flushThreadCache(tc);
+		tc->nextRetired = retiredCaches;
+		retiredCaches = tc;
+	}
+
+	template <bool threads, int inst>
+	void DefaultAllocTemplate<threads, inst>::drainRemote(ThreadCache* tc, size_t idx) {
+		FreeList* head = tc->remoteFree[idx].popAll();
+		if (!head)
+			return;
+		FreeList* tail = head;
+		size_t cnt = 1;
+		for (; tail->next; tail = tail->next)
+			++cnt;
+		tail->next = tc->freeList[idx];
+		tc->freeList[idx] = head;
+		tc->listSize[idx] += cnt;
+	}
+
+	template <bool threads, int inst>
+	void DefaultAllocTemplate<threads, inst>::flushRemote(ThreadCache* tc, size_t idx) {
+		RemoteBatch& b = tc->remoteBatch[idx];
+		if (!b.count)
+			return;
+		b.owner->remoteFree[idx].push(b.head, b.tail);
+		b.owner = nullptr;
+		b.head = b.tail = nullptr;
+		b.count = 0;
+	}
+
+	template <bool threads, int inst>
+	void DefaultAllocTemplate<threads, inst>::flushThreadCache(ThreadCache* tc) {
+		for (size_t i = 0; i < (size_t)FREELISTS; ++i) {
+			flushRemote(tc, i);
+			drainRemote(tc, i);
+			FreeList* head = tc->freeList[i];
+			if (!head)
+				continue;
+			FreeList* tail = head;
+			while (tail->next)
+				tail = tail->next;
+			returnToCentral(head, tail, tc->listSize[i], i);
+			tc->freeList[i] = nullptr;
+			tc->listSize[i] = 0;
+		}
+	}
+
+	template <bool threads, int inst>
+	char* DefaultAllocTemplate<threads, inst>::newChunk(ThreadCache* owner) {
+		if (!budget.charge((size_t)CHUNKBytes))
+			return nullptr;
+		/* ȸҳѾ黹chunkٴηʱȱҳж·ҳ */
+		ChunkHeader* chunk = releasedChunks;
+		if (chunk) {
+			releasedChunks = chunk->nextReleased;
+			chunk->owner.store(owner, std::memory_order_relaxed);
+			chunk->released = false;
+			releasedBytes -= (size_t)CHUNKBytes;
+			if (lockedPages)
+				SystemPages::lock(chunk, (size_t)CHUNKBytes);
+			return (char*)chunk + CHUNKHeader;
+		}
+		if (hugeArena && arenaFree == arenaEnd) {
+			/* 
+			 * ǰҳѾ꣬ӳһ鰴2MBں˲֧͸ҳʱ
+			 * adviseHugeʲôճʹãӳʧ˻صӳchunk
+			 */
+			arenaFree = (char*)SystemPages::reserve((size_t)HUGEBytes, (size_t)HUGEBytes);
+			arenaEnd = arenaFree ? arenaFree + HUGEBytes : nullptr;
+			if (arenaFree)
+				SystemPages::adviseHuge(arenaFree, (size_t)HUGEBytes);
+		}
+		if (hugeArena && arenaFree) {
+			chunk = (ChunkHeader*)arenaFree;
+			arenaFree += CHUNKBytes;
+		}
+		else {
+			chunk = (ChunkHeader*)SystemPages::reserve((size_t)CHUNKBytes, (size_t)CHUNKBytes);
+		}
+		if (!chunk) {
+			budget.release((size_t)CHUNKBytes);
+			return nullptr;
+		}
+		chunk->next = chunkList;
+		chunk->nextReleased = nullptr;
+		chunk->freeBytes = 0;
+		chunk->owner.store(owner, std::memory_order_relaxed);
+		chunk->released = false;
+		chunk->pinned = false;
+		chunkList = chunk;
+		heapSize += (size_t)CHUNKBytes;
+		notePeakResident();
+		if (lockedPages)
+			SystemPages::lock(chunk, (size_t)CHUNKBytes);
+		return (char*)chunk + CHUNKHeader;
+	}
+
+	template <bool threads, int inst>
+	void DefaultAllocTemplate<threads, inst>::stashLeftover(char* p, size_t bytes) {
+		while (bytes >= (size_t)ALIGN) {
+			/* ڶĵͷһĳһֻȡܷµһ */
+			size_t idx = bytes >= (size_t)MAXBytes ? (size_t)FREELISTS - 1 : getFreeListIdx(bytes);
+			if (getClassSize(idx) > bytes)
+				--idx;
+			/* ϵĶҪڵȻ룬8ֽڵĵܷ */
+			while ((uintptr_t)p & (getClassAlign(getClassSize(idx)) - 1))
+				--idx;
+			size_t size = getClassSize(idx);
+			returnToCentral((FreeList*)p, (FreeList*)p, 1, idx);
+			p += size;
+			bytes -= size;
+		}
+	}
+
+	template <bool threads, int inst>
+	void DefaultAllocTemplate<threads, inst>::addIdle(size_t bytes, bool add) {
+		size_t now;
+		if (threads) {
+			if (add)
+				now = idleBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+			else
+				now = idleBytes.fetch_sub(bytes, std::memory_order_relaxed) - bytes;
+		}
+		else { // ̰߳汾ҪԭӲ
+			now = idleBytes.load(std::memory_order_relaxed);
+			now = add ? now + bytes : now - bytes;
+			idleBytes.store(now, std::memory_order_relaxed);
+		}
+		if (!add || !statsEnabled.load(std::memory_order_relaxed))
+			return;
+		size_t peak = peakIdleBytes.load(std::memory_order_relaxed);
+		while (now > peak && !peakIdleBytes.compare_exchange_weak(peak, now, std::memory_order_relaxed));
+	}
+
+	template <bool threads, int inst>
+	bool DefaultAllocTemplate<threads, inst>::relievePressure(int level, size_t want) {
+		/* صͷŵĶȻصtrim֮ϵͳ */
+		size_t freed = budget.relieve(level, want);
+		return trim() + freed > 0;
+	}
+
+	template <bool threads, int inst>
+	void DefaultAllocTemplate<threads, inst>::chargeBudget(size_t bytes) {
+		while (!budget.charge(bytes)) {
+			size_t used = budget.used();
+			size_t hard = budget.getHardLimit();
+			if (!relievePressure(MemoryBudget::HARDLevel, used + bytes > hard ? used + bytes - hard : bytes))
+				throw std::bad_alloc();
+		}
+		checkPressure();
+	}
+
+	template <bool threads, int inst>
+	void* DefaultAllocTemplate<threads, inst>::budgetReFill(size_t n) {
+		while (true) {
+			try {
+				void* result = reFill(n);
+				checkPressure();
+				return result;
+			}
+			catch (const std::bad_alloc&) {
+				if (!relievePressure(MemoryBudget::HARDLevel, (size_t)CHUNKBytes))
+					throw;
+			}
+		}
+	}
+
+	template <bool threads, int inst>
+	void DefaultAllocTemplate<threads, inst>::checkTrim() {
+		if (trimThreshold && idleBytes.load(std::memory_order_relaxed) > trimMark + trimThreshold)
+			trim();
+	}
+
+	template <bool threads, int inst>
+	size_t DefaultAllocTemplate<threads, inst>::trim() {
+		/* Ȱѱ̻߳Ķ(̻߳)Ҳܲͳ */
+		ThreadCache* tc = threads ? getThreadCache() : nullptr;
+		if (tc)
+			flushThreadCache(tc);
+		std::unique_lock<std::mutex> lock(poolMutex, std::defer_lock);
+		if (threads)
+			lock.lock(); // סͬʱзڴص̣߳߳Ȼع黹
+
+		/* ժпڵchunkۼӿֽ */
+		FreeList* lists[FREELISTS];
+		for (size_t i = 0; i < (size_t)FREELISTS; ++i) {
+			if (threads) {
+				lists[i] = centralList[i].popAll();
+			}
+			else {
+				lists[i] = freeList[i];
+				freeList[i] = nullptr;
+			}
+		}
+		for (ChunkHeader* chunk = chunkList; chunk; chunk = chunk->next)
+			chunk->freeBytes = 0;
+		for (size_t i = 0; i < (size_t)FREELISTS; ++i) {
+			size_t cnt = 0;
+			for (FreeList* p = lists[i]; p; p = p->next, ++cnt)
+				getChunk((char*)p)->freeBytes += getClassSize(i);
+			if (threads)
+				centralCount[i].fetch_sub(cnt, std::memory_order_relaxed);
+			if (cnt > (size_t)REFILLIdle * (size_t)getBatch(i))
+				shrinkBatch(i); // еĶԶһһȡ̫
+		}
+		if (startFree != endFree)
+			getChunk(startFree)->freeBytes += endFree - startFree;
+		if (tc && tc->startFree != tc->endFree) // ߳зֵchunkᱻ黹
+			getChunk(tc->startFree)->freeBytes += tc->endFree - tc->startFree;
+
+		/* ȱǳԹ黹chunkؽٶҳмϿ */
+		for (ChunkHeader* chunk = chunkList; chunk; chunk = chunk->next) {
+			if (!chunk->released && !chunk->pinned &&
+				chunk->freeBytes == (size_t)CHUNKBytes - (size_t)CHUNKHeader)
+				chunk->released = true;
+			else
+				chunk->freeBytes = 0; // freeBytesֱ¹黹chunk
+		}
+		if (startFree != endFree && getChunk(startFree)->released)
+			startFree = endFree = nullptr;
+		if (tc && tc->startFree != tc->endFree && getChunk(tc->startFree)->released)
+			tc->startFree = tc->endFree = nullptr;
+
+		/* ѹ黹chunkϵĶ¹һؿ */
+		size_t idle = 0;
+		for (size_t i = 0; i < (size_t)FREELISTS; ++i) {
+			FreeList* head = nullptr;
+			FreeList* tail = nullptr;
+			size_t cnt = 0;
+			for (FreeList* p = lists[i], *next; p; p = next) {
+				next = p->next;
+				if (getChunk((char*)p)->released)
+					continue;
+				p->next = head;
+				head = p;
+				if (!tail)
+					tail = p;
+				++cnt;
+			}
+			if (!head)
+				continue;
+			if (threads) {
+				centralCount[i].fetch_add(cnt, std::memory_order_relaxed);
+				centralList[i].push(head, tail);
+			}
+			else {
+				tail->next = freeList[i];
+				freeList[i] = head;
+			}
+			idle += cnt * getClassSize(i);
+		}
+
+		size_t released = 0;
+		size_t page = SystemPages::pageSize();
+		for (ChunkHeader* chunk = chunkList; chunk; chunk = chunk->next) {
+			if (!chunk->freeBytes)
+				continue;
+			/* ͷڵĵһҳҳϵͳҳҪȽܶ */
+			if (lockedPages)
+				SystemPages::unlock(chunk, (size_t)CHUNKBytes);
+			SystemPages::discard((char*)chunk + page, (size_t)CHUNKBytes - page);
+			chunk->freeBytes = 0;
+			chunk->nextReleased = releasedChunks;
+			releasedChunks = chunk;
+			released += (size_t)CHUNKBytes;
+		}
+		releasedBytes += released;
+		budget.release(released);
+		idleBytes.store(idle, std::memory_order_relaxed);
+		trimMark = idle;
+		return released;
+	}
+
+	template <bool threads, int inst>
+	void DefaultAllocTemplate<threads, inst>::prewarm(size_t n, size_t count) {
+		if (!count || MAXBytes < n)
+			return;
+		size_t idx = getFreeListIdx(n ? n : 1);
+		size_t size = getClassSize(idx);
+		FreeList* head = nullptr;
+		FreeList* tail = nullptr;
+		size_t got = 0;
+		std::unique_lock<std::mutex> lock(poolMutex, std::defer_lock);
+		if (threads)
+			lock.lock();
+		try {
+			while (got < count) {
+				size_t want = count - got;
+				int objs = want > (size_t)INT_MAX / size ? INT_MAX / (int)size : (int)want;
+				countStat(STATChunkAlloc);
+				char* chunk = chunkAlloc(size, objs, true);
+				/* дһгΣȱҳٴ */
+				std::memset(chunk, 0, (size_t)objs * size);
+				for (int i = objs - 1; i >= 0; --i) {
+					FreeList* p = (FreeList*)(chunk + (size_t)i * size);
+					p->next = head;
+					head = p;
+					if (!tail)
+						tail = p;
+				}
+				got += (size_t)objs;
+			}
+		}
+		catch (...) {
+			/* Ѿ׼õĶճȥ */
+			if (head)
+				returnToCentral(head, tail, got, idx);
+			throw;
+		}
+		returnToCentral(head, tail, got, idx);
+	}
+
+	template <bool threads, int inst>
+	void DefaultAllocTemplate<threads, inst>::prewarm(const size_t* counts) {
+		for (size_t i = 0; i < (size_t)FREELISTS; ++i)
+			prewarm(getClassSize(i), counts[i]);
+	}
+
+	template <bool threads, int inst>
+	bool DefaultAllocTemplate<threads, inst>::setLockPages(bool on) {
+		std::unique_lock<std::mutex> lock(poolMutex, std::defer_lock);
+		if (threads)
+			lock.lock();
+		lockedPages = on;
+		bool ok = true;
+		for (ChunkHeader* chunk = chunkList; chunk; chunk = chunk->next) {
+			if (chunk->released)
+				continue;
+			if (!on)
+				SystemPages::unlock(chunk, (size_t)CHUNKBytes);
+			else if (!SystemPages::lock(chunk, (size_t)CHUNKBytes))
+				ok = false;
+		}
+		return ok;
+	}
+
+	template <bool threads, int inst>
+	void DefaultAllocTemplate<threads, inst>::returnToCentral(FreeList* head, FreeList* tail, size_t cnt, size_t idx) {
+		addIdle(cnt * getClassSize(idx), true);
+		if (threads) {
+			centralCount[idx].fetch_add(cnt, std::memory_order_relaxed); // ȼӺѹջСʵʸ
+			centralList[idx].push(head, tail);
+		}
+		else {
+			tail->next = freeList[idx];
+			freeList[idx] = head;
+		}
+	}
+
+	template <bool threads, int inst>
+	FreeList* DefaultAllocTemplate<threads, inst>::takeFromCentral(size_t idx) {
+		FreeList* p;
+		if (threads) {
+			p = centralList[idx].pop();
+			if (p)
+				centralCount[idx].fetch_sub(1, std::memory_order_relaxed);
+		}
+		else {
+			p = freeList[idx];
+			if (p)
+				freeList[idx] = p->next;
+		}
+		if (p)
+			addIdle(getClassSize(idx), false);
+		return p;
+	}
+
+	template <bool threads, int inst>
+	typename DefaultAllocTemplate<threads, inst>::StatsCounters*
+	DefaultAllocTemplate<threads, inst>::getStatsCounters() {
+		StatsCounters* c = statsCounters;
+		if (c || statsDead)
+			return c;
+		static thread_local StatsReaper reaper;
+		(void)reaper;
+		c = new (malloc_alloc::allocate(sizeof(StatsCounters))) StatsCounters();
+		std::lock_guard<std::mutex> guard(statsMutex);
+		c->next = statsList;
+		statsList = c;
+		statsCounters = c;
+		return c;
+	}
+
+	template <bool threads, int inst>
+	void DefaultAllocTemplate<threads, inst>::releaseStatsCounters() {
+		StatsCounters* c = statsCounters;
+		statsCounters = nullptr;
+		statsDead = true;
+		if (!c)
+			return;
+		{
+			std::lock_guard<std::mutex> guard(statsMutex);
+			StatsCounters** link = &statsList;
+			while (*link != c)
+				link = &(*link)->next;
+			*link = c->next;
+			for (size_t k = 0; k < (size_t)STATCount; ++k)
+				retiredStats.count[k].fetch_add(c->count[k].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+		malloc_alloc::deallocate(c);
+	}
+
+	template <bool threads, int inst>
+	AllocStats DefaultAllocTemplate<threads, inst>::getStats() {
+		AllocStats s = AllocStats();
+		uint64_t count[STATCount];
+		{
+			std::lock_guard<std::mutex> guard(statsMutex);
+			for (size_t k = 0; k < (size_t)STATCount; ++k)
+				count[k] = retiredStats.count[k].load(std::memory_order_relaxed);
+			for (StatsCounters* c = statsList; c; c = c->next) {
+				for (size_t k = 0; k < (size_t)STATCount; ++k)
+					count[k] += c->count[k].load(std::memory_order_relaxed);
+			}
+		}
+		/* ̵߳Ļʱڱ䣬ֻܿ߳Լ */
+		ThreadCache* tc = threads ? threadCache : nullptr;
+		for (size_t i = 0; i < (size_t)FREELISTS; ++i) {
+			AllocStats::SizeClass& c = s.classes[i];
+			c.size = getClassSize(i);
+			c.allocs = count[STATAlloc + i];
+			c.frees = count[STATFree + i];
+			c.cachedObjects = tc ? tc->listSize[i] : 0;
+			c.reFills = count[STATClassReFill + i];
+			c.batchObjs = (size_t)getBatch(i);
+			if (threads) {
+				c.freeObjects = centralCount[i].load(std::memory_order_relaxed);
+			}
+			else {
+				for (FreeList* p = freeList[i]; p; p = p->next)
+					++c.freeObjects;
+			}
+		}
+		s.largeAllocs = count[STATLargeAlloc];
+		s.largeFrees = count[STATLargeFree];
+		s.reFills = count[STATReFill];
+		s.chunkAllocs = count[STATChunkAlloc];
+		s.oomMallocs = count[STATOomMalloc];
+
+		std::unique_lock<std::mutex> lock(poolMutex, std::defer_lock);
+		if (threads)
+			lock.lock();
+		s.poolBytes = endFree - startFree;
+		if (tc)
+			s.poolBytes += tc->endFree - tc->startFree;
+		s.heapSize = heapSize;
+		s.residentBytes = heapSize - releasedBytes;
+		s.peakResidentBytes = peakResidentBytes;
+		s.idleBytes = idleBytes.load(std::memory_order_relaxed);
+		s.peakIdleBytes = peakIdleBytes.load(std::memory_order_relaxed);
+		return s;
+	}
+
+	template <bool threads, int inst>
+	void* DefaultAllocTemplate<threads, inst>::threadAllocate(size_t n) {
+		ThreadCache* tc = getThreadCache();
+		if (tc) {
+			size_t idx = getFreeListIdx(n);
+			FreeList* result = tc->freeList[idx];
+			if (!result && !tc->remoteFree[idx].empty()) {
+				drainRemote(tc, idx);
+				result = tc->freeList[idx];
+			}
+			if (result) {
+				/* ֻ̻߳б̷߳ʣ͵̰߳汾һֱժͷ */
+				tc->freeList[idx] = result->next;
+				--tc->listSize[idx];
+				return result;
+			}
+		}
+		return budgetReFill(getRoundUp(n));
+	}
+
+	template <bool threads, int inst>
+	void DefaultAllocTemplate<threads, inst>::threadDeallocate(void* p, size_t n) {
+		size_t idx = getFreeListIdx(n);
+		FreeList* q = (FreeList*)p;
+		ThreadCache* tc = getThreadCache();
+		ThreadCache* owner = getChunk((char*)p)->owner.load(std::memory_order_relaxed);
+		if (owner && owner != tc) {
+			/* ̣߳ͬһownerĶܹһһѹ */
+			if (!tc) {
+				owner->remoteFree[idx].push(q, q);
+				return;
+			}
+			RemoteBatch& b = tc->remoteBatch[idx];
+			if (b.owner != owner) {
+				flushRemote(tc, idx);
+				b.owner = owner;
+				b.tail = q;
+			}
+			q->next = b.head;
+			b.head = q;
+			if (++b.count >= (size_t)getRefillObjs(getClassSize(idx)))
+				flushRemote(tc, idx);
+			return;
+		}
+		if (!tc) {
+			returnToCentral(q, q, 1, idx);
+			return;
+		}
+		q->next = tc->freeList[idx];
+		tc->freeList[idx] = q;
+		int batch = getBatch(idx);
+		if (++tc->listSize[idx] <= 2 * (size_t)batch)
+			return;
+		/* ̻߳ͷһһԹ黹ԺҲȡһЩ */
+		shrinkBatch(idx);
+		FreeList* tail = q;
+		for (int i = 1; i < batch; ++i)
+			tail = tail->next;
+		tc->freeList[idx] = tail->next;
+		tc->listSize[idx] -= batch;
+		returnToCentral(q, tail, batch, idx);
+		checkTrim();
+	}
+
+	// SGI STLһĬϵalloc̰߳ȫİ汾ȷֻڵ߳ʹʱ
+	// single_client_allocʡȥ̻߳Ŀ
+	using alloc = DefaultAllocTemplate<true, 0>;
+	using single_client_alloc = DefaultAllocTemplate<false, 0>;
+
+	// slab˵ÿslabSLABBytes룬Ĩַĵλҵslabͷ
+	enum {
+		SLABBytes = 64 * 1024,
+		SLABBins = 8, // ʹõslabʹʷֳSLABBins
+	};
+
+	/*
+	 * slabڴءDefaultAllocTemplateFreeListǺȳջ䡢ͷ
+	 * ֮ڵĶԲصҳĶҲɢÿ
+	 * slabֻһִСĶͷλͼ¼ЩslotУʱ
+	 *   1. ڵǰslabȡַ͵Ŀslot
+	 *   2. ǰslabˣһʹõslab(ʹʰSLABBinsַ֣
+	 *      ͬһǰȡַ͵)Ϊµĵǰslab
+	 * Ķ˼slabĵ͵ַˣʱʵҳ٣һslabе
+	 * ȫͷźslabϵͳ(ÿһãⷴӳ)
+	 * ֻSMALLBytesĶ󣬸ĽͬthreadsinstDefaultAllocTemplate
+	 * ̰߳汾ÿһһû̻߳棬Ϊ̻߳ҷ˳
+	 */
+	template <bool threads, int inst>
+	class SlabAllocTemplate {
+	private:
+		using fallback = DefaultAllocTemplate<threads, inst>;
+
+		enum {
+			SLABClasses = SMALLBytes / ALIGN,
+			SLABBitmapWords = SLABBytes / ALIGN / 64,
+			SLABScan = 8, // ͬһȽôslabĵַ
+		};
+
+		struct Slab {
+			Slab* prev;         // 
+			Slab* next;
+			uint32_t size;      // slotĴС
+			uint32_t capacity;
+			uint32_t used;
+			uint32_t hint;      // ±֮ǰλͼûпеslot
+			int bin;            // ڵ飬-1ʾκ(ǰslab)
+			uint64_t bitmap[SLABBitmapWords]; // 1ʾ
+		};
+
+		enum {
+			SLABHeader = (sizeof(Slab) + MAXAlign - 1) & ~(MAXAlign - 1),
+		};
+
+		static Slab* current[SLABClasses];
+		static Slab* partial[SLABClasses][SLABBins];
+		static Slab* spare[SLABClasses];
+		static std::mutex classMutex[SLABClasses];
+
+		static size_t getClassIdx(size_t n) { return n ? (n - 1) / (size_t)ALIGN : 0; }
+		static Slab* getSlab(void* p) { return (Slab*)((uintptr_t)p & ~(uintptr_t)(SLABBytes - 1)); }
+		static int getBin(Slab* s) { return (int)((size_t)s->used * SLABBins / s->capacity); }
+
+		static int lowestBit(uint64_t x) {
+#if defined(_MSC_VER)
+			unsigned long r;
+			_BitScanForward64(&r, x);
+			return (int)r;
+#elif defined(__GNUC__)
+			return __builtin_ctzll(x);
+#else
+			int r = 0;
+			while (!(x & 1)) {
+				x >>= 1;
+				++r;
+			}
+			return r;
+#endif
+		}
+
+		static bool hasPartial(size_t idx) {
+			for (int bin = 0; bin < (int)SLABBins; ++bin) {
+				if (partial[idx][bin])
+					return true;
+			}
+			return false;
+		}
+
+		static void link(Slab* s, size_t idx, int bin);
+		static void unlink(Slab* s, size_t idx);
+		static Slab* newSlab(size_t idx);
+		static Slab* pickSlab(size_t idx);
+		static void releaseSlab(Slab* s, size_t idx);
+
+	public:
+		static void* allocate(size_t n);
+		static void deallocate(void* p, size_t n);
+		static void* allocate(size_t n, size_t align) {
+			if (align <= (size_t)ALIGN)
+				return allocate(n);
+			return fallback::allocate(n, align);
+		}
+		static void deallocate(void* p, size_t n, size_t align) {
+			if (align <= (size_t)ALIGN)
+				return deallocate(p, n);
+			fallback::deallocate(p, n, align);
+		}
+
+		// ÿһõĿslabϵͳع黹ֽ
+		static size_t trim();
+	};
+
+	template <bool threads, int inst>
+	typename SlabAllocTemplate<threads, inst>::Slab*
+		SlabAllocTemplate<threads, inst>::current[SLABClasses] = { nullptr };
+
+	template <bool threads, int inst>
+	typename SlabAllocTemplate<threads, inst>::Slab*
+		SlabAllocTemplate<threads, inst>::partial[SLABClasses][SLABBins] = { { nullptr } };
+
+	template <bool threads, int inst>
+	typename SlabAllocTemplate<threads, inst>::Slab*
+		SlabAllocTemplate<threads, inst>::spare[SLABClasses] = { nullptr };
+
+	template <bool threads, int inst>
+	std::mutex SlabAllocTemplate<threads, inst>::classMutex[SLABClasses];
+
+	template <bool threads, int inst>
+	void* SlabAllocTemplate<threads, inst>::allocate(size_t n) {
+		if (n > (size_t)SMALLBytes)
+			return fallback::allocate(n);
+		size_t idx = getClassIdx(n);
+		std::unique_lock<std::mutex> lock(classMutex[idx], std::defer_lock);
+		if (threads)
+			lock.lock();
+		Slab* s = current[idx];
+		if (!s || s->used == s->capacity || (!s->used && hasPartial(idx))) {
+			/* ǰslabˣѾ˶вʹõslab */
+			if (s && !s->used)
+				releaseSlab(s, idx);
+			s = current[idx] = pickSlab(idx);
+		}
+		/* hintʼҵһпslotλͼ֣ȡ͵һλ */
+		uint32_t w = s->hint;
+		while (!s->bitmap[w])
+			++w;
+		s->hint = w;
+		int b = lowestBit(s->bitmap[w]);
+		s->bitmap[w] &= s->bitmap[w] - 1;
+		++s->used;
+		return (char*)s + SLABHeader + ((size_t)w * 64 + b) * s->size;
+	}
+
+	template <bool threads, int inst>
+	void SlabAllocTemplate<threads, inst>::deallocate(void* p, size_t n) {
+		if (n > (size_t)SMALLBytes)
+			return fallback::deallocate(p, n);
+		size_t idx = getClassIdx(n);
+		Slab* s = getSlab(p);
+		std::unique_lock<std::mutex> lock(classMutex[idx], std::defer_lock);
+		if (threads)
+			lock.lock();
+		size_t slot = (size_t)((char*)p - (char*)s - SLABHeader) / s->size;
+		uint32_t w = (uint32_t)(slot / 64);
+		s->bitmap[w] |= (uint64_t)1 << (slot % 64);
+		if (w < s->hint)
+			s->hint = w;
+		--s->used;
+		if (s == current[idx])
+			return;
+		if (!s->used) {
+			/* slabˣϵͳ */
+			if (s->bin >= 0)
+				unlink(s, idx);
+			releaseSlab(s, idx);
+			return;
+		}
+		/* ʹʿ˷ı߽磬ԭģӦ */
+		int bin = getBin(s);
+		if (bin != s->bin) {
+			if (s->bin >= 0)
+				unlink(s, idx);
+			link(s, idx, bin);
+		}
+	}
+
+	template <bool threads, int inst>
+	void SlabAllocTemplate<threads, inst>::link(Slab* s, size_t idx, int bin) {
+		Slab*& head = partial[idx][bin];
+		s->prev = nullptr;
+		s->next = head;
+		if (head)
+			head->prev = s;
+		head = s;
+		s->bin = bin;
+	}
+
+	template <bool threads, int inst>
+	void SlabAllocTemplate<threads, inst>::unlink(Slab* s, size_t idx) {
+		if (s->prev)
+			s->prev->next = s->next;
+		else
+			partial[idx][s->bin] = s->next;
+		if (s->next)
+			s->next->prev = s->prev;
+		s->bin = -1;
+	}
+
+	template <bool threads, int inst>
+	typename SlabAllocTemplate<threads, inst>::Slab* SlabAllocTemplate<threads, inst>::newSlab(size_t idx) {
+		Slab* s = (Slab*)SystemPages::reserve((size_t)SLABBytes, (size_t)SLABBytes);
+		if (!s)
+			throw std::bad_alloc();
+		s->prev = s->next = nullptr;
+		s->size = (uint32_t)((idx + 1) * ALIGN);
+		s->capacity = (uint32_t)(((size_t)SLABBytes - (size_t)SLABHeader) / s->size);
+		s->used = 0;
+		s->hint = 0;
+		s->bin = -1;
+		/* ǰcapacityλ1λԶᱻ */
+		std::memset(s->bitmap, 0, sizeof(s->bitmap));
+		for (uint32_t w = 0; w < s->capacity / 64; ++w)
+			s->bitmap[w] = ~(uint64_t)0;
+		if (s->capacity % 64)
+			s->bitmap[s->capacity / 64] = ((uint64_t)1 << (s->capacity % 64)) - 1;
+		return s;
+	}
+
+	template <bool threads, int inst>
+	typename SlabAllocTemplate<threads, inst>::Slab* SlabAllocTemplate<threads, inst>::pickSlab(size_t idx) {
+		for (int bin = (int)SLABBins - 1; bin >= 0; --bin) {
+			Slab* best = partial[idx][bin];
+			if (!best)
+				continue;
+			/* ͬһʹǰȡַ͵ */
+			int scanned = 0;
+			for (Slab* s = best->next; s && ++scanned < (int)SLABScan; s = s->next) {
+				if (s->used > best->used || (s->used == best->used && s < best))
+					best = s;
 			}
+			unlink(best, idx);
+			return best;
+		}
+		if (Slab* s = spare[idx]) {
+			spare[idx] = nullptr;
+			return s;
+		}
+		return newSlab(idx);
+	}
 
-			heapSize += newBytes;
-			endFree = startFree + newBytes;
-			return chunkAlloc(size, objs);
+	template <bool threads, int inst>
+	void SlabAllocTemplate<threads, inst>::releaseSlab(Slab* s, size_t idx) {
+		if (!spare[idx]) {
+			spare[idx] = s;
+			return;
 		}
+		SystemPages::unmap(s, (size_t)SLABBytes);
 	}
 
-	using alloc = DefaultAllocTemplate<0, 0>;
+	template <bool threads, int inst>
+	size_t SlabAllocTemplate<threads, inst>::trim() {
+		size_t released = 0;
+		for (size_t idx = 0; idx < (size_t)SLABClasses; ++idx) {
+			std::unique_lock<std::mutex> lock(classMutex[idx], std::defer_lock);
+			if (threads)
+				lock.lock();
+			if (spare[idx]) {
+				SystemPages::unmap(spare[idx], (size_t)SLABBytes);
+				spare[idx] = nullptr;
+				released += (size_t)SLABBytes;
+			}
+		}
+		return released;
+	}
+
+	// СҪ˳ĽԻslab_alloc
+	using slab_alloc = SlabAllocTemplate<true, 0>;
+	using single_client_slab_alloc = SlabAllocTemplate<false, 0>;
 
 	/* new alloc */
 	template <typename T>
@@ -272,8 +2390,216 @@ namespace tinySTL {
 		static void deallocate(T* buffer, ptrdiff_t /* size */) {
 			::operator delete (buffer);
 		}
+
+		static T* allocate(ptrdiff_t size, size_t align) {
+			if (0 == size) return nullptr;
+			return (T*)(::operator new((size_t)(size), std::align_val_t(align)));
+		}
+
+		static void deallocate(T* buffer, ptrdiff_t /* size */, size_t align) {
+			::operator delete (buffer, std::align_val_t(align));
+		}
+
+		static bool tryExpand(T* /* buffer */, ptrdiff_t oldSize, ptrdiff_t size) {
+			return size <= oldSize; // operator newûԭչĽӿ
+		}
+
+		static T* reallocate(T* buffer, ptrdiff_t oldSize, ptrdiff_t size) {
+			T* result = allocate(size);
+			std::memcpy(result, buffer, (size_t)(oldSize < size ? oldSize : size));
+			deallocate(buffer);
+			return result;
+		}
 	};
 
 	template <typename T>
 	using new_alloc = SimpleAllocTemplate<T>;
+
+	/*
+	 * arenaֻǰָŲdeallocateʲôʺһͬ
+	 * С(һдĶ)resetһԷжֻһڴ
+	 * ´θã֮׷ӵڴ鰴ֻж
+	 * ᱻãֻӦƽĶʹԼ
+	 */
+	class monotonic_arena_base {
+	public:
+		monotonic_arena_base(const monotonic_arena_base&) = delete;
+		monotonic_arena_base& operator=(const monotonic_arena_base&) = delete;
+
+		void* allocate(size_t n, size_t align = (size_t)ALIGN) {
+			size_t pad = (align - ((uintptr_t)cur & (align - 1))) & (align - 1);
+			if (pad + n <= (size_t)(end - cur)) {
+				char* p = cur + pad;
+				cur = p + n;
+				return p;
+			}
+			return allocateSlow(n, align);
+		}
+
+		void deallocate(void*, size_t) noexcept {}
+
+		// ͷж󣬳һڴ鶼һ
+		void reset() noexcept {
+			while (blocks != firstBlock) {
+				Block* next = blocks->next;
+				malloc_alloc::deallocate(blocks);
+				blocks = next;
+			}
+			if (initBuffer) {
+				cur = initBuffer;
+				end = initBuffer + initBytes;
+			}
+			else if (firstBlock) {
+				cur = (char*)(firstBlock + 1);
+				end = (char*)firstBlock + firstBlock->size;
+			}
+			nextBytes = firstBlock ? firstBlock->size : 2 * initBytes;
+			if (nextBytes < (size_t)INITBytes)
+				nextBytes = (size_t)INITBytes;
+		}
+
+		// pһηoldSizeֽʱֱڵǰаչnewSizeֽ
+		bool expand(void* p, size_t oldSize, size_t newSize) noexcept {
+			if ((char*)p + oldSize != cur || newSize - oldSize > (size_t)(end - cur))
+				return newSize <= oldSize;
+			cur = (char*)p + newSize;
+			return true;
+		}
+
+		// ǰڴлֱӷֽ
+		size_t available() const noexcept { return (size_t)(end - cur); }
+
+	protected:
+		monotonic_arena_base(char* buffer, size_t bytes) noexcept
+			: cur(buffer), end(buffer + bytes), initBuffer(buffer), initBytes(bytes),
+			blocks(nullptr), firstBlock(nullptr),
+			nextBytes(2 * bytes < (size_t)INITBytes ? (size_t)INITBytes : 2 * bytes) {}
+
+		~monotonic_arena_base() {
+			reset();
+			if (firstBlock)
+				malloc_alloc::deallocate(firstBlock);
+		}
+
+	private:
+		enum {
+			INITBytes = 4096,           // ûʱһĴС
+			MAXBlockBytes = 64 * 1024 * 1024,
+		};
+
+		struct Block {
+			Block* next;
+			size_t size; // Blockͷ
+		};
+
+		void* allocateSlow(size_t n, size_t align) {
+			size_t need = n + align + sizeof(Block);
+			size_t bytes = nextBytes < need ? need : nextBytes;
+			Block* block = (Block*)malloc_alloc::allocate(bytes);
+			block->next = blocks;
+			block->size = bytes;
+			blocks = block;
+			if (!firstBlock && !initBuffer)
+				firstBlock = block; // ûʱһreset
+			cur = (char*)(block + 1);
+			end = (char*)block + bytes;
+			if (nextBytes < (size_t)MAXBlockBytes)
+				nextBytes *= 2;
+			return allocate(n, align);
+		}
+
+		char* cur;
+		char* end;
+		char* initBuffer;  // Ϊ
+		size_t initBytes;
+		Block* blocks;     // һڴ飬µǰ
+		Block* firstBlock;
+		size_t nextBytes;  // һ׷ӵڴС
+	};
+
+	// InlineBytesΪ0ʱarenaԴôĻջϵĶarenaȫ
+	template <size_t InlineBytes = 0>
+	class monotonic_arena : public monotonic_arena_base {
+	public:
+		monotonic_arena() noexcept : monotonic_arena_base(buffer, InlineBytes) {}
+
+	private:
+		alignas(std::max_align_t) char buffer[InlineBytes];
+	};
+
+	template <>
+	class monotonic_arena<0> : public monotonic_arena_base {
+	public:
+		monotonic_arena() noexcept : monotonic_arena_base(nullptr, 0) {}
+	};
+
+	/*
+	 * tinySTL::allocatorAllocֻǾ̬ӿڣarenaֲͨ߳̾"ǰarena"
+	 * 룺scopeڣallocator<T, arena_alloc>ķ䶼ָarenaϣ
+	 * scopeʱָ֮ǰarenaresetһͷš
+	 */
+	template <int inst>
+	class ArenaAllocTemplate {
+	public:
+		static void* allocate(size_t n) {
+			monotonic_arena_base* arena = current;
+			if (!arena) // κscopeʱûпõarena
+				throw std::bad_alloc();
+			return arena->allocate(n);
+		}
+
+		static void* allocate(size_t n, size_t align) {
+			monotonic_arena_base* arena = current;
+			if (!arena)
+				throw std::bad_alloc();
+			return arena->allocate(n, align);
+		}
+
+		static void deallocate(void*) {}
+		static void deallocate(void*, size_t) {}
+		static void deallocate(void*, size_t, size_t) {}
+
+		static bool tryExpand(void* p, size_t oldSize, size_t newSize) {
+			return current && current->expand(p, oldSize, newSize);
+		}
+
+		static void* reallocate(void* p, size_t oldSize, size_t newSize) {
+			if (tryExpand(p, oldSize, newSize))
+				return p;
+			void* q = allocate(newSize);
+			std::memcpy(q, p, oldSize < newSize ? oldSize : newSize);
+			return q;
+		}
+
+		static monotonic_arena_base* get_arena() { return current; }
+
+		class scope {
+		public:
+			explicit scope(monotonic_arena_base& arena) noexcept
+				: arena(arena), prev(current) {
+				current = &arena;
+			}
+
+			~scope() {
+				current = prev;
+				arena.reset();
+			}
+
+			scope(const scope&) = delete;
+			scope& operator=(const scope&) = delete;
+
+		private:
+			monotonic_arena_base& arena;
+			monotonic_arena_base* prev;
+		};
+
+	private:
+		static thread_local monotonic_arena_base* current;
+	};
+
+	template <int inst>
+	thread_local monotonic_arena_base* ArenaAllocTemplate<inst>::current = nullptr;
+
+	using arena_alloc = ArenaAllocTemplate<0>;
+	using arena_scope = arena_alloc::scope;
 }
\ No newline at end of file
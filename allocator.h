@@ -1,26 +1,69 @@
 #pragma once
 
+#include <cstring>
+#include <type_traits>
+
 #include "alloc.h"
+#include "heap_profiler.h"
+#include "type_traits.h"
 
 namespace tinySTL {
 
+	// AllocǷṩĽӿ(ĿǰֻDefaultAllocTemplate)
+	template <typename Alloc, typename = void>
+	struct has_batch_allocate : public std::false_type {};
+
+	template <typename Alloc>
+	struct has_batch_allocate<Alloc, std::void_t<decltype(Alloc::allocateBatch(size_t(), size_t(), (void**)nullptr))>>
+		: public std::true_type {};
+
+	// AllocóԱģpointer<T>ָָͣshm_allocʹoffset_ptr<T>
+	// ûʱT*
+	template <typename Alloc, typename T, typename = void>
+	struct alloc_pointer {
+		using type = T*;
+	};
+
+	template <typename Alloc, typename T>
+	struct alloc_pointer<Alloc, T, std::void_t<typename Alloc::template pointer<T>>> {
+		using type = typename Alloc::template pointer<T>;
+	};
+
 	template <typename T, typename Alloc = new_alloc<T>>
 	class allocator {
 	public:
 		using value_type       = T;
-		using pointer          = T*;
-		using const_pointer	   = const T*;
+		using pointer          = typename alloc_pointer<Alloc, T>::type;
+		using const_pointer	   = typename alloc_pointer<Alloc, const T>::type;
 		using reference        = T&;
 		using const_reference  = const T&;
 		using size_type		   = size_t;
 		using difference_type  = ptrdiff_t;
 
+		/*
+		 * ׼ķҪstd::vectorstd::mapȿֱʹã״̬Alloc
+		 * ľ̬ԱУȣһڴһͷţ֮佻
+		 * ֵʱҲͲؿǷǷŴ
+		 */
+		using is_always_equal                        = std::true_type;
+		using propagate_on_container_copy_assignment = std::true_type;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap            = std::true_type;
+
 	public:
+		allocator() noexcept = default;
+		// std::mapԪصķķ
+		template <typename U>
+		allocator(const allocator<U, Alloc>&) noexcept {}
 
 		static pointer allocate();
 		static pointer allocate(size_type n);
 		static void deallocate(pointer ptr);
 		static void deallocate(pointer ptr, size_type n);
+		// һη/ͷcountTһνн㡣Allocӿʱ
+		// εժȡ/黹allocate/deallocate
+		static void allocate_batch(size_type count, pointer* out);
+		static void deallocate_batch(pointer* ptrs, size_type count);
 
 		/*
 		 * Rebindڽʹݸͬʹͬһռ
@@ -61,30 +104,215 @@ namespace tinySTL {
 		 * һ˵ǣ
 		 * reallocֵֻƽ䣩͵²ʹá
 		 * οӣhttps://www.zhihu.com/question/384869006/answer/1130101522
+		 * ֻṩ޵İ汾try_expandκͶȫֻԭظıռС
+		 * 󲻻ƶreallocateֻԿƽضλT(is_trivially_relocatable)
+		 * ԭչʧʱAllocֽڰ(ڴmremapںŲҳ)
+		 */
+		// ԭذold_nĿռĳnew_nɹ֮Ҫnew_nͷ
+		static bool try_expand(pointer ptr, size_type old_n, size_type new_n);
+		static pointer reallocate(pointer ptr, size_type old_n, size_type new_n);
+
+	private:
+		/*
+		 * ֻ֤ALIGN(8)ֽڶ룬alignof(T)(SIMD
+		 * ļ)ҪAllocİ汾ͲӰ
 		 */
-		// void realloc(pointer ptr, size_type n);
+		using over_aligned = std::integral_constant<bool, (alignof(T) > (size_t)ALIGN)>;
+
+		// Allocֻʶָͨ룬offset_ptrpointerڽAlloc֮ǰȡַ
+		static T* to_raw(T* ptr) noexcept { return ptr; }
+		template <typename Ptr>
+		static T* to_raw(const Ptr& ptr) noexcept { return ptr.operator->(); }
+		using batch_capable = std::integral_constant<bool, has_batch_allocate<Alloc>::value && !over_aligned::value>;
+
+		static void allocate_batch_aux(size_type count, pointer* out, std::true_type) {
+			Alloc::allocateBatch(sizeof(T), count, reinterpret_cast<void**>(out));
+		}
+
+		static void allocate_batch_aux(size_type count, pointer* out, std::false_type) {
+			size_type i = 0;
+			try {
+				for (; i < count; ++i)
+					out[i] = static_cast<T*>(allocate_bytes(sizeof(T), over_aligned()));
+			}
+			catch (...) {
+				while (i--)
+					deallocate_bytes(to_raw(out[i]), sizeof(T), over_aligned());
+				throw;
+			}
+		}
+
+		static void deallocate_batch_aux(pointer* ptrs, size_type count, std::true_type) {
+			Alloc::deallocateBatch(sizeof(T), reinterpret_cast<void**>(ptrs), count);
+		}
+
+		static void deallocate_batch_aux(pointer* ptrs, size_type count, std::false_type) {
+			for (size_type i = 0; i < count; ++i)
+				deallocate_bytes(to_raw(ptrs[i]), sizeof(T), over_aligned());
+		}
+
+		static void* allocate_bytes(size_type bytes, std::false_type) {
+			return Alloc::allocate(bytes);
+		}
+
+		static void* allocate_bytes(size_type bytes, std::true_type) {
+			return Alloc::allocate(bytes, alignof(T));
+		}
+
+		static void deallocate_bytes(void* ptr, size_type bytes, std::false_type) {
+			Alloc::deallocate(static_cast<T*>(ptr), bytes);
+		}
+
+		static void deallocate_bytes(void* ptr, size_type bytes, std::true_type) {
+			Alloc::deallocate(static_cast<T*>(ptr), bytes, alignof(T));
+		}
+
+		static bool try_expand_bytes(T* ptr, size_type old_bytes, size_type new_bytes, std::false_type) {
+			return Alloc::tryExpand(ptr, old_bytes, new_bytes);
+		}
+
+		static bool try_expand_bytes(T*, size_type old_bytes, size_type new_bytes, std::true_type) {
+			return new_bytes == old_bytes; // ڴ˶ûԭչİ汾
+		}
+
+		static T* reallocate_bytes(T* ptr, size_type old_bytes, size_type new_bytes, std::false_type) {
+			return static_cast<T*>(Alloc::reallocate(ptr, old_bytes, new_bytes));
+		}
+
+		static T* reallocate_bytes(T* ptr, size_type old_bytes, size_type new_bytes, std::true_type) {
+			T* result = static_cast<T*>(allocate_bytes(new_bytes, std::true_type()));
+			std::memcpy(result, ptr, old_bytes < new_bytes ? old_bytes : new_bytes);
+			deallocate_bytes(ptr, old_bytes, std::true_type());
+			return result;
+		}
 	};
 
 	template <typename T, typename Alloc>
-	T* allocator<T, Alloc>::allocate() {
-		return static_cast<T*>(Alloc::allocate(sizeof(T)));
+	typename allocator<T, Alloc>::pointer allocator<T, Alloc>::allocate() {
+		T* ptr = static_cast<T*>(allocate_bytes(sizeof(T), over_aligned()));
+		heap_profiler::recordAllocate(ptr, sizeof(T));
+		return ptr;
 	}
 
 	template<typename T, typename Alloc>
-	T* allocator<T, Alloc>::allocate(size_type n) {
-		return static_cast<T*>(Alloc::allocate(sizeof(T) * n));
+	typename allocator<T, Alloc>::pointer allocator<T, Alloc>::allocate(size_type n) {
+		T* ptr = static_cast<T*>(allocate_bytes(sizeof(T) * n, over_aligned()));
+		heap_profiler::recordAllocate(ptr, sizeof(T) * n);
+		return ptr;
 	}
 
 	template<typename T, typename Alloc>
 	void allocator<T, Alloc>::deallocate(pointer ptr) {
 		if (!ptr) return;
-		Alloc::deallocate(ptr, sizeof(T));
+		heap_profiler::recordDeallocate(to_raw(ptr)); // ɾ黹ַ֮ϱ߳õ
+		deallocate_bytes(to_raw(ptr), sizeof(T), over_aligned());
 	}
 
 	template<typename T, typename Alloc>
 	void allocator<T, Alloc>::deallocate(pointer ptr, size_type n) {
 		if (!ptr) return;
-		Alloc::deallocate(ptr, sizeof(T) * n);
+		heap_profiler::recordDeallocate(to_raw(ptr));
+		deallocate_bytes(to_raw(ptr), sizeof(T) * n, over_aligned());
+	}
+
+	template<typename T, typename Alloc>
+	void allocator<T, Alloc>::allocate_batch(size_type count, pointer* out) {
+		allocate_batch_aux(count, out, batch_capable());
+		for (size_type i = 0; i < count; ++i)
+			heap_profiler::recordAllocate(to_raw(out[i]), sizeof(T));
+	}
+
+	template<typename T, typename Alloc>
+	void allocator<T, Alloc>::deallocate_batch(pointer* ptrs, size_type count) {
+		for (size_type i = 0; i < count; ++i)
+			heap_profiler::recordDeallocate(to_raw(ptrs[i]));
+		deallocate_batch_aux(ptrs, count, batch_capable());
 	}
 
+	template<typename T, typename Alloc>
+	bool allocator<T, Alloc>::try_expand(pointer ptr, size_type old_n, size_type new_n) {
+		if (!ptr) return false;
+		return try_expand_bytes(to_raw(ptr), sizeof(T) * old_n, sizeof(T) * new_n, over_aligned());
+	}
+
+	template<typename T, typename Alloc>
+	typename allocator<T, Alloc>::pointer allocator<T, Alloc>::reallocate(pointer ptr, size_type old_n, size_type new_n) {
+		static_assert(is_trivially_relocatable<T>::value,
+			"reallocate moves the elements with memcpy, T must be trivially relocatable");
+		if (!ptr) return allocate(new_n);
+		heap_profiler::recordDeallocate(to_raw(ptr));
+		T* result = reallocate_bytes(to_raw(ptr), sizeof(T) * old_n, sizeof(T) * new_n, over_aligned());
+		heap_profiler::recordAllocate(result, sizeof(T) * new_n);
+		return result;
+	}
+
+	template <typename T, typename U, typename Alloc>
+	bool operator==(const allocator<T, Alloc>&, const allocator<U, Alloc>&) noexcept { return true; }
+
+	template <typename T, typename U, typename Alloc>
+	bool operator!=(const allocator<T, Alloc>&, const allocator<U, Alloc>&) noexcept { return false; }
+
+	/*
+	 * Alignֽڶķ(ȡAlignalignof(T)нϴһ)SIMDʹõ32/64ֽ
+	 * ߰иαÿ˼ĬϴallocдСAlign
+	 * 䣬malloc_allocnew_alloc<T>Լarena_allocҲΪAlloc
+	 */
+	template <typename T, size_t Align, typename Alloc = alloc>
+	class aligned_allocator {
+		static_assert(Align && (Align & (Align - 1)) == 0, "Align must be a power of two");
+
+	public:
+		using value_type       = T;
+		using pointer          = T*;
+		using const_pointer    = const T*;
+		using reference        = T&;
+		using const_reference  = const T&;
+		using size_type        = size_t;
+		using difference_type  = ptrdiff_t;
+
+		static constexpr size_t alignment = Align > alignof(T) ? Align : alignof(T);
+
+		using is_always_equal                        = std::true_type;
+		using propagate_on_container_copy_assignment = std::true_type;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap            = std::true_type;
+
+	public:
+		aligned_allocator() noexcept = default;
+		template <typename U>
+		aligned_allocator(const aligned_allocator<U, Align, Alloc>&) noexcept {}
+
+		static pointer allocate() {
+			return allocate(1);
+		}
+
+		static pointer allocate(size_type n) {
+			T* ptr = static_cast<T*>(Alloc::allocate(sizeof(T) * n, alignment));
+			heap_profiler::recordAllocate(ptr, sizeof(T) * n);
+			return ptr;
+		}
+
+		static void deallocate(pointer ptr) {
+			deallocate(ptr, 1);
+		}
+
+		static void deallocate(pointer ptr, size_type n) {
+			if (!ptr) return;
+			heap_profiler::recordDeallocate(ptr);
+			Alloc::deallocate(ptr, sizeof(T) * n, alignment);
+		}
+
+		template<typename U>
+		struct rebind
+		{
+			using other = aligned_allocator<U, Align, Alloc>;
+		};
+	};
+
+	template <typename T, typename U, size_t Align, typename Alloc>
+	bool operator==(const aligned_allocator<T, Align, Alloc>&, const aligned_allocator<U, Align, Alloc>&) noexcept { return true; }
+
+	template <typename T, typename U, size_t Align, typename Alloc>
+	bool operator!=(const aligned_allocator<T, Align, Alloc>&, const aligned_allocator<U, Align, Alloc>&) noexcept { return false; }
+
 }
\ No newline at end of file
@@ -32,7 +32,7 @@ namespace tinySTL {
 				if (*s1 < *s2)
 					return -1;
 				if (*s1 > *s2)
-					retuen 1;
+					return 1;
 			}
 			return 0;
 		}
@@ -152,8 +152,10 @@ namespace tinySTL {
 		using traits_type		= CharTraits;
 		using char_traits		= CharTraits;
 		
-		using allocator_type	= tinySTL::allocator<CharType, tinySTL::new_alloc<CharType>>;
-		using data_allocator	= tinySTL::allocator<CharType, tinySTL::new_alloc<CharType>>;
+		// ַ԰ֽڰƣmalloc_allocΪʱԭչrealloc
+		// reinsertͷbuffer_ʱСֻmalloc_allocҪСڴ֮ǰҪȲ
+		using allocator_type	= tinySTL::allocator<CharType, tinySTL::malloc_alloc>;
+		using data_allocator	= tinySTL::allocator<CharType, tinySTL::malloc_alloc>;
 
 		using value_type		= typename allocator_type::value_type;
 		using pointer			= typename allocator_type::pointer;
@@ -183,7 +185,7 @@ namespace tinySTL {
 		size_type size_;  // ַ
 		size_type cap_;   // ռС
 
-		constexpr size_type STRING_INIT_SIZE = 32; // ʼʱbasic_stringĳ
+		static constexpr size_type STRING_INIT_SIZE = 32; // ʼʱbasic_stringĳ
 
 	public:
 		// Ա졢ƶص
@@ -194,7 +196,7 @@ namespace tinySTL {
 			{
 				buffer_ = data_allocator::allocate(static_cast<size_type>(STRING_INIT_SIZE));
 				size_ = 0;
-				cap_ = 0;
+				cap_ = STRING_INIT_SIZE;
 			}
 			catch (...)
 			{
@@ -348,7 +350,7 @@ namespace tinySTL {
 			return reverse_iterator(begin());
 		}
 
-		const_reverse_iterator rend() noexcept
+		const_reverse_iterator rend() const noexcept
 		{
 			return const_reverse_iterator(begin());
 		}
@@ -403,21 +405,18 @@ namespace tinySTL {
 
 		void reserve(size_type cnt)
 		{
-			if (cap_ < cnt)
+			if (cap_ <= cnt) // cap_ĩβ'\0'
 			{
-				// ʹreallocateԭreallocateԼѡչռ
+				// charƽƣmalloc_allocʹôľɴСֱreallocǰȫ
 				assert(cnt < max_size());
-				auto new_buffer = data_allocator::allocate(cnt);
-				char_traits::move(new_buffer, buffer_, size_);
-				data_allocator::deallocate(buffer_);
-				buffer_ = new_buffer;
-				cap_ = cnt;
+				buffer_ = data_allocator::reallocate(buffer_, cap_, cnt + 1); // ԭչʱ
+				cap_ = cnt + 1;
 			}
 		}
 
 		void shrink_to_fit()
 		{
-			if (size_ != cap_)
+			if (size_ + 1 != cap_)
 			{
 				reinsert(size_);
 			}
@@ -427,7 +426,7 @@ namespace tinySTL {
 		iterator insert(const_iterator pos, value_type ch)
 		{
 			auto p = const_cast<iterator>(pos);
-			if (size_ == cap_)
+			if (size_ + 1 >= cap_)
 			{
 				return reallocate_and_fill(p, 1, ch);
 			}
@@ -442,17 +441,17 @@ namespace tinySTL {
 			auto p = const_cast<iterator>(pos);
 			if (cnt == 0)
 				return p;
-			if (cap_ - size_ < cnt)
+			if (cap_ - size_ <= cnt)
 			{
 				return reallocate_and_fill(p, cnt, ch);
 			}
 			if (pos == end())
 			{
-				char_traits::move(end(), ch, cnt);
+				char_traits::fill(end(), ch, cnt);
 				size_ += cnt;
 				return p;
 			}
-			char_traits::move(p + cnt, p, cnt);
+			char_traits::move(p + cnt, p, end() - p);
 			char_traits::fill(p, ch, cnt);
 			size_ += cnt;
 			return p;
@@ -464,47 +463,43 @@ namespace tinySTL {
 			auto p = const_cast<iterator>(pos);
 			const size_type len = tinySTL::distance(first, last);
 			if (!len) return p;
-			if (cap_ - size_ < len)
+			if (cap_ - size_ <= len)
 			{
-				return reallocate_and_copy(pos, first, last);
+				return reallocate_and_copy(p, first, last);
 			}
 			if (pos == end())
 			{
 				tinySTL::uninitialized_copy(first, last, end());
 				size_ += len;
-				return pos;
+				return p;
 			}
-			char_traits::move(pos + len, pos, len);
-			tinySTL::uninitialized_copy(first, last, pos);
+			char_traits::move(p + len, p, end() - p);
+			tinySTL::uninitialized_copy(first, last, p);
 			size_ += len;
-			return pos;
+			return p;
 		}
 
 		// append 
 		basic_string& append(size_type cnt, value_type ch)
 		{
 			assert(max_size() > size_ + cnt);
-			auto pos = buffer_ + size_;
-			if (pos + cnt > cap_)
+			if (size_ + cnt >= cap_)
 			{
 				reallocate(cnt); // ·ռ䣬עCеreallocʵֲһ
 			}
-			while (cnt--)
-			{
-				*pos++ = ch;
-			}
+			char_traits::fill(buffer_ + size_, ch, cnt);
+			size_ += cnt;
 			return *this;
 		}
 
 		basic_string& append(const_pointer s, size_type cnt)
 		{
 			assert(max_size() > size_ + cnt);
-			auto pos = buffer_ + size_;
-			if(size_ + cnt > cap_)
+			if(size_ + cnt >= cap_)
 			{
 				reallocate(cnt);
 			}
-			char_traits::copy(pos, s, cnt);
+			char_traits::copy(buffer_ + size_, s, cnt); // reallocate֮buffer_Ѿ
 			size_ += cnt;
 			return *this;
 		}
@@ -514,12 +509,12 @@ namespace tinySTL {
 			return append(s, char_traits::length(s));
 		}
 
-		basic_string& append(basic_string& str, size_type pos, size_type cnt)
+		basic_string& append(const basic_string& str, size_type pos, size_type cnt)
 		{
 			assert(size_ + cnt < max_size());
 			if (cnt == 0)
 				return *this;
-			if (size_ + cnt > cap_)
+			if (size_ + cnt >= cap_)
 			{
 				reallocate(cnt);
 			}
@@ -592,7 +587,7 @@ namespace tinySTL {
 			return (*this)[idx];
 		}
 
-		const_reference at(size_type idx)
+		const_reference at(size_type idx) const
 		{
 			return (*this)[idx];
 		}
@@ -603,7 +598,7 @@ namespace tinySTL {
 			return *begin();
 		}
 
-		const_refernece front() const
+		const_reference front() const
 		{
 			assert(!empty());
 			return *begin();
@@ -636,7 +631,7 @@ namespace tinySTL {
 		{
 			assert(pos != end());
 			auto p = const_cast<iterator>(pos);
-			char_traits::move(pos, pos + 1, end() - pos - 1);
+			char_traits::move(p, pos + 1, end() - pos - 1);
 			--size_;
 			return p;
 		}
@@ -702,47 +697,21 @@ namespace tinySTL {
 			cap_ = init_size;
 		}
 
-		template<typename Iter>
-		void copy_init(Iter first, Iter last, input_iterator_tag)
-		{
-			size_type n = tinySTL::distance(first, last);
-			const auto init_size = tinySTL::max(static_cast<size_type>(STRING_INIT_SIZE), cnt + 1);
-			try
-			{
-				buffer_ = data_allocator::allocate(init_size);
-				size_ = n;
-				cap_ = init_size;
-			}
-			catch (...)
-			{
-				buffer_ = nullptr;
-				size_ = 0;
-				cap_ = 0;
-				throw;
-			}
-
-			while (n--)
-			{
-				append(*first++);
-			}
-		}
-		
 		// reallocate
 		void reallocate(size_type need)
 		{
-			const auto new_cap = tinySTL::max(cap_ + need, cap_ + cap_ >> 1);
-			auto new_buffer = data_allocator::allocate(new_cap);
-			char_traits::move(new_buffer, buffer_, size_);
-			data_allocator::deallocate(buffer_);
-			buffer_ = new_buffer;
+			// һ룬appendʱreallocĴǶģ+1Ϊ'\0'
+			const auto new_cap = tinySTL::max(size_ + need + 1, cap_ + (cap_ >> 1));
+			/* ȳԭչٽreallocڴmremap */
+			buffer_ = data_allocator::reallocate(buffer_, cap_, new_cap);
 			cap_ = new_cap;
 		}
 
-		typename iterator reallocate_and_fill(iterator pos, size_type n, value_type ch)
+		iterator reallocate_and_fill(iterator pos, size_type n, value_type ch)
 		{
 			const auto residue = pos - buffer_;
 			const auto old_cap = cap_;
-			const auto new_cap = tinySTL::max(cap_ + n, cap_ + cap_ >> 1);
+			const auto new_cap = tinySTL::max(size_ + n + 1, cap_ + (cap_ >> 1));
 			auto new_buffer = data_allocator::allocate(new_cap);
 			// ·ڴ沢ԭеַмnchַ
 			auto p1 = char_traits::move(new_buffer, buffer_, residue) + residue;
@@ -755,12 +724,12 @@ namespace tinySTL {
 			return buffer_ + residue;
 		}
 
-		typename iterator reallocate_and_copy(iterator pos, const_iterator first, const_iterator last)
+		iterator reallocate_and_copy(iterator pos, const_iterator first, const_iterator last)
 		{
 			const auto residue = pos - buffer_;
 			const auto old_cap = cap_;
 			const auto distance = tinySTL::distance(first, last);
-			const auto new_cap = tinySTL::max(cap_ + distance, cap_ + cap_ >> 1);
+			const auto new_cap = tinySTL::max(size_ + static_cast<size_type>(distance) + 1, cap_ + (cap_ >> 1));
 			auto new_buffer = data_allocator::allocate(new_cap);
 			// reallocate_and_fill
 			auto p1 = char_traits::move(new_buffer, buffer_, residue) + residue;
@@ -768,7 +737,7 @@ namespace tinySTL {
 			char_traits::move(p2, pos, size_ - residue);
 			data_allocator::deallocate(buffer_, old_cap);
 			buffer_ = new_buffer;
-			size_ += n;
+			size_ += distance;
 			cap_ = new_cap;
 			return buffer_ + residue;
 		}
@@ -778,12 +747,12 @@ namespace tinySTL {
 		void copy_init(Iter first, Iter last, tinySTL::input_iterator_tag)
 		{
 			const auto distance = tinySTL::distance(first, last);
-			const auto init_size = tinySTL::max(static_cast<size_type>(STRING_INIT_SIZE), distance + 1);
+			const auto init_size = tinySTL::max(static_cast<size_type>(STRING_INIT_SIZE), static_cast<size_type>(distance) + 1);
 			try
 			{
 				buffer_ = data_allocator::allocate(init_size);
 				size_ = distance;
-				cap_ init_size;
+				cap_ = init_size;
 			}
 			catch (...)
 			{
@@ -802,12 +771,12 @@ namespace tinySTL {
 		void copy_init(Iter first, Iter last, tinySTL::forward_iterator_tag)
 		{
 			const auto distance = tinySTL::distance(first, last);
-			const auto init_size = tinySTL::max(static_cast<size_type>(STRING_INIT_SIZE), distance + 1);
+			const auto init_size = tinySTL::max(static_cast<size_type>(STRING_INIT_SIZE), static_cast<size_type>(distance) + 1);
 			try
 			{
 				buffer_ = data_allocator::allocate(init_size);
 				size_ = distance;
-				cap_ init_size;
+				cap_ = init_size;
 				tinySTL::uninitialized_copy(first, last, buffer_);
 			}
 			catch (...)
@@ -825,7 +794,7 @@ namespace tinySTL {
 		{
 			const auto distance = tinySTL::distance(first, last);
 			assert(distance + size_ < max_size());
-			if (size_ + distance > cap_)
+			if (size_ + distance >= cap_)
 			{
 				reallocate(distance);
 			}
@@ -837,7 +806,7 @@ namespace tinySTL {
 		// reinsert
 		void reinsert(size_type size)
 		{
-			auto new_buffer = data_allocator::allocate(size);
+			auto new_buffer = data_allocator::allocate(size + 1); // +1Ϊ'\0'
 			try
 			{
 				char_traits::move(new_buffer, buffer_, size);
@@ -849,7 +818,7 @@ namespace tinySTL {
 			data_allocator::deallocate(buffer_);
 			buffer_ = new_buffer;
 			size_ = size;
-			cap_ = size;
+			cap_ = size + 1;
 		}
 
 		// destory
@@ -865,13 +834,17 @@ namespace tinySTL {
 		}
 
 		// to_raw_pointer
-		const_pointer to_raw_pointer()
+		const_pointer to_raw_pointer() const
 		{
 			*(buffer_ + size_) = value_type();
 			return buffer_;
 		}
 	};
 
+	// ڶ(ûжַŻ)Ҳû״ֽ̬ڰ֮ȻЧ
+	template<typename CharType, typename CharTraits>
+	struct is_trivially_relocatable<basic_string<CharType, CharTraits>> : std::true_type {};
+
 	// ȫֵswap
 	template<typename CharType, typename CharTraits>
 	void swap(basic_string<CharType, CharTraits>& lhs, basic_string<CharType, CharTraits>& rhs)
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "shm_arena.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#endif
+
+namespace tinySTL {
+
+	// ļͷĸʽָıʱһӳĸʽSHMVersion
+	enum {
+		FILEVersion = 1,
+	};
+
+	/*
+	 * ӳ䵽ļϵmapped_arenaڽ˳ȻĽopenͬһļ
+	 * getRootҵһνõݽṹ(ַ)شͷؽŽļ
+	 * ַҪstd::basic_string<char, std::char_traits<char>, allocator<char, shm_alloc>>
+	 * tinySTL::basic_stringûAllocԭָ뱣滺ӳ䵽ĵַʧЧˡ
+	 * ļĵһҳļͷ¼ʽ汾ʹ߸layout(ͻ߲
+	 * ıʱʹ߻һlayoutļͲᱻ)ʹòֵУͣԼǷ
+	 * closeӳӵڶҳʼͬͨshm_alloc/shm_scopetinySTL::allocator
+	 * openʱ⼸һԲϾͷfalseʹcreateһļؽʹõļ
+	 * flockסͬһʱֻܱһfile_arena򿪡Windowscreate/openʧ
+	 */
+	class file_arena : public mapped_arena_base {
+	public:
+		file_arena() noexcept : fd(-1), mapAddr(nullptr), mapBytes(0) {}
+		~file_arena() { close(); }
+
+		// ½pathѾʱؽbytesӳĴСļͷ
+		bool create(const char* path, size_t bytes, uint64_t layout = 0) {
+			close();
+#if defined(_WIN32)
+			(void)path;
+			(void)bytes;
+			(void)layout;
+			return false;
+#else
+			bytes = SystemPages::roundUp(bytes);
+			if (bytes < (size_t)PAGEBytes || (uint64_t)bytes > MAXMapBytes || !openFile(path, O_RDWR | O_CREAT))
+				return false;
+			size_t total = getHeaderBytes() + bytes;
+			/* Ƚس0չɵȫ0 */
+			if (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)total) != 0 || !mapFile(total)) {
+				closeFile();
+				return false;
+			}
+			FileHeader* h = getFileHeader();
+			h->magic = FILEMagic;
+			h->version = (uint32_t)FILEVersion;
+			h->clean = 0;
+			h->layout = layout;
+			h->bytes = total;
+			format(mapAddr + getHeaderBytes(), bytes);
+			return true;
+#endif
+		}
+
+		// һcloseļʽlayoutУͶʱtrue
+		bool open(const char* path, uint64_t layout = 0) {
+			close();
+#if defined(_WIN32)
+			(void)path;
+			(void)layout;
+			return false;
+#else
+			if (!openFile(path, O_RDWR))
+				return false;
+			struct stat st;
+			if (fstat(fd, &st) != 0 || (size_t)st.st_size <= getHeaderBytes() || !mapFile((size_t)st.st_size)) {
+				closeFile();
+				return false;
+			}
+			FileHeader* h = getFileHeader();
+			size_t bytes = mapBytes - getHeaderBytes();
+			if (h->magic != FILEMagic || h->version != (uint32_t)FILEVersion || h->layout != layout
+				|| h->bytes != (uint64_t)mapBytes || !h->clean || !attach(mapAddr + getHeaderBytes(), bytes)
+				|| h->usedBytes != (uint64_t)(size() - available())
+				|| h->checksum != getChecksum(base(), (size_t)h->usedBytes)) {
+				detach();
+				unmapFile();
+				closeFile();
+				return false;
+			}
+			/* ڼļ޸У̱µļһopenʱᱻ */
+			h->clean = 0;
+			msync(mapAddr, getHeaderBytes(), MS_SYNC);
+			return true;
+#endif
+		}
+
+		// УͣΪرգдļӳ
+		void close() noexcept {
+#if !defined(_WIN32)
+			if (isOpen()) {
+				FileHeader* h = getFileHeader();
+				h->usedBytes = (uint64_t)(size() - available());
+				h->checksum = getChecksum(base(), (size_t)h->usedBytes);
+				h->clean = 1;
+				msync(mapAddr, mapBytes, MS_SYNC);
+			}
+			detach();
+			unmapFile();
+			closeFile();
+#else
+			detach();
+#endif
+		}
+
+	private:
+		static constexpr uint64_t FILEMagic = 0x656c69464c545374ull; // "tSTLFile"
+
+		struct FileHeader {
+			uint64_t magic;
+			uint32_t version;
+			uint32_t clean;      // close֮Ϊ1
+			uint64_t layout;
+			uint64_t bytes;      // ļĴС
+			uint64_t usedBytes;  // ӳѾзֹĲ֣Уֻһ
+			uint64_t checksum;
+		};
+
+		// ӳҪҳ룬ļͷռһҳ
+		static size_t getHeaderBytes() noexcept { return SystemPages::roundUp(sizeof(FileHeader)); }
+
+		FileHeader* getFileHeader() const noexcept { return (FileHeader*)mapAddr; }
+
+		/*
+		 * 8ֽһĳ˷ɢУ·㣬صһĳ˷ٶȽӽڴ
+		 * ļضϡĳдûд꣬Ĵ۸
+		 */
+		static uint64_t getChecksum(const char* p, size_t n) noexcept {
+			const uint64_t K = 0x9E3779B97F4A7C15ull;
+			uint64_t h[4] = { K ^ n, K * 3, K * 5, K * 7 };
+			size_t words = n / 8, i = 0;
+			for (; i + 4 <= words; i += 4) {
+				for (int j = 0; j < 4; ++j) {
+					uint64_t w;
+					std::memcpy(&w, p + (i + j) * 8, 8);
+					h[j] = (h[j] ^ w) * K;
+					h[j] ^= h[j] >> 29;
+				}
+			}
+			uint64_t r = h[0] ^ (h[1] << 1) ^ (h[2] << 2) ^ (h[3] << 3);
+			for (i *= 8; i < n; ++i)
+				r = (r ^ (unsigned char)p[i]) * K;
+			return r ^ (r >> 31);
+		}
+
+#if !defined(_WIN32)
+		bool openFile(const char* path, int flags) noexcept {
+			fd = ::open(path, flags, 0644);
+			if (fd < 0)
+				return false;
+			if (flock(fd, LOCK_EX | LOCK_NB) != 0) { // file_arenaʹļ
+				closeFile();
+				return false;
+			}
+			return true;
+		}
+
+		bool mapFile(size_t bytes) noexcept {
+			void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (p == MAP_FAILED)
+				return false;
+			mapAddr = (char*)p;
+			mapBytes = bytes;
+			return true;
+		}
+
+		void unmapFile() noexcept {
+			if (mapAddr)
+				munmap(mapAddr, mapBytes);
+			mapAddr = nullptr;
+			mapBytes = 0;
+		}
+
+		void closeFile() noexcept {
+			if (fd >= 0)
+				::close(fd); // flock֮ͷ
+			fd = -1;
+		}
+#endif
+
+		int fd;
+		char* mapAddr;    // ļͷӳһҳ
+		size_t mapBytes;  // ļ
+	};
+}
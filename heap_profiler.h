@@ -0,0 +1,291 @@
+#pragma once
+
+#include "alloc.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__GNUC__) && !defined(_WIN32)
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#endif
+
+namespace tinySTL {
+
+	/*
+	 * ʽĶѷallocator<T, Alloc>::allocate/deallocateϡ
+	 * ÿ߳άһ"һγʣֽ"ļʱֻһμͱȽϣ
+	 * Ž·µջʹСͷʱȲһַ
+	 * ϣλͼλͼвżͷֻһζ
+	 * ӾֵΪsampleRateֲָ(ֽڵĲɹ)СΪsizeķ
+	 * еĸ1-exp(-size/rate)ĵԭֽ
+	 */
+	template <int inst>
+	class HeapProfilerTemplate {
+	public:
+		// ƽÿrateֽڳһΣ0ʾر(Ĭ)
+		static void setSampleRate(size_t rate) { sampleRate.store(rate, std::memory_order_relaxed); }
+		static size_t getSampleRate() { return sampleRate.load(std::memory_order_relaxed); }
+
+		static void recordAllocate(void* p, size_t bytes) {
+			size_t rate = sampleRate.load(std::memory_order_relaxed);
+			if (!rate || !p)
+				return;
+			bytesUntilSample -= (int64_t)bytes;
+			if (bytesUntilSample < 0)
+				sampleAllocation(p, bytes, rate);
+		}
+
+		static void recordDeallocate(void* p) {
+			if (!p || !liveCount.load(std::memory_order_relaxed))
+				return;
+			size_t bit = getFilterBit(p);
+			if (filter[bit / 64].load(std::memory_order_relaxed) & ((uint64_t)1 << (bit % 64)))
+				removeSample(p);
+		}
+
+		static size_t liveSamples() { return liveCount.load(std::memory_order_relaxed); }
+		static size_t liveBytes(); // Ĵֽ
+
+		// gperftoolsheap profileıʽ(heap_v2)ֱӽpprof
+		static void dumpPprof(FILE* out);
+		// ";...;ڲ ֽ"۵ջʽԽflamegraph.pl
+		static void dumpFolded(FILE* out);
+
+	private:
+		enum {
+			MAXDepth = 32,
+			BUCKETS = 4096,
+			FILTERBits = 16384,
+		};
+
+		struct Sample {
+			Sample* next;
+			void* ptr;
+			size_t size;
+			size_t weight; // ֽ
+			int depth;
+			void* stack[MAXDepth];
+		};
+
+		static std::atomic<size_t> sampleRate;
+		static std::atomic<size_t> liveCount;
+		static std::atomic<uint64_t> filter[FILTERBits / 64];
+		static uint32_t filterCount[FILTERBits]; // ÿһλϴsampleMutex
+		static Sample* buckets[BUCKETS];
+		static size_t allocSamples;  // ۼƵֽ
+		static size_t allocBytes;
+		static std::mutex sampleMutex;
+		static thread_local int64_t bytesUntilSample;
+		static thread_local uint64_t randomState;
+		static thread_local bool started;
+
+		static size_t hashPtr(void* p) {
+			return (size_t)((((uint64_t)(uintptr_t)p >> 3) * 0x9E3779B97F4A7C15ull) >> 32);
+		}
+
+		static size_t getFilterBit(void* p) { return hashPtr(p) % (size_t)FILTERBits; }
+		static size_t getBucket(void* p) { return (hashPtr(p) >> 14) % (size_t)BUCKETS; }
+
+		static int64_t nextInterval(size_t rate);
+		static int captureStack(void** stack);
+		static void sampleAllocation(void* p, size_t bytes, size_t rate);
+		static void removeSample(void* p);
+		static void printFrame(FILE* out, void* pc);
+	};
+
+	template <int inst>
+	std::atomic<size_t> HeapProfilerTemplate<inst>::sampleRate{ 0 };
+
+	template <int inst>
+	std::atomic<size_t> HeapProfilerTemplate<inst>::liveCount{ 0 };
+
+	template <int inst>
+	std::atomic<uint64_t> HeapProfilerTemplate<inst>::filter[FILTERBits / 64];
+
+	template <int inst>
+	uint32_t HeapProfilerTemplate<inst>::filterCount[FILTERBits] = { 0 };
+
+	template <int inst>
+	typename HeapProfilerTemplate<inst>::Sample* HeapProfilerTemplate<inst>::buckets[BUCKETS] = { nullptr };
+
+	template <int inst>
+	size_t HeapProfilerTemplate<inst>::allocSamples = 0;
+
+	template <int inst>
+	size_t HeapProfilerTemplate<inst>::allocBytes = 0;
+
+	template <int inst>
+	std::mutex HeapProfilerTemplate<inst>::sampleMutex;
+
+	template <int inst>
+	thread_local int64_t HeapProfilerTemplate<inst>::bytesUntilSample = 0;
+
+	template <int inst>
+	thread_local uint64_t HeapProfilerTemplate<inst>::randomState = 0;
+
+	template <int inst>
+	thread_local bool HeapProfilerTemplate<inst>::started = false;
+
+	template <int inst>
+	int64_t HeapProfilerTemplate<inst>::nextInterval(size_t rate) {
+		if (!randomState) // ÿ߳Լĵַ
+			randomState = (uint64_t)(uintptr_t)&randomState * 0x9E3779B97F4A7C15ull | 1;
+		/* xorshift64*ȡ53λõ(0, 1)еľȷֲ */
+		randomState ^= randomState >> 12;
+		randomState ^= randomState << 25;
+		randomState ^= randomState >> 27;
+		double u = (double)((randomState * 0x2545F4914F6CDD1Dull) >> 11) + 1.0;
+		u /= 9007199254740993.0; // 2^53 + 1
+		return (int64_t)(-std::log(u) * (double)rate) + 1;
+	}
+
+	template <int inst>
+	int HeapProfilerTemplate<inst>::captureStack(void** stack) {
+#if defined(_WIN32)
+		return (int)CaptureStackBackTrace(2, MAXDepth, stack, nullptr);
+#elif defined(__GNUC__)
+		/* ȥcaptureStacksampleAllocation֡Ǳʱټһallocate */
+		void* frames[MAXDepth + 2];
+		int depth = backtrace(frames, MAXDepth + 2) - 2;
+		if (depth <= 0)
+			return 0;
+		std::memcpy(stack, frames + 2, depth * sizeof(void*));
+		return depth;
+#else
+		(void)stack;
+		return 0;
+#endif
+	}
+
+	template <int inst>
+	void HeapProfilerTemplate<inst>::sampleAllocation(void* p, size_t bytes, size_t rate) {
+		if (!started) {
+			/* ̵߳ĵһηֻȷһ */
+			started = true;
+			bytesUntilSample = nextInterval(rate);
+			return;
+		}
+		/* һκܴķܿüֻһ */
+		while (bytesUntilSample < 0)
+			bytesUntilSample += nextInterval(rate);
+
+		Sample* s = (Sample*)malloc_alloc::allocate(sizeof(Sample));
+		s->ptr = p;
+		s->size = bytes;
+		double keep = 1.0 - std::exp(-(double)bytes / (double)rate);
+		s->weight = keep > 0 ? (size_t)((double)bytes / keep) : bytes;
+		s->depth = captureStack(s->stack);
+
+		std::lock_guard<std::mutex> guard(sampleMutex);
+		size_t bit = getFilterBit(p);
+		if (filterCount[bit]++ == 0)
+			filter[bit / 64].fetch_or((uint64_t)1 << (bit % 64), std::memory_order_relaxed);
+		Sample** head = buckets + getBucket(p);
+		s->next = *head;
+		*head = s;
+		++allocSamples;
+		allocBytes += bytes;
+		liveCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	template <int inst>
+	void HeapProfilerTemplate<inst>::removeSample(void* p) {
+		Sample* s = nullptr;
+		{
+			std::lock_guard<std::mutex> guard(sampleMutex);
+			for (Sample** link = buckets + getBucket(p); *link; link = &(*link)->next) {
+				if ((*link)->ptr == p) {
+					s = *link;
+					*link = s->next;
+					break;
+				}
+			}
+			if (!s) // λͼУַûб
+				return;
+			size_t bit = getFilterBit(p);
+			if (--filterCount[bit] == 0)
+				filter[bit / 64].fetch_and(~((uint64_t)1 << (bit % 64)), std::memory_order_relaxed);
+			liveCount.fetch_sub(1, std::memory_order_relaxed);
+		}
+		malloc_alloc::deallocate(s);
+	}
+
+	template <int inst>
+	size_t HeapProfilerTemplate<inst>::liveBytes() {
+		std::lock_guard<std::mutex> guard(sampleMutex);
+		size_t total = 0;
+		for (Sample* head : buckets) {
+			for (Sample* s = head; s; s = s->next)
+				total += s->weight;
+		}
+		return total;
+	}
+
+	template <int inst>
+	void HeapProfilerTemplate<inst>::dumpPprof(FILE* out) {
+		std::lock_guard<std::mutex> guard(sampleMutex);
+		size_t inuseBytes = 0;
+		for (Sample* head : buckets) {
+			for (Sample* s = head; s; s = s->next)
+				inuseBytes += s->size;
+		}
+		/* heap_v2ʽм¼ԭʼpprofݳԭ */
+		std::fprintf(out, "heap profile: %zu: %zu [ %zu: %zu] @ heap_v2/%zu\n",
+			liveCount.load(std::memory_order_relaxed), inuseBytes, allocSamples, allocBytes,
+			sampleRate.load(std::memory_order_relaxed));
+		for (Sample* head : buckets) {
+			for (Sample* s = head; s; s = s->next) {
+				std::fprintf(out, "1: %zu [1: %zu] @", s->size, s->size);
+				for (int i = 0; i < s->depth; ++i)
+					std::fprintf(out, " %p", s->stack[i]);
+				std::fprintf(out, "\n");
+			}
+		}
+#if defined(__linux__)
+		/* pprofӳѵַӦִļͶ̬ */
+		std::fprintf(out, "\nMAPPED_LIBRARIES:\n");
+		if (FILE* maps = std::fopen("/proc/self/maps", "r")) {
+			char buf[4096];
+			size_t n;
+			while ((n = std::fread(buf, 1, sizeof(buf), maps)) > 0)
+				std::fwrite(buf, 1, n, out);
+			std::fclose(maps);
+		}
+#endif
+	}
+
+	template <int inst>
+	void HeapProfilerTemplate<inst>::printFrame(FILE* out, void* pc) {
+#if defined(__GNUC__) && !defined(_WIN32)
+		Dl_info info;
+		if (dladdr(pc, &info) && info.dli_sname) {
+			int status = 0;
+			char* name = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+			std::fputs(status == 0 && name ? name : info.dli_sname, out);
+			std::free(name);
+			return;
+		}
+#endif
+		std::fprintf(out, "%p", pc);
+	}
+
+	template <int inst>
+	void HeapProfilerTemplate<inst>::dumpFolded(FILE* out) {
+		std::lock_guard<std::mutex> guard(sampleMutex);
+		for (Sample* head : buckets) {
+			for (Sample* s = head; s; s = s->next) {
+				/* ջĵ߿ʼ÷ֺŸǹֽ */
+				for (int i = s->depth - 1; i >= 0; --i) {
+					printFrame(out, s->stack[i]);
+					if (i)
+						std::fputc(';', out);
+				}
+				std::fprintf(out, "%s%zu\n", s->depth ? " " : "[unknown] ", s->weight);
+			}
+		}
+	}
+
+	using heap_profiler = HeapProfilerTemplate<0>;
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+#include "alloc.h"
+
+/*
+ * ò[0, MAXHeaps)֮ڵid(openʧʱص-1)heap_registry÷Ĭڵ԰汾
+ * ԡ汾id䵽һӦκζѵıϣallocate׳bad_allocdeallocate͸
+ * ʲôҲgetStatsȫ0trim0ļ֮ǰԻɱĴ
+ */
+#ifndef TINYSTL_HEAP_INVALID_ID
+#define TINYSTL_HEAP_INVALID_ID(id) assert(!"tinySTL: heap id out of range")
+#endif
+
+namespace tinySTL {
+
+	// ϵͳĶʹinstHEAPInstʼDefaultAllocTemplate;inst
+	// һMAXHeapsʱĶidе
+	enum {
+		HEAPInst = 1024,
+		MAXHeaps = 16,
+		HEAPName = 32,  // ֵ󳤶ȣβ0
+	};
+
+	// ھ֪idϵͳֱheap_alloc<id>ΪAllocallocator<T, heap_alloc<1>>
+	template <int id>
+	using heap_alloc = DefaultAllocTemplate<true, HEAPInst + id>;
+
+	/*
+	 * ֵǼǵϵͳѣ"network""parser""cache"ÿһ
+	 * DefaultAllocTemplateʵԼ̻߳桢chunkͳơԤtrimֵ
+	 * һϵͳƬƵ䲻ἷһϵͳڴռҲܰϵͳͳơ
+	 * openȡöidͬһǵõͬһid֮idʱ䣬
+	 * Ҳڱheap_alloc<id>ͬһѡ
+	 */
+	template <int inst>
+	class HeapRegistryTemplate {
+	public:
+		// ȡΪnameĶѣûʱռһеidid̫ʱ-1
+		static int open(const char* name);
+		// nameǼΪָidʹheap_alloc<id>ϵͳ֡idѾбʱfalse
+		static bool open(const char* name, int id);
+		// ΪnameĶѵidûеǼǹʱ-1
+		static int find(const char* name);
+		static const char* getName(int id);
+
+		static void* allocate(int id, size_t n) { return getOps(id).allocate(n); }
+		static void deallocate(int id, void* p, size_t n) { getOps(id).deallocate(p, n); }
+
+		static AllocStats getStats(int id) { return getOps(id).getStats(); }
+		static void setStatsEnabled(int id, bool on) { getOps(id).setStatsEnabled(on); }
+		static MemoryBudget& getBudget(int id) { return getOps(id).getBudget(); }
+		// ÿԼtrimԣֽڱһtrimbytesʱԶtrim
+		static void setTrimThreshold(int id, size_t bytes) { getOps(id).setTrimThreshold(bytes); }
+		static size_t trim(int id) { return getOps(id).trim(); }
+		// trimеǼǹĶѣع黹ֽ
+		static size_t trimAll();
+
+		// ÿǼǹĶһУ֡פֽڡֽڡ
+		static void report(FILE* out);
+
+	private:
+		struct HeapOps {
+			void* (*allocate)(size_t);
+			void (*deallocate)(void*, size_t);
+			AllocStats (*getStats)();
+			void (*setStatsEnabled)(bool);
+			MemoryBudget& (*getBudget)();
+			void (*setTrimThreshold)(size_t);
+			size_t (*trim)();
+		};
+
+		template <int id>
+		static HeapOps getOpsOf() {
+			using pool = heap_alloc<id>;
+			return {
+				static_cast<void* (*)(size_t)>(&pool::allocate),
+				static_cast<void (*)(void*, size_t)>(&pool::deallocate),
+				&pool::getStats,
+				&pool::setStatsEnabled,
+				&pool::getBudget,
+				&pool::setTrimThreshold,
+				&pool::trim,
+			};
+		}
+
+		// ЧidӦı
+		struct NoHeap {
+			static void* allocate(size_t) { throw std::bad_alloc(); }
+			static void deallocate(void*, size_t) noexcept {}
+			static AllocStats getStats() { return AllocStats(); }
+			static void setStatsEnabled(bool) noexcept {}
+			static MemoryBudget& getBudget() noexcept {
+				static MemoryBudget unused;  // Ӧκζѣ޶
+				return unused;
+			}
+			static void setTrimThreshold(size_t) noexcept {}
+			static size_t trim() noexcept { return 0; }
+		};
+
+		// һNoHeapԽidӳ䵽
+		template <size_t... I>
+		static const HeapOps& getOps(int id, std::index_sequence<I...>) {
+			static const HeapOps table[] = { getOpsOf<(int)I>()...,
+				{ &NoHeap::allocate, &NoHeap::deallocate, &NoHeap::getStats, &NoHeap::setStatsEnabled,
+				  &NoHeap::getBudget, &NoHeap::setTrimThreshold, &NoHeap::trim } };
+			if (id < 0 || id >= (int)MAXHeaps) {
+				TINYSTL_HEAP_INVALID_ID(id);
+				return table[MAXHeaps];
+			}
+			return table[id];
+		}
+
+		static const HeapOps& getOps(int id) { return getOps(id, std::make_index_sequence<(size_t)MAXHeaps>()); }
+
+		static std::mutex registryMutex;
+		static char names[MAXHeaps][HEAPName];  // ַʾidûеǼ
+	};
+
+	template <int inst>
+	std::mutex HeapRegistryTemplate<inst>::registryMutex;
+
+	template <int inst>
+	char HeapRegistryTemplate<inst>::names[MAXHeaps][HEAPName] = {};
+
+	template <int inst>
+	int HeapRegistryTemplate<inst>::open(const char* name) {
+		if (!name[0] || std::strlen(name) >= (size_t)HEAPName)
+			return -1;
+		std::lock_guard<std::mutex> guard(registryMutex);
+		int freeId = -1;
+		for (int id = 0; id < (int)MAXHeaps; ++id) {
+			if (!std::strcmp(names[id], name))
+				return id;
+			if (freeId < 0 && !names[id][0])
+				freeId = id;
+		}
+		if (freeId >= 0)
+			std::strcpy(names[freeId], name);
+		return freeId;
+	}
+
+	template <int inst>
+	bool HeapRegistryTemplate<inst>::open(const char* name, int id) {
+		if (id < 0 || id >= (int)MAXHeaps || !name[0] || std::strlen(name) >= (size_t)HEAPName)
+			return false;
+		std::lock_guard<std::mutex> guard(registryMutex);
+		for (int i = 0; i < (int)MAXHeaps; ++i) {
+			if (i != id && !std::strcmp(names[i], name))
+				return false; // ͬһֲܶӦ
+		}
+		if (names[id][0])
+			return !std::strcmp(names[id], name);
+		std::strcpy(names[id], name);
+		return true;
+	}
+
+	template <int inst>
+	int HeapRegistryTemplate<inst>::find(const char* name) {
+		std::lock_guard<std::mutex> guard(registryMutex);
+		for (int id = 0; id < (int)MAXHeaps; ++id) {
+			if (names[id][0] && !std::strcmp(names[id], name))
+				return id;
+		}
+		return -1;
+	}
+
+	template <int inst>
+	const char* HeapRegistryTemplate<inst>::getName(int id) {
+		if (id < 0 || id >= (int)MAXHeaps)
+			return nullptr;
+		std::lock_guard<std::mutex> guard(registryMutex);
+		return names[id][0] ? names[id] : nullptr;  // ֵǼǺ󲻻ı
+	}
+
+	template <int inst>
+	size_t HeapRegistryTemplate<inst>::trimAll() {
+		size_t released = 0;
+		for (int id = 0; id < (int)MAXHeaps; ++id) {
+			if (getName(id))
+				released += trim(id);
+		}
+		return released;
+	}
+
+	template <int inst>
+	void HeapRegistryTemplate<inst>::report(FILE* out) {
+		std::fprintf(out, "%-16s %14s %14s %14s\n", "heap", "resident", "idle", "allocs");
+		for (int id = 0; id < (int)MAXHeaps; ++id) {
+			const char* name = getName(id);
+			if (!name)
+				continue;
+			AllocStats stats = getStats(id);
+			uint64_t allocs = stats.largeAllocs;
+			for (const AllocStats::SizeClass& c : stats.classes)
+				allocs += c.allocs;
+			std::fprintf(out, "%-16s %14zu %14zu %14llu\n", name, stats.residentBytes, stats.idleBytes,
+				(unsigned long long)allocs);
+		}
+	}
+
+	using heap_registry = HeapRegistryTemplate<0>;
+}
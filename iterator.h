@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 #include "type_traits.h"
 
 namespace tinySTL {
@@ -186,7 +188,7 @@ namespace tinySTL {
 		using reference = typename iterator_traits<Iterator>::reference;
 
 		using iterator_type = Iterator;
-		using self = typename reverse_iterator<Iterator>;
+		using self = reverse_iterator<Iterator>;
 
 	public:
 		reverse_iterator() {}
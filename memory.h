@@ -1,10 +1,18 @@
 #pragma once
 
+#include <atomic>
+#include <climits>
+#include <cstdlib>
 #include <type_traits>
 #include <ostream>
 #include <exception>
 #include <functional>
 
+#include "util.h"
+#include "type_traits.h"
+#include "construct.h"
+#include "uninitialized.h"
+
 
 namespace tinySTL {
 
@@ -179,18 +187,6 @@ namespace tinySTL {
 	template<typename FROM, typename TO>
 	using pointers_are_convertible = std::enable_if_t<std::is_convertible<FROM*, TO*>::value>;
 
-	template<typename T>
-	struct is_unbounded_array : std::false_type {};
-
-	template<typename T>
-	struct is_unbounded_array<T[]> : std::true_type {};
-
-	template<typename T>
-	struct is_bounded_array : std::false_type {};
-
-	template<typename T, std::size_t N>
-	struct is_unbounded_array<T[N]> : std::true_type {};
-
 	// default deleter
 
 	template<typename T>
@@ -336,7 +332,7 @@ namespace tinySTL {
 	template<typename CharT, typename Traits, typename T, typename D>
 	std::basic_ostream<CharT, Traits>& operator<<(std::basic_ostream<CharT, Traits>& os,
 		const unique_ptr<T, D>& unique) {
-		std::cout << *unique;
+		os << *unique;
 		return os;
 	}
 
@@ -517,7 +513,7 @@ namespace tinySTL {
 		}
 	public:
 		template<typename Y,
-			typename = TypeCanBeConstructedFrom<T, Deleter, Y>>
+			typename = is_constructible_from<T, deleter_type, Y>>
 			void reset(Y* ptr) noexcept
 		{
 			pointer old_ptr = this->ptr;
@@ -575,6 +571,10 @@ namespace tinySTL {
 		}
 	};
 
+	// unique_ptrֻһָɾɾ԰ֽڰʱҲ
+	template<typename T, typename Deleter>
+	struct is_trivially_relocatable<unique_ptr<T, Deleter>> : is_trivially_relocatable<Deleter> {};
+
 	// ָ룺shared_ptr
 	// 
 	//
@@ -1188,6 +1188,13 @@ namespace tinySTL {
 		}
 	};
 
+	// shared_ptrweak_ptrֻжָͿƿָ룬ƿ鲻¼ǵĵַ
+	template<typename T>
+	struct is_trivially_relocatable<shared_ptr<T>> : std::true_type {};
+
+	template<typename T>
+	struct is_trivially_relocatable<weak_ptr<T>> : std::true_type {};
+
 	template<typename T>
 	class enable_shared_from_this {
 	public:
@@ -0,0 +1,603 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "allocator.h"
+
+namespace tinySTL {
+
+	/*
+	 * ʱѡڴԴӿںstd::pmrһ¡tinySTL::allocatorAllocڱ
+	 * ͹̶ˣһģеûʹһģʱžarenamemory_resource
+	 * ѷԷŵ麯棬ֻһָ룬ͬһ͵ԸʹòͬԴ
+	 * ÿһmonotonic_buffer_resourceʱ嶪
+	 */
+	class memory_resource {
+	public:
+		virtual ~memory_resource() = default;
+
+		void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+			return do_allocate(bytes, align);
+		}
+
+		// bytesalignҪͷʱһ
+		void deallocate(void* p, size_t bytes, size_t align = alignof(std::max_align_t)) {
+			do_deallocate(p, bytes, align);
+		}
+
+		// Դڴܷ񽻸otherͷ
+		bool is_equal(const memory_resource& other) const noexcept { return do_is_equal(other); }
+
+	protected:
+		virtual void* do_allocate(size_t bytes, size_t align) = 0;
+		virtual void do_deallocate(void* p, size_t bytes, size_t align) = 0;
+		virtual bool do_is_equal(const memory_resource& other) const noexcept { return this == &other; }
+	};
+
+	inline bool operator==(const memory_resource& a, const memory_resource& b) noexcept {
+		return &a == &b || a.is_equal(b);
+	}
+
+	inline bool operator!=(const memory_resource& a, const memory_resource& b) noexcept {
+		return !(a == b);
+	}
+
+	// ֱӵoperator new/delete
+	class new_delete_resource_type final : public memory_resource {
+	protected:
+		void* do_allocate(size_t bytes, size_t align) override {
+			if (align <= (size_t)__STDCPP_DEFAULT_NEW_ALIGNMENT__)
+				return ::operator new(bytes);
+			return ::operator new(bytes, std::align_val_t(align));
+		}
+
+		void do_deallocate(void* p, size_t /* bytes */, size_t align) override {
+			if (align <= (size_t)__STDCPP_DEFAULT_NEW_ALIGNMENT__)
+				::operator delete(p);
+			else
+				::operator delete(p, std::align_val_t(align));
+		}
+
+		bool do_is_equal(const memory_resource& other) const noexcept override {
+			return dynamic_cast<const new_delete_resource_type*>(&other) != nullptr;
+		}
+	};
+
+	// ÿη䶼׳bad_allocΪʱԱֻ֤ʹøĻ
+	class null_memory_resource_type final : public memory_resource {
+	protected:
+		void* do_allocate(size_t, size_t) override { throw std::bad_alloc(); }
+		void do_deallocate(void*, size_t, size_t) override {}
+	};
+
+	inline memory_resource* new_delete_resource() noexcept {
+		static new_delete_resource_type resource;
+		return &resource;
+	}
+
+	inline memory_resource* null_memory_resource() noexcept {
+		static null_memory_resource_type resource;
+		return &resource;
+	}
+
+	inline std::atomic<memory_resource*>& default_resource_holder() noexcept {
+		static std::atomic<memory_resource*> current{ new_delete_resource() };
+		return current;
+	}
+
+	// ûָԴʱʹõԴʼΪnew_delete_resource()
+	inline memory_resource* get_default_resource() noexcept {
+		return default_resource_holder().load(std::memory_order_acquire);
+	}
+
+	// ֮ǰĬԴnullptrʱָnew_delete_resource()
+	inline memory_resource* set_default_resource(memory_resource* r) noexcept {
+		return default_resource_holder().exchange(r ? r : new_delete_resource(), std::memory_order_acq_rel);
+	}
+
+	/*
+	 * Դmonotonic_arenaһֻŲָ룬deallocateʲô
+	 * Ըһʼ(ջϵ)֮upstream¿顣
+	 * releaseѴupstreamĿȫȥ֮´ӳʼʼ䡣
+	 */
+	class monotonic_buffer_resource : public memory_resource {
+	public:
+		explicit monotonic_buffer_resource(memory_resource* upstream = get_default_resource()) noexcept
+			: monotonic_buffer_resource(nullptr, 0, upstream) {}
+
+		explicit monotonic_buffer_resource(size_t initialSize, memory_resource* upstream = get_default_resource()) noexcept
+			: monotonic_buffer_resource(nullptr, 0, upstream) {
+			initNext = initialSize < (size_t)MINBlockBytes ? (size_t)MINBlockBytes : initialSize;
+			nextBytes = initNext;
+		}
+
+		monotonic_buffer_resource(void* buffer, size_t bytes, memory_resource* upstream = get_default_resource()) noexcept
+			: cur((char*)buffer), end((char*)buffer + bytes), initBuffer((char*)buffer), initBytes(bytes),
+			blocks(nullptr), upstream(upstream),
+			initNext(2 * bytes < (size_t)MINBlockBytes ? (size_t)MINBlockBytes : 2 * bytes), nextBytes(initNext) {}
+
+		~monotonic_buffer_resource() override { release(); }
+
+		monotonic_buffer_resource(const monotonic_buffer_resource&) = delete;
+		monotonic_buffer_resource& operator=(const monotonic_buffer_resource&) = delete;
+
+		// жһϣupstreamĿ鶼ȥ
+		void release() noexcept {
+			while (blocks) {
+				Block* next = blocks->next;
+				upstream->deallocate(blocks, blocks->size, alignof(std::max_align_t));
+				blocks = next;
+			}
+			cur = initBuffer;
+			end = initBuffer + initBytes;
+			nextBytes = initNext;
+		}
+
+		memory_resource* upstream_resource() const noexcept { return upstream; }
+
+	protected:
+		void* do_allocate(size_t bytes, size_t align) override {
+			size_t pad = (align - ((uintptr_t)cur & (align - 1))) & (align - 1);
+			if (cur && pad + bytes <= (size_t)(end - cur)) {
+				char* p = cur + pad;
+				cur = p + bytes;
+				return p;
+			}
+			return allocateSlow(bytes, align);
+		}
+
+		void do_deallocate(void*, size_t, size_t) override {}
+
+	private:
+		enum {
+			MINBlockBytes = 1024,
+			MAXBlockBytes = 64 * 1024 * 1024,
+		};
+
+		struct Block {
+			Block* next;
+			size_t size; // Blockͷ
+		};
+
+		void* allocateSlow(size_t bytes, size_t align) {
+			size_t need = bytes + align + sizeof(Block);
+			size_t size = nextBytes < need ? need : nextBytes;
+			Block* block = (Block*)upstream->allocate(size, alignof(std::max_align_t));
+			block->next = blocks;
+			block->size = size;
+			blocks = block;
+			cur = (char*)(block + 1);
+			end = (char*)block + size;
+			if (nextBytes < (size_t)MAXBlockBytes)
+				nextBytes *= 2;
+			return do_allocate(bytes, align);
+		}
+
+		char* cur;
+		char* end;
+		char* initBuffer;  // ʼΪ
+		size_t initBytes;
+		Block* blocks;     // upstreamĿ飬µǰ
+		memory_resource* upstream;
+		size_t initNext;   // release֮һĴС
+		size_t nextBytes;  // һĿС
+	};
+
+	struct pool_options {
+		size_t max_blocks_per_chunk = 0;        // һupstreamĿгɶٸ0ʾĬֵ
+		size_t largest_required_pool_block = 0; // Сӳз䣬0ʾMAXBytes
+	};
+
+	/*
+	 * DefaultAllocTemplateĵִСĳأÿԴԼһڴ
+	 * upstreamchunk롣ÿһһֻгMINBlockschunk֮󷭱
+	 * ֱmax_blocks_per_chunkchunkMAXAlign룬гĶDefaultAllocTemplate
+	 * һڵСλ룬ҴСalignĵ
+	 * largest_required_pool_blockMAXAlignֱӽupstreamǰһ
+	 * ͷreleaseʱchunkһ𻹻ȥ
+	 * threadsΪtrueʱsynchronized_pool_resourceвһ
+	 */
+	template <bool threads>
+	class PoolResourceTemplate : public memory_resource {
+		using classes = DefaultAllocTemplate<threads, 0>;
+
+	public:
+		PoolResourceTemplate() : PoolResourceTemplate(pool_options(), get_default_resource()) {}
+
+		explicit PoolResourceTemplate(memory_resource* upstream) : PoolResourceTemplate(pool_options(), upstream) {}
+
+		explicit PoolResourceTemplate(const pool_options& opts) : PoolResourceTemplate(opts, get_default_resource()) {}
+
+		PoolResourceTemplate(const pool_options& opts, memory_resource* upstream);
+
+		~PoolResourceTemplate() override { release(); }
+
+		PoolResourceTemplate(const PoolResourceTemplate&) = delete;
+		PoolResourceTemplate& operator=(const PoolResourceTemplate&) = delete;
+
+		// chunkʹ鶼upstreamʹ滹ûͷŵĶ
+		void release();
+
+		memory_resource* upstream_resource() const noexcept { return upstream; }
+		pool_options options() const noexcept { return opts; }
+
+	protected:
+		void* do_allocate(size_t bytes, size_t align) override;
+		void do_deallocate(void* p, size_t bytes, size_t align) override;
+
+	private:
+		enum {
+			MINBlocks = 8,
+			MAXBlocks = 1024,
+			CHUNKHead = MAXAlign, // chunkͷռõֽڣ֤֮гĶMAXAlign
+		};
+
+		struct Chunk {
+			Chunk* next;
+			size_t size; // ͷ
+		};
+
+		struct Large {  // ͷڶǰ
+			Large* prev;
+			Large* next;
+			size_t bytes;
+			size_t align;
+		};
+
+		struct Pool {
+			FreeList* freeList;
+			char* cur;          // ǰchunkлûзֵĲ
+			char* end;
+			size_t nextBlocks;  // һchunkгɶٸ
+		};
+
+		// ʹһӳзʱ-1
+		int getPoolIdx(size_t bytes, size_t align) const {
+			if (align > (size_t)MAXAlign)
+				return -1;
+			if (align < (size_t)ALIGN)
+				align = (size_t)ALIGN;
+			bytes = ((bytes ? bytes : 1) + align - 1) & ~(align - 1);
+			if (bytes > opts.largest_required_pool_block)
+				return -1;
+			size_t idx = classes::getFreeListIdx(bytes);
+			while (idx < poolCount && (classes::getClassSize(idx) & (align - 1)))
+				++idx;
+			return idx < poolCount ? (int)idx : -1;
+		}
+
+		// ǰͷСŵLargealignı
+		static size_t getLargeHead(size_t align) {
+			return (sizeof(Large) + align - 1) & ~(align - 1);
+		}
+
+		static size_t getLargeAlign(size_t align) {
+			return align > alignof(std::max_align_t) ? align : alignof(std::max_align_t);
+		}
+
+		void* newChunk(Pool& pool, size_t size);
+
+		pool_options opts;
+		memory_resource* upstream;
+		size_t poolCount;
+		Pool pools[FREELISTS];
+		Chunk* chunks;
+		Large* large;
+		std::mutex mutex;
+	};
+
+	template <bool threads>
+	PoolResourceTemplate<threads>::PoolResourceTemplate(const pool_options& options, memory_resource* upstream)
+		: opts(options), upstream(upstream), chunks(nullptr), large(nullptr) {
+		if (!opts.max_blocks_per_chunk || opts.max_blocks_per_chunk > (size_t)MAXBlocks)
+			opts.max_blocks_per_chunk = (size_t)MAXBlocks;
+		if (opts.max_blocks_per_chunk < (size_t)MINBlocks)
+			opts.max_blocks_per_chunk = (size_t)MINBlocks;
+		if (!opts.largest_required_pool_block || opts.largest_required_pool_block > (size_t)MAXBytes)
+			opts.largest_required_pool_block = (size_t)MAXBytes;
+		/* ȡڵĴСһܴӳз */
+		poolCount = classes::getFreeListIdx(opts.largest_required_pool_block) + 1;
+		opts.largest_required_pool_block = classes::getClassSize(poolCount - 1);
+		for (Pool& pool : pools)
+			pool = { nullptr, nullptr, nullptr, (size_t)MINBlocks };
+	}
+
+	template <bool threads>
+	void PoolResourceTemplate<threads>::release() {
+		std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+		if (threads)
+			lock.lock();
+		while (chunks) {
+			Chunk* next = chunks->next;
+			upstream->deallocate(chunks, chunks->size, (size_t)MAXAlign);
+			chunks = next;
+		}
+		while (large) {
+			Large* next = large->next;
+			size_t head = getLargeHead(large->align);
+			upstream->deallocate((char*)(large + 1) - head, head + large->bytes, getLargeAlign(large->align));
+			large = next;
+		}
+		for (Pool& pool : pools)
+			pool = { nullptr, nullptr, nullptr, (size_t)MINBlocks };
+	}
+
+	template <bool threads>
+	void* PoolResourceTemplate<threads>::newChunk(Pool& pool, size_t size) {
+		size_t blocks = pool.nextBlocks;
+		size_t bytes = (size_t)CHUNKHead + blocks * size;
+		Chunk* chunk = (Chunk*)upstream->allocate(bytes, (size_t)MAXAlign);
+		chunk->next = chunks;
+		chunk->size = bytes;
+		chunks = chunk;
+		/* һchunkͷchunkĵһֱӷ */
+		char* p = (char*)chunk + CHUNKHead;
+		pool.cur = p + size;
+		pool.end = (char*)chunk + bytes;
+		if (blocks < opts.max_blocks_per_chunk)
+			pool.nextBlocks = 2 * blocks < opts.max_blocks_per_chunk ? 2 * blocks : opts.max_blocks_per_chunk;
+		return p;
+	}
+
+	template <bool threads>
+	void* PoolResourceTemplate<threads>::do_allocate(size_t bytes, size_t align) {
+		int idx = getPoolIdx(bytes, align);
+		std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+		if (threads)
+			lock.lock();
+		if (idx >= 0) {
+			Pool& pool = pools[idx];
+			if (FreeList* p = pool.freeList) {
+				pool.freeList = p->next;
+				return p;
+			}
+			size_t size = classes::getClassSize((size_t)idx);
+			if ((size_t)(pool.end - pool.cur) >= size) {
+				char* p = pool.cur;
+				pool.cur += size;
+				return p;
+			}
+			return newChunk(pool, size);
+		}
+		/* 飺[][Large][]align */
+		size_t head = getLargeHead(align);
+		char* raw = (char*)upstream->allocate(head + bytes, getLargeAlign(align));
+		Large* node = (Large*)(raw + head) - 1;
+		node->bytes = bytes;
+		node->align = align;
+		node->prev = nullptr;
+		node->next = large;
+		if (large)
+			large->prev = node;
+		large = node;
+		return raw + head;
+	}
+
+	template <bool threads>
+	void PoolResourceTemplate<threads>::do_deallocate(void* p, size_t bytes, size_t align) {
+		int idx = getPoolIdx(bytes, align);
+		std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+		if (threads)
+			lock.lock();
+		if (idx >= 0) {
+			FreeList* obj = (FreeList*)p;
+			obj->next = pools[idx].freeList;
+			pools[idx].freeList = obj;
+			return;
+		}
+		Large* node = (Large*)p - 1;
+		(node->prev ? node->prev->next : large) = node->next;
+		if (node->next)
+			node->next->prev = node->prev;
+		if (threads)
+			lock.unlock();
+		size_t head = getLargeHead(align);
+		upstream->deallocate((char*)p - head, head + bytes, getLargeAlign(align));
+	}
+
+	using unsynchronized_pool_resource = PoolResourceTemplate<false>;
+	using synchronized_pool_resource = PoolResourceTemplate<true>;
+
+	/*
+	 * ʱԼҲʹ÷(allocator_typeallocת)Ͱalloc
+	 * Ϊȥܽ(allocator_arg, alloc, args...)ʱǰ棬
+	 * Ƕ׵ʹͬһԴصǹtuple
+	 */
+	template <typename T, typename Alloc, typename... Args>
+	std::tuple<Args&&...> uses_allocator_args(std::integral_constant<int, 0>, const Alloc&, Args&&... args) {
+		return std::forward_as_tuple(std::forward<Args>(args)...);
+	}
+
+	template <typename T, typename Alloc, typename... Args>
+	std::tuple<std::allocator_arg_t, const Alloc&, Args&&...>
+		uses_allocator_args(std::integral_constant<int, 1>, const Alloc& alloc, Args&&... args) {
+		return std::tuple<std::allocator_arg_t, const Alloc&, Args&&...>(
+			std::allocator_arg, alloc, std::forward<Args>(args)...);
+	}
+
+	template <typename T, typename Alloc, typename... Args>
+	std::tuple<Args&&..., const Alloc&> uses_allocator_args(std::integral_constant<int, 2>, const Alloc& alloc, Args&&... args) {
+		return std::tuple<Args&&..., const Alloc&>(std::forward<Args>(args)..., alloc);
+	}
+
+	template <typename T, typename Alloc, typename... Args>
+	using uses_allocator_kind = std::integral_constant<int, !std::uses_allocator<T, Alloc>::value ? 0
+		: std::is_constructible<T, std::allocator_arg_t, const Alloc&, Args...>::value ? 1 : 2>;
+
+	/*
+	 * һmemory_resourceָķ׼ķҪstdֱʹã
+	 * ҲṩrebindtinySTLķʽʹáʱ(ʹĬ
+	 * Դ)ֻйԪʱͨconstructǶ׵
+	 * ȵԴȣʱһڴһͷš
+	 */
+	template <typename T>
+	class polymorphic_allocator {
+	public:
+		using value_type       = T;
+		using pointer          = T*;
+		using const_pointer    = const T*;
+		using reference        = T&;
+		using const_reference  = const T&;
+		using size_type        = size_t;
+		using difference_type  = ptrdiff_t;
+
+		template <typename U>
+		struct rebind
+		{
+			using other = polymorphic_allocator<U>;
+		};
+
+	public:
+		polymorphic_allocator() noexcept : res(get_default_resource()) {}
+		polymorphic_allocator(memory_resource* r) noexcept : res(r) {}
+		polymorphic_allocator(const polymorphic_allocator&) = default;
+
+		template <typename U>
+		polymorphic_allocator(const polymorphic_allocator<U>& other) noexcept : res(other.resource()) {}
+
+		// 󶨵Դ;ı
+		polymorphic_allocator& operator=(const polymorphic_allocator&) = delete;
+
+		pointer allocate(size_type n) {
+			if (n > (size_t)-1 / sizeof(T))
+				throw std::bad_alloc();
+			T* ptr = static_cast<T*>(res->allocate(sizeof(T) * n, alignof(T)));
+			heap_profiler::recordAllocate(ptr, sizeof(T) * n);
+			return ptr;
+		}
+
+		void deallocate(pointer ptr, size_type n) {
+			if (!ptr) return;
+			heap_profiler::recordDeallocate(ptr);
+			res->deallocate(ptr, sizeof(T) * n, alignof(T));
+		}
+
+		template <typename U, typename... Args>
+		void construct(U* p, Args&&... args) {
+			::new((void*)p) U(std::make_from_tuple<U>(uses_allocator_args<U>(
+				uses_allocator_kind<U, polymorphic_allocator, Args...>(), *this, std::forward<Args>(args)...)));
+		}
+
+		// pairԱֱǷҪstd::mapĽ
+		template <typename A, typename B, typename... X, typename... Y>
+		void construct(std::pair<A, B>* p, std::piecewise_construct_t, std::tuple<X...> x, std::tuple<Y...> y) {
+			::new((void*)p) std::pair<A, B>(std::piecewise_construct,
+				std::apply([this](auto&&... xs) {
+					return uses_allocator_args<A>(uses_allocator_kind<A, polymorphic_allocator, X...>(),
+						*this, std::forward<decltype(xs)>(xs)...);
+				}, std::move(x)),
+				std::apply([this](auto&&... ys) {
+					return uses_allocator_args<B>(uses_allocator_kind<B, polymorphic_allocator, Y...>(),
+						*this, std::forward<decltype(ys)>(ys)...);
+				}, std::move(y)));
+		}
+
+		template <typename A, typename B>
+		void construct(std::pair<A, B>* p) {
+			construct(p, std::piecewise_construct, std::tuple<>(), std::tuple<>());
+		}
+
+		template <typename A, typename B, typename U, typename V>
+		void construct(std::pair<A, B>* p, U&& u, V&& v) {
+			construct(p, std::piecewise_construct, std::forward_as_tuple(std::forward<U>(u)),
+				std::forward_as_tuple(std::forward<V>(v)));
+		}
+
+		template <typename A, typename B, typename U, typename V>
+		void construct(std::pair<A, B>* p, const std::pair<U, V>& other) {
+			construct(p, std::piecewise_construct, std::forward_as_tuple(other.first),
+				std::forward_as_tuple(other.second));
+		}
+
+		template <typename A, typename B, typename U, typename V>
+		void construct(std::pair<A, B>* p, std::pair<U, V>& other) {
+			construct(p, static_cast<const std::pair<U, V>&>(other));
+		}
+
+		template <typename A, typename B, typename U, typename V>
+		void construct(std::pair<A, B>* p, std::pair<U, V>&& other) {
+			construct(p, std::piecewise_construct, std::forward_as_tuple(std::forward<U>(other.first)),
+				std::forward_as_tuple(std::forward<V>(other.second)));
+		}
+
+		template <typename U>
+		void destroy(U* p) { p->~U(); }
+
+		polymorphic_allocator select_on_container_copy_construction() const { return polymorphic_allocator(); }
+
+		memory_resource* resource() const noexcept { return res; }
+
+	private:
+		memory_resource* res;
+	};
+
+	template <typename T, typename U>
+	bool operator==(const polymorphic_allocator<T>& a, const polymorphic_allocator<U>& b) noexcept {
+		return *a.resource() == *b.resource();
+	}
+
+	template <typename T, typename U>
+	bool operator!=(const polymorphic_allocator<T>& a, const polymorphic_allocator<U>& b) noexcept {
+		return !(a == b);
+	}
+
+	/*
+	 * tinySTL̬ͨAllocӿڷ䣬òԺarena_allocһ
+	 * ֲͨ߳̾"ǰԴ"룺scopeڼallocator<T, resource_alloc>ķ䶼
+	 * ָԴǶ׵ȻҲʹͬһԴκscopeʱʹĬԴ
+	 * ͷҲǰԴԶҪڷscope֮ǰͷš
+	 */
+	template <int inst>
+	class ResourceAllocTemplate {
+	public:
+		static void* allocate(size_t n) { return get_resource()->allocate(n, (size_t)ALIGN); }
+		static void* allocate(size_t n, size_t align) { return get_resource()->allocate(n, align); }
+		static void deallocate(void* p, size_t n) { get_resource()->deallocate(p, n, (size_t)ALIGN); }
+		static void deallocate(void* p, size_t n, size_t align) { get_resource()->deallocate(p, n, align); }
+
+		// ԴСҵͷŵλãıСͲٰԭĴСͷţֻдСʱɹ
+		static bool tryExpand(void* /* p */, size_t oldSize, size_t newSize) { return newSize == oldSize; }
+
+		static void* reallocate(void* p, size_t oldSize, size_t newSize) {
+			if (newSize == oldSize)
+				return p;
+			void* q = allocate(newSize);
+			std::memcpy(q, p, oldSize < newSize ? oldSize : newSize);
+			deallocate(p, oldSize);
+			return q;
+		}
+
+		static memory_resource* get_resource() { return current ? current : get_default_resource(); }
+
+		class scope {
+		public:
+			explicit scope(memory_resource& resource) noexcept : prev(current) {
+				current = &resource;
+			}
+
+			~scope() { current = prev; }
+
+			scope(const scope&) = delete;
+			scope& operator=(const scope&) = delete;
+
+		private:
+			memory_resource* prev;
+		};
+
+	private:
+		static thread_local memory_resource* current;
+	};
+
+	template <int inst>
+	thread_local memory_resource* ResourceAllocTemplate<inst>::current = nullptr;
+
+	using resource_alloc = ResourceAllocTemplate<0>;
+	using resource_scope = resource_alloc::scope;
+}
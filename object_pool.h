@@ -0,0 +1,299 @@
+#pragma once
+
+#include <new>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#include "allocator.h"
+
+namespace tinySTL {
+
+	/*
+	 * ̶͵Ķءÿǰһָ룬Ͷһһslotе
+	 * slotָ봮ѾõĶҲܹ϶ƻݡ
+	 * ResetΪvoidʱrelease󣬶ǵReset()(obj)ָɸչ
+	 * ״̬󻺴һβacquireֱȡʡһ/졣ʺϹ
+	 * ۸ߵĶԼлĶresetʱֻݶ
+	 * ÿ߳ԼĻ棬DefaultAllocTemplateһһδȡһ
+	 * 泬ʱȥ
+	 * slotSMALLBytesʱAllocĿȡslotҲAllocȡ
+	 * ηֵ˷25%԰slotʵʴСԼslabз֡
+	 */
+	template <typename T, typename Reset = void, typename Alloc = alloc, int inst = 0>
+	class ObjectPoolTemplate {
+	public:
+		// лѹʱacquireֱȡڿslotϹ
+		template <typename... Args>
+		static T* acquire(Args&&... args);
+		static void release(T* p);
+		// Ԥ׼nŵϣѹʱҲǰ
+		static void reserve(size_t n);
+		// ̺߳ϻĶ󣬴AllocȡĿslotȥػȥ
+		// ֽԼslab黹̻߳еĶӰ
+		static size_t trim();
+
+	private:
+		enum {
+			BATCH = 32,
+		};
+
+		static constexpr bool keepConstructed = !std::is_void<Reset>::value;
+		static constexpr size_t slotAlign = alignof(T) > alignof(FreeList) ? alignof(T) : alignof(FreeList);
+		static constexpr size_t objectOffset = (sizeof(FreeList) + alignof(T) - 1) & ~(alignof(T) - 1);
+		static constexpr size_t slotSize = (objectOffset + sizeof(T) + slotAlign - 1) & ~(slotAlign - 1);
+		static constexpr bool ownSlabs = slotSize > (size_t)SMALLBytes;
+
+		struct LocalCache {
+			FreeList* raw;       // ûйslot
+			size_t rawCount;
+			FreeList* built;     // Ѿ졢resetĶ
+			size_t builtCount;
+
+			~LocalCache() {
+				flush(this);
+				cacheDead = true;
+			}
+		};
+
+		static thread_local LocalCache cache;
+		static thread_local bool cacheDead;  // ̻߳Ѿֱ֮ʹ
+		static AtomicFreeList centralRaw;
+		static AtomicFreeList centralBuilt;
+		struct Slab {
+			Slab* next;
+		};
+
+		static std::mutex slabMutex;
+		static Slab* slabList;   // еslabֻ
+		static char* slabFree;
+		static char* slabEnd;
+
+		static T* getObject(FreeList* slot) { return (T*)((char*)slot + objectOffset); }
+		static FreeList* getSlot(T* p) { return (FreeList*)((char*)p - objectOffset); }
+
+		static LocalCache* getCache() { return cacheDead ? nullptr : &cache; }
+
+		static void resetObject(T& obj, std::true_type) { Reset()(obj); }
+		static void resetObject(T&, std::false_type) {}
+
+		static FreeList* pop(LocalCache* c, bool built);
+		static void push(LocalCache* c, FreeList* slot, bool built);
+		static void flush(LocalCache* c);
+
+		// ȡcountslotŵoutУʵȡĸ
+		static size_t newSlots(FreeList** out, size_t count);
+		static void newSmallSlots(FreeList** out, size_t count, std::true_type) {
+			Alloc::allocateBatch(slotSize, count, (void**)out);
+		}
+		static void newSmallSlots(FreeList** out, size_t count, std::false_type) {
+			for (size_t i = 0; i < count; ++i)
+				out[i] = (FreeList*)Alloc::allocate(slotSize, slotAlign);
+		}
+		static void freeSlot(FreeList* slot);
+	};
+
+	template <typename T, typename Reset, typename Alloc, int inst>
+	thread_local typename ObjectPoolTemplate<T, Reset, Alloc, inst>::LocalCache
+		ObjectPoolTemplate<T, Reset, Alloc, inst>::cache = { nullptr, 0, nullptr, 0 };
+
+	template <typename T, typename Reset, typename Alloc, int inst>
+	thread_local bool ObjectPoolTemplate<T, Reset, Alloc, inst>::cacheDead = false;
+
+	template <typename T, typename Reset, typename Alloc, int inst>
+	AtomicFreeList ObjectPoolTemplate<T, Reset, Alloc, inst>::centralRaw;
+
+	template <typename T, typename Reset, typename Alloc, int inst>
+	AtomicFreeList ObjectPoolTemplate<T, Reset, Alloc, inst>::centralBuilt;
+
+	template <typename T, typename Reset, typename Alloc, int inst>
+	std::mutex ObjectPoolTemplate<T, Reset, Alloc, inst>::slabMutex;
+
+	template <typename T, typename Reset, typename Alloc, int inst>
+	typename ObjectPoolTemplate<T, Reset, Alloc, inst>::Slab*
+		ObjectPoolTemplate<T, Reset, Alloc, inst>::slabList = nullptr;
+
+	template <typename T, typename Reset, typename Alloc, int inst>
+	char* ObjectPoolTemplate<T, Reset, Alloc, inst>::slabFree = nullptr;
+
+	template <typename T, typename Reset, typename Alloc, int inst>
+	char* ObjectPoolTemplate<T, Reset, Alloc, inst>::slabEnd = nullptr;
+
+	template <typename T, typename Reset, typename Alloc, int inst>
+	template <typename... Args>
+	T* ObjectPoolTemplate<T, Reset, Alloc, inst>::acquire(Args&&... args) {
+		LocalCache* c = getCache();
+		if (keepConstructed && sizeof...(Args) == 0) {
+			if (FreeList* slot = pop(c, true))
+				return getObject(slot);
+		}
+		FreeList* slot = pop(c, false);
+		if (!slot) {
+			/* ȡһµslotڻ */
+			FreeList* slots[BATCH];
+			size_t got = newSlots(slots, c ? (size_t)BATCH : 1);
+			for (size_t i = 1; i < got; ++i)
+				push(c, slots[i], false);
+			slot = slots[0];
+		}
+		T* p = getObject(slot);
+		try {
+			::new((void*)p) T(std::forward<Args>(args)...);
+		}
+		catch (...) {
+			push(c, slot, false);
+			throw;
+		}
+		return p;
+	}
+
+	template <typename T, typename Reset, typename Alloc, int inst>
+	void ObjectPoolTemplate<T, Reset, Alloc, inst>::release(T* p) {
+		if (!p)
+			return;
+		if (keepConstructed) {
+			resetObject(*p, std::integral_constant<bool, keepConstructed>());
+		}
+		else {
+			p->~T();
+		}
+		push(getCache(), getSlot(p), keepConstructed);
+	}
+
+	template <typename T, typename Reset, typename Alloc, int inst>
+	void ObjectPoolTemplate<T, Reset, Alloc, inst>::reserve(size_t n) {
+		while (n) {
+			FreeList* slots[BATCH];
+			size_t got = newSlots(slots, n < (size_t)BATCH ? n : (size_t)BATCH);
+			for (size_t i = 0; i < got; ++i) {
+				if (keepConstructed) {
+					try {
+						::new((void*)getObject(slots[i])) T();
+					}
+					catch (...) {
+						for (; i < got; ++i)
+							centralRaw.push(slots[i], slots[i]);
+						throw;
+					}
+				}
+				(keepConstructed ? centralBuilt : centralRaw).push(slots[i], slots[i]);
+			}
+			n -= got;
+		}
+	}
+
+	template <typename T, typename Reset, typename Alloc, int inst>
+	size_t ObjectPoolTemplate<T, Reset, Alloc, inst>::trim() {
+		flush(getCache());
+		/* Ķؿslot */
+		for (FreeList* slot = centralBuilt.popAll(), *next; slot; slot = next) {
+			next = slot->next;
+			getObject(slot)->~T();
+			centralRaw.push(slot, slot);
+		}
+		if (ownSlabs)
+			return 0;
+		size_t released = 0;
+		for (FreeList* slot = centralRaw.popAll(), *next; slot; slot = next) {
+			next = slot->next;
+			freeSlot(slot);
+			released += slotSize;
+		}
+		return released;
+	}
+
+	template <typename T, typename Reset, typename Alloc, int inst>
+	FreeList* ObjectPoolTemplate<T, Reset, Alloc, inst>::pop(LocalCache* c, bool built) {
+		AtomicFreeList& central = built ? centralBuilt : centralRaw;
+		if (!c)
+			return central.pop();
+		FreeList*& head = built ? c->built : c->raw;
+		size_t& count = built ? c->builtCount : c->rawCount;
+		if (!head) {
+			FreeList* tail;
+			count = central.popBatch(head, tail, (size_t)BATCH);
+			if (!count)
+				return nullptr;
+		}
+		FreeList* slot = head;
+		head = slot->next;
+		--count;
+		return slot;
+	}
+
+	template <typename T, typename Reset, typename Alloc, int inst>
+	void ObjectPoolTemplate<T, Reset, Alloc, inst>::push(LocalCache* c, FreeList* slot, bool built) {
+		AtomicFreeList& central = built ? centralBuilt : centralRaw;
+		if (!c) {
+			central.push(slot, slot);
+			return;
+		}
+		FreeList*& head = built ? c->built : c->raw;
+		size_t& count = built ? c->builtCount : c->rawCount;
+		slot->next = head;
+		head = slot;
+		if (++count <= 2 * (size_t)BATCH)
+			return;
+		/* ̻߳ͷһ */
+		FreeList* tail = slot;
+		for (int i = 1; i < BATCH; ++i)
+			tail = tail->next;
+		head = tail->next;
+		count -= BATCH;
+		central.push(slot, tail);
+	}
+
+	template <typename T, typename Reset, typename Alloc, int inst>
+	void ObjectPoolTemplate<T, Reset, Alloc, inst>::flush(LocalCache* c) {
+		if (!c)
+			return;
+		for (int built = 0; built < 2; ++built) {
+			FreeList*& head = built ? c->built : c->raw;
+			if (!head)
+				continue;
+			FreeList* tail = head;
+			while (tail->next)
+				tail = tail->next;
+			(built ? centralBuilt : centralRaw).push(head, tail);
+			head = nullptr;
+			(built ? c->builtCount : c->rawCount) = 0;
+		}
+	}
+
+	template <typename T, typename Reset, typename Alloc, int inst>
+	size_t ObjectPoolTemplate<T, Reset, Alloc, inst>::newSlots(FreeList** out, size_t count) {
+		if (!ownSlabs) {
+			newSmallSlots(out, count, std::integral_constant<bool,
+				slotAlign <= (size_t)ALIGN && has_batch_allocate<Alloc>::value>());
+			return count;
+		}
+		std::lock_guard<std::mutex> guard(slabMutex);
+		if ((size_t)(slabEnd - slabFree) < slotSize) {
+			/* ǰslabˣʣ²һslotͷֱӶslabͷ */
+			size_t header = (sizeof(Slab) + slotAlign - 1) & ~(slotAlign - 1);
+			size_t bytes = (size_t)SLABBytes > header + 8 * slotSize ? (size_t)SLABBytes : header + 8 * slotSize;
+			Slab* slab = (Slab*)Alloc::allocate(bytes, slotAlign);
+			slab->next = slabList;
+			slabList = slab;
+			slabFree = (char*)slab + header;
+			slabEnd = (char*)slab + bytes;
+		}
+		size_t got = 0;
+		for (; got < count && (size_t)(slabEnd - slabFree) >= slotSize; ++got) {
+			out[got] = (FreeList*)slabFree;
+			slabFree += slotSize;
+		}
+		return got;
+	}
+
+	template <typename T, typename Reset, typename Alloc, int inst>
+	void ObjectPoolTemplate<T, Reset, Alloc, inst>::freeSlot(FreeList* slot) {
+		if (slotAlign <= (size_t)ALIGN)
+			Alloc::deallocate(slot, slotSize);
+		else
+			Alloc::deallocate(slot, slotSize, slotAlign);
+	}
+
+	template <typename T, typename Reset = void>
+	using object_pool = ObjectPoolTemplate<T, Reset>;
+}
@@ -0,0 +1,592 @@
+#pragma once
+
+#include <new>
+#include <cassert>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+#include "alloc.h"
+
+/*
+ * ͨshm_allocͷšչڵǰӳĿ÷(scope֮)Ĭڵ
+ * 汾жԣ汾к飬ԭӳļ֮ǰԻɱĴ
+ */
+#ifndef TINYSTL_SHM_FOREIGN_BLOCK
+#define TINYSTL_SHM_FOREIGN_BLOCK(p) assert(!"tinySTL: block does not belong to the current mapped arena")
+#endif
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+namespace tinySTL {
+
+	/*
+	 * ָ룺ĲǵַĿoffset_ptrԼƫơͬһιڴ
+	 * ͬлӳ䵽ͬĵַӳڲλ֮ľ벻䣬Էӳ
+	 * Сָӳoffset_ptrÿﶼЧƫ1ʾָ룬boostһ
+	 * ָԼһֽڵָûʾ
+	 * ʱҪµλ¼ƫƣֽڸơṩpointer_traits͵
+	 * ҪͣΪpointerstd::vectorstd::basic_stringЩ
+	 * allocator_traits::pointerָlibstdc++basic_stringкüֱӰ
+	 * pointerchar*أoffset_ptrʽתT*Ϊ˲õָ
+	 * 壬Ӽ±ͶǾȷƥģ塣
+	 */
+	template <typename T>
+	class offset_ptr {
+	public:
+		using element_type      = T;
+		using value_type        = typename std::remove_cv<T>::type;
+		using difference_type   = ptrdiff_t;
+		using pointer           = offset_ptr;
+		using reference         = typename std::add_lvalue_reference<T>::type;
+		using iterator_category = std::random_access_iterator_tag;
+
+		template <typename U>
+		using rebind = offset_ptr<U>;
+
+		offset_ptr() noexcept : off(NULLOffset) {}
+		offset_ptr(std::nullptr_t) noexcept : off(NULLOffset) {}
+		offset_ptr(T* p) noexcept { set(p); }
+		offset_ptr(const offset_ptr& other) noexcept { set(other.get()); }
+
+		template <typename U, typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+		offset_ptr(const offset_ptr<U>& other) noexcept { set(other.get()); }
+
+		// ֻstatic_castתҪʽдallocator_traitsvoid_pointerõpointer
+		template <typename U, typename = typename std::enable_if<!std::is_convertible<U*, T*>::value>::type,
+			typename = decltype(static_cast<T*>((U*)nullptr))>
+		explicit offset_ptr(const offset_ptr<U>& other) noexcept { set(static_cast<T*>(other.get())); }
+
+		offset_ptr& operator=(const offset_ptr& other) noexcept {
+			set(other.get());
+			return *this;
+		}
+
+		offset_ptr& operator=(T* p) noexcept {
+			set(p);
+			return *this;
+		}
+
+		T* get() const noexcept {
+			return off == NULLOffset ? nullptr : reinterpret_cast<T*>(reinterpret_cast<intptr_t>(this) + off);
+		}
+
+		reference operator*() const noexcept { return *get(); }
+		T* operator->() const noexcept { return get(); }
+		operator T*() const noexcept { return get(); }
+
+		template <typename I, typename = typename std::enable_if<std::is_integral<I>::value>::type>
+		reference operator[](I n) const noexcept { return get()[n]; }
+
+		template <typename U = T>
+		static offset_ptr pointer_to(typename std::enable_if<!std::is_void<U>::value, U>::type& r) noexcept {
+			return offset_ptr(std::addressof(r));
+		}
+
+		offset_ptr& operator+=(difference_type n) noexcept {
+			set(get() + n);
+			return *this;
+		}
+
+		offset_ptr& operator-=(difference_type n) noexcept {
+			set(get() - n);
+			return *this;
+		}
+
+		offset_ptr& operator++() noexcept { return *this += 1; }
+		offset_ptr& operator--() noexcept { return *this -= 1; }
+
+		offset_ptr operator++(int) noexcept {
+			offset_ptr old(*this);
+			*this += 1;
+			return old;
+		}
+
+		offset_ptr operator--(int) noexcept {
+			offset_ptr old(*this);
+			*this -= 1;
+			return old;
+		}
+
+		template <typename I, typename = typename std::enable_if<std::is_integral<I>::value>::type>
+		friend offset_ptr operator+(const offset_ptr& p, I n) noexcept { return offset_ptr(p.get() + n); }
+		template <typename I, typename = typename std::enable_if<std::is_integral<I>::value>::type>
+		friend offset_ptr operator+(I n, const offset_ptr& p) noexcept { return offset_ptr(p.get() + n); }
+		template <typename I, typename = typename std::enable_if<std::is_integral<I>::value>::type>
+		friend offset_ptr operator-(const offset_ptr& p, I n) noexcept { return offset_ptr(p.get() - n); }
+
+	private:
+		enum : intptr_t {
+			NULLOffset = 1,
+		};
+
+		void set(T* p) noexcept {
+			off = p ? reinterpret_cast<intptr_t>(p) - reinterpret_cast<intptr_t>(this) : (intptr_t)NULLOffset;
+		}
+
+		intptr_t off;
+	};
+
+	template <typename T, typename U>
+	ptrdiff_t operator-(const offset_ptr<T>& a, const offset_ptr<U>& b) noexcept { return a.get() - b.get(); }
+
+	template <typename T, typename U>
+	bool operator==(const offset_ptr<T>& a, const offset_ptr<U>& b) noexcept { return a.get() == b.get(); }
+
+	template <typename T, typename U>
+	bool operator!=(const offset_ptr<T>& a, const offset_ptr<U>& b) noexcept { return a.get() != b.get(); }
+
+	template <typename T, typename U>
+	bool operator<(const offset_ptr<T>& a, const offset_ptr<U>& b) noexcept { return a.get() < b.get(); }
+
+	template <typename T, typename U>
+	bool operator<=(const offset_ptr<T>& a, const offset_ptr<U>& b) noexcept { return a.get() <= b.get(); }
+
+	template <typename T, typename U>
+	bool operator>(const offset_ptr<T>& a, const offset_ptr<U>& b) noexcept { return a.get() > b.get(); }
+
+	template <typename T, typename U>
+	bool operator>=(const offset_ptr<T>& a, const offset_ptr<U>& b) noexcept { return a.get() >= b.get(); }
+
+	template <typename T>
+	bool operator==(const offset_ptr<T>& p, std::nullptr_t) noexcept { return !p.get(); }
+
+	template <typename T>
+	bool operator==(std::nullptr_t, const offset_ptr<T>& p) noexcept { return !p.get(); }
+
+	template <typename T>
+	bool operator!=(const offset_ptr<T>& p, std::nullptr_t) noexcept { return p.get() != nullptr; }
+
+	template <typename T>
+	bool operator!=(std::nullptr_t, const offset_ptr<T>& p) noexcept { return p.get() != nullptr; }
+
+	// ӳͷĸʽָıʱһͬ汾Ľ̲ụ򿪶Էӳ
+	enum {
+		SHMVersion = 1,
+	};
+
+	/*
+	 * һӳõڴаDefaultAllocTemplateĵеĹ(ͷÿһ
+	 * Ŀзλ)ڴֻƫƣǵַӳ䵽κεַ
+	 * κν̴򿪶ܼʹá
+	 * ÿһĿǴ汾ŵջAtomicFreeListһջͰ汾Ŵһ
+	 * 64λCASֻջͽеnextӳƫơstd::atomic
+	 * ַڹڴжҲͬʱʹá˾ʹӳβ
+	 * һгһMAXBytesĶҳз֣ͷźֻͬҳã
+	 * ̣ܶͷеһĽ쳣˳ʱ̻һֱȥ
+	 */
+	class mapped_arena_base {
+	public:
+		mapped_arena_base(const mapped_arena_base&) = delete;
+		mapped_arena_base& operator=(const mapped_arena_base&) = delete;
+
+		// alignPAGEBytesӳʱ׳std::bad_alloc
+		void* allocate(size_t n, size_t align = (size_t)ALIGN) {
+			size_t idx = getClass(n, align);
+			if (idx == (size_t)FREELISTS)
+				return base() + allocateLarge(n, align);
+			uint64_t off = pop(idx);
+			if (!off)
+				off = reFill(idx);
+			return base() + off;
+		}
+
+		void deallocate(void* p, size_t n, size_t align = (size_t)ALIGN) noexcept {
+			if (!p)
+				return;
+			uint64_t off = (uint64_t)((char*)p - base());
+			size_t idx = getClass(n, align);
+			if (idx == (size_t)FREELISTS)
+				deallocateLarge(off, n);
+			else
+				push(idx, off, off);
+		}
+
+		// СoldSizenewSize֮ͬһ(ͬҳ)ʱƶ
+		bool expand(void* p, size_t oldSize, size_t newSize) const noexcept {
+			size_t idx = getClass(oldSize, (size_t)ALIGN);
+			if (!p || idx != getClass(newSize, (size_t)ALIGN))
+				return false;
+			return idx != (size_t)FREELISTS || getPages(oldSize) == getPages(newSize);
+		}
+
+		// ݽṹڣһ֮̽Ǽ̴ӳҵ
+		void* getRoot() const noexcept {
+			uint64_t off = header->root.load(std::memory_order_acquire);
+			return off ? base() + off : nullptr;
+		}
+
+		void setRoot(void* p) noexcept {
+			header->root.store(p ? (uint64_t)((char*)p - base()) : 0, std::memory_order_release);
+		}
+
+		bool isOpen() const noexcept { return header != nullptr; }
+		char* base() const noexcept { return (char*)header; }
+		size_t size() const noexcept { return mappedBytes; }
+		bool contains(const void* p) const noexcept {
+			return header && (const char*)p >= base() && (const char*)p < base() + mappedBytes;
+		}
+		// ӳβûзֹֽڣеĶ
+		size_t available() const noexcept {
+			return mappedBytes - (size_t)header->top.load(std::memory_order_relaxed);
+		}
+
+	protected:
+		mapped_arena_base() noexcept : header(nullptr), mappedBytes(0) {}
+		~mapped_arena_base() = default;
+
+		// ƫֻOFFBits+OFFShiftλӳٴ
+		static constexpr uint64_t MAXMapBytes = (uint64_t)1 << 43;
+
+		// ڸӳbytesֽȫ0ڴϽͷ
+		void format(void* p, size_t bytes) noexcept {
+			header = ::new(p) Header();
+			mappedBytes = bytes;
+			header->version = (uint32_t)SHMVersion;
+			header->headerBytes = (uint32_t)sizeof(Header);
+			header->bytes = bytes;
+			header->top.store((sizeof(Header) + (size_t)MAXAlign - 1) & ~((size_t)MAXAlign - 1),
+				std::memory_order_relaxed);
+			/* magicд룬̿ʱͷֶѾʼ */
+			header->magic.store(MAGIC, std::memory_order_release);
+		}
+
+		// ˽ͷʽʶߴСԲʱfalse
+		bool attach(void* p, size_t bytes) noexcept {
+			Header* h = (Header*)p;
+			if (bytes < sizeof(Header) || h->magic.load(std::memory_order_acquire) != MAGIC
+				|| h->version != (uint32_t)SHMVersion || h->headerBytes != (uint32_t)sizeof(Header)
+				|| h->bytes != bytes)
+				return false;
+			header = h;
+			mappedBytes = bytes;
+			return true;
+		}
+
+		void detach() noexcept {
+			header = nullptr;
+			mappedBytes = 0;
+		}
+
+	private:
+		static constexpr uint64_t MAGIC = 0x6172656e614d5374ull; // "tSManera"
+
+		static_assert(std::atomic<uint64_t>::is_always_lock_free,
+			"the free lists live in shared memory and need lock-free 64-bit atomics");
+
+		struct Header {
+			std::atomic<uint64_t> magic;
+			uint32_t version;
+			uint32_t headerBytes;
+			uint64_t bytes;                           // ӳĴС
+			std::atomic<uint64_t> top;                // βûзֵĲִ￪ʼ
+			std::atomic<uint64_t> root;
+			std::atomic<uint32_t> largeLock;
+			uint64_t largeList;                       // еĴ飬largeLock
+			std::atomic<uint64_t> freeList[FREELISTS];
+		};
+
+		struct LargeBlock {
+			uint64_t next;
+			uint64_t pages;
+		};
+
+		// ƫ8ֽڶ룬3λռOFFBitsλʣµλ汾
+		enum : uint64_t {
+			OFFShift = 3,
+			OFFBits = 40,
+			OFFMask = ((uint64_t)1 << OFFBits) - 1,
+		};
+
+		static uint64_t pack(uint64_t off, uint64_t tag) noexcept { return (off >> OFFShift) | (tag << OFFBits); }
+		static uint64_t getOff(uint64_t v) noexcept { return (v & OFFMask) << OFFShift; }
+		static uint64_t getTag(uint64_t v) noexcept { return v >> OFFBits; }
+
+		// ǰ8ֽڱһƫƣ0ʾ(ƫ0ͷָ)
+		uint64_t& next(uint64_t off) const noexcept { return *(uint64_t*)(base() + off); }
+
+		// nֽڡalignһFREELISTSʾҳ
+		static size_t getClass(size_t n, size_t align) noexcept {
+			using classes = single_client_alloc;
+			if (align <= (size_t)ALIGN)
+				return n <= (size_t)MAXBytes ? classes::getFreeListIdx(n ? n : 1) : (size_t)FREELISTS;
+			size_t size = align <= (size_t)MAXAlign ? classes::getAlignedSize(n, align) : 0;
+			return size ? classes::getFreeListIdx(size) : (size_t)FREELISTS;
+		}
+
+		static uint64_t getPages(size_t n) noexcept { return ((n ? n : 1) + (size_t)PAGEBytes - 1) / (size_t)PAGEBytes; }
+
+		void push(size_t idx, uint64_t head, uint64_t tail) noexcept {
+			std::atomic<uint64_t>& top = header->freeList[idx];
+			uint64_t old = top.load(std::memory_order_relaxed);
+			do {
+				next(tail) = getOff(old);
+			} while (!top.compare_exchange_weak(old, pack(head, getTag(old) + 1),
+				std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		uint64_t pop(size_t idx) noexcept {
+			std::atomic<uint64_t>& top = header->freeList[idx];
+			uint64_t old = top.load(std::memory_order_acquire);
+			while (uint64_t off = getOff(old)) {
+				/* ѱĽ̵дnextû壬汾ѱ䣬CASȻʧ */
+				uint64_t nextOff = next(off);
+				if (top.compare_exchange_weak(old, pack(nextOff, getTag(old) + 1),
+					std::memory_order_acquire, std::memory_order_acquire))
+					return off;
+			}
+			return 0;
+		}
+
+		// βгbytesֽڣʱ0
+		uint64_t bump(size_t bytes, size_t align) noexcept {
+			uint64_t old = header->top.load(std::memory_order_relaxed);
+			uint64_t start;
+			do {
+				start = (old + align - 1) & ~(uint64_t)(align - 1);
+				if (start + bytes > header->bytes)
+					return 0;
+			} while (!header->top.compare_exchange_weak(old, start + bytes, std::memory_order_relaxed));
+			return start;
+		}
+
+		// idxˣгһһأѹ
+		uint64_t reFill(size_t idx) {
+			size_t size = single_client_alloc::getClassSize(idx);
+			size_t align = single_client_alloc::getClassAlign(size);
+			size_t objs = (size_t)SPANBytes / size;
+			objs = objs < 1 ? 1 : objs > (size_t)TCACHEBatch ? (size_t)TCACHEBatch : objs;
+			uint64_t start = bump(objs * size, align);
+			if (!start) { // βһʱֻҪһ
+				objs = 1;
+				start = bump(size, align);
+				if (!start)
+					throw std::bad_alloc();
+			}
+			if (objs > 1) {
+				for (size_t i = 1; i + 1 < objs; ++i)
+					next(start + i * size) = start + (i + 1) * size;
+				push(idx, start + size, start + (objs - 1) * size);
+			}
+			return start;
+		}
+
+		void lockLarge() noexcept {
+			while (header->largeLock.exchange(1, std::memory_order_acquire))
+				std::this_thread::yield();
+		}
+
+		void unlockLarge() noexcept { header->largeLock.store(0, std::memory_order_release); }
+
+		uint64_t allocateLarge(size_t n, size_t align) {
+			if (align > (size_t)PAGEBytes)
+				throw std::bad_alloc();
+			uint64_t pages = getPages(n);
+			lockLarge();
+			for (uint64_t* link = &header->largeList; *link; link = &((LargeBlock*)(base() + *link))->next) {
+				LargeBlock* block = (LargeBlock*)(base() + *link);
+				if (block->pages == pages) {
+					uint64_t off = *link;
+					*link = block->next;
+					unlockLarge();
+					return off;
+				}
+			}
+			unlockLarge();
+			uint64_t off = bump(pages * (size_t)PAGEBytes, (size_t)PAGEBytes);
+			if (!off)
+				throw std::bad_alloc();
+			return off;
+		}
+
+		void deallocateLarge(uint64_t off, size_t n) noexcept {
+			LargeBlock* block = (LargeBlock*)(base() + off);
+			block->pages = getPages(n);
+			lockLarge();
+			block->next = header->largeList;
+			header->largeList = off;
+			unlockLarge();
+		}
+
+		Header* header;
+		size_t mappedBytes;
+	};
+
+	/*
+	 * POSIXڴ(shm_open + mmap)ϵmapped_arenaһcreateͬһ
+	 * openÿopenӳ䵽һµĵַӳеĶֻ֮offset_ptr
+	 * ָʱֻӳ䣬ڴһֱڵremoveΪֹWindowscreate/openʧ
+	 */
+	class shm_arena : public mapped_arena_base {
+	public:
+		shm_arena() noexcept = default;
+		~shm_arena() { close(); }
+
+		// ½Ϊname('/'ͷ)СΪbytesĹڴ棬ͬѾʱfalse
+		bool create(const char* name, size_t bytes) {
+			close();
+#if defined(_WIN32)
+			(void)name;
+			(void)bytes;
+			return false;
+#else
+			bytes = SystemPages::roundUp(bytes);
+			if (bytes < (size_t)PAGEBytes || (uint64_t)bytes > MAXMapBytes)
+				return false;
+			int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+			if (fd < 0)
+				return false;
+			void* p = ftruncate(fd, (off_t)bytes) == 0 ? mapShared(fd, bytes) : nullptr;
+			::close(fd);
+			if (!p) {
+				shm_unlink(name);
+				return false;
+			}
+			format(p, bytes); // ftruncateڴȫ0
+			return true;
+#endif
+		}
+
+		// 򿪱ĽcreateõĹڴ
+		bool open(const char* name) {
+			close();
+#if defined(_WIN32)
+			(void)name;
+			return false;
+#else
+			int fd = shm_open(name, O_RDWR, 0);
+			if (fd < 0)
+				return false;
+			struct stat st;
+			void* p = fstat(fd, &st) == 0 && st.st_size > 0 ? mapShared(fd, (size_t)st.st_size) : nullptr;
+			::close(fd);
+			if (!p)
+				return false;
+			if (!attach(p, (size_t)st.st_size)) {
+				munmap(p, (size_t)st.st_size);
+				return false;
+			}
+			return true;
+#endif
+		}
+
+		// ӳ䣬̺͹ڴ汾Ӱ
+		void close() noexcept {
+#if !defined(_WIN32)
+			if (isOpen())
+				munmap(base(), size());
+#endif
+			detach();
+		}
+
+		// ɾڴ֣ѾӳĽ̿Լʹãһӳڴͷ
+		static bool remove(const char* name) noexcept {
+#if defined(_WIN32)
+			(void)name;
+			return false;
+#else
+			return shm_unlink(name) == 0;
+#endif
+		}
+
+	private:
+#if !defined(_WIN32)
+		static void* mapShared(int fd, size_t bytes) noexcept {
+			void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			return p == MAP_FAILED ? nullptr : p;
+		}
+#endif
+	};
+
+	/*
+	 * arena_allocһֲͨ߳̾"ǰӳ"tinySTL::allocatorpointer<T>
+	 * allocator<T, shm_alloc>pointerΪoffset_ptr<T>std::vectorstd::basic_string
+	 * ŽӳճдֻҪǸҲscopeдͬһӳ
+	 */
+	template <int inst>
+	class ShmAllocTemplate {
+	public:
+		template <typename T>
+		using pointer = offset_ptr<T>;
+
+		static void* allocate(size_t n) { return getArena().allocate(n); }
+		static void* allocate(size_t n, size_t align) { return getArena().allocate(n, align); }
+
+		// ߵԲ쳣ڵǰӳĿ鰴TINYSTL_SHM_FOREIGN_BLOCK
+		static void deallocate(void* p, size_t n) noexcept {
+			if (isOwned(p))
+				current->deallocate(p, n);
+		}
+
+		static void deallocate(void* p, size_t n, size_t align) noexcept {
+			if (isOwned(p))
+				current->deallocate(p, n, align);
+		}
+
+		static bool tryExpand(void* p, size_t oldSize, size_t newSize) noexcept {
+			return isOwned(p) && current->expand(p, oldSize, newSize);
+		}
+
+		// ӳĿƵǰӳԭĿ鲻ͷ
+		static void* reallocate(void* p, size_t oldSize, size_t newSize) {
+			if (!p)
+				return allocate(newSize);
+			bool owned = isOwned(p);
+			if (owned && current->expand(p, oldSize, newSize))
+				return p;
+			void* q = allocate(newSize);
+			std::memcpy(q, p, oldSize < newSize ? oldSize : newSize);
+			if (owned)
+				current->deallocate(p, oldSize);
+			return q;
+		}
+
+		static mapped_arena_base* get_arena() { return current; }
+
+		class scope {
+		public:
+			explicit scope(mapped_arena_base& arena) noexcept : prev(current) { current = &arena; }
+			~scope() { current = prev; }
+
+			scope(const scope&) = delete;
+			scope& operator=(const scope&) = delete;
+
+		private:
+			mapped_arena_base* prev;
+		};
+
+	private:
+		static mapped_arena_base& getArena() {
+			if (!current) // κscopeʱûпõӳ
+				throw std::bad_alloc();
+			return *current;
+		}
+
+		// pڵǰӳ[base(), base() + size())֮ʱtruescope֮
+		// һӳscopeʱ鲻ܹҵ˵Ŀ
+		static bool isOwned(void* p) noexcept {
+			if (!p)
+				return false;
+			if (current && current->contains(p))
+				return true;
+			TINYSTL_SHM_FOREIGN_BLOCK(p);
+			return false;
+		}
+
+		static thread_local mapped_arena_base* current;
+	};
+
+	template <int inst>
+	thread_local mapped_arena_base* ShmAllocTemplate<inst>::current = nullptr;
+
+	using shm_alloc = ShmAllocTemplate<0>;
+	using shm_scope = shm_alloc::scope;
+}
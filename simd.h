@@ -0,0 +1,408 @@
+#pragma once
+
+// simd.h㷨ʹõں(ͱȽ)ʱCPUֵָ֧(SSE2/AVX2/AVX-512)ѡһ
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TINYSTL_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+// ûд-mavx2ȱѡʱGCCClangҪtargetԵΪһָ
+// MSVCֱʹеintrinsic
+#if defined(TINYSTL_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TINYSTL_TARGET(isa) __attribute__((target(isa)))
+#else
+#define TINYSTL_TARGET(isa)
+#endif
+
+namespace tinySTL {
+
+	// õָԽԽ
+	enum {
+		SIMDScalar = 0,
+		SIMDSSE2 = 1,
+		SIMDAVX2 = 2,
+		SIMDAVX512 = 3,
+	};
+
+	struct Simd {
+		// ʱһΣֱ֮ӷؽ
+		static int getLevel() {
+			int level = levelCap().load(std::memory_order_relaxed);
+			int cpu = getCpuLevel();
+			return level < cpu ? level : cpu;
+		}
+
+		// ʹõlevelΪֹԺbenchmarkȽϸָ
+		static void setLevel(int level) { levelCap().store(level, std::memory_order_relaxed); }
+
+		// Ŀ곬ôֽʱnon-temporal storeƹֱдڴ棬ĬһĴС
+		// ôд֮ͷĲѱ棬һʼͲռû
+		static size_t getNonTemporalThreshold() { return ntThreshold().load(std::memory_order_relaxed); }
+		static void setNonTemporalThreshold(size_t bytes) { ntThreshold().store(bytes, std::memory_order_relaxed); }
+
+		/*
+		 * valueָwidthֽ(2481632)ظnдdstһаvalue
+		 * ظܴĸֽڿʼȡһǰǸλõλźõһֵ
+		 * һдڿͷм䲿ְȶд룬һ
+		 * дڽβм䲿ֵصдͬ
+		 */
+		static void fill(void* dst, size_t n, const void* value, size_t width) {
+			size_t bytes = n * width;
+			unsigned char* p = (unsigned char*)dst;
+			if (bytes < 16 || getLevel() == SIMDScalar) {
+				for (size_t i = 0; i < n; ++i)
+					std::memcpy(p + i * width, value, width);
+				return;
+			}
+			alignas(64) unsigned char pattern[PATTERNBytes];
+			switch (width) {
+			case 2: makePattern<2>(pattern, value); break;
+			case 4: makePattern<4>(pattern, value); break;
+			case 8: makePattern<8>(pattern, value); break;
+			case 16: makePattern<16>(pattern, value); break;
+			default: makePattern<32>(pattern, value); break;
+			}
+			bool nt = bytes > getNonTemporalThreshold();
+#if defined(TINYSTL_SIMD_X86)
+			switch (getLevel()) {
+			case SIMDAVX512:
+				if (bytes >= 64) {
+					fillAvx512(p, bytes, pattern, width, nt);
+					return;
+				}
+				/* fallthrough */
+			case SIMDAVX2:
+				if (bytes >= 32) {
+					fillAvx2(p, bytes, pattern, width, nt);
+					return;
+				}
+				/* fallthrough */
+			default:
+				fillSse2(p, bytes, pattern, width, nt);
+				return;
+			}
+#else
+			(void)nt;
+			for (size_t i = 0; i < n; ++i)
+				std::memcpy(p + i * width, value, width);
+#endif
+		}
+
+		/*
+		 * ԪرȽabʼnwidthֽڵԪأصһȵԪص±꣬ȫʱ
+		 * nֽڱȽҵһֽͬڣڵԪ֮ǰԪضȫͬ
+		 * ÿαȽһmovemaskѱȽϽѹһȫΪ1ʱβ1λã
+		 * һĽβٱȽһκǰصһ
+		 */
+		static size_t mismatch(const void* a, const void* b, size_t n, size_t width) {
+			size_t bytes = n * width;
+			const unsigned char* p = (const unsigned char*)a;
+			const unsigned char* q = (const unsigned char*)b;
+			size_t at;
+#if defined(TINYSTL_SIMD_X86)
+			int level = getLevel();
+			if (bytes < 16 || level == SIMDScalar)
+				at = mismatchScalar(p, q, bytes);
+			else if (level >= SIMDAVX512 && bytes >= 64)
+				at = mismatchAvx512(p, q, bytes);
+			else if (level >= SIMDAVX2 && bytes >= 32)
+				at = mismatchAvx2(p, q, bytes);
+			else
+				at = mismatchSse2(p, q, bytes);
+#else
+			at = mismatchScalar(p, q, bytes);
+#endif
+			return at / width;
+		}
+
+	private:
+		enum {
+			PATTERNBytes = 128, // ӵ31ֽڿʼȡһ64ֽڵ
+		};
+
+		// ǳʱЩСmemcpyϲɼд룬̵Ҫ
+		template <size_t W>
+		static void makePattern(unsigned char* pattern, const void* value) {
+			for (size_t i = 0; i < (size_t)PATTERNBytes; i += W)
+				std::memcpy(pattern + i, value, W);
+		}
+
+		static std::atomic<int>& levelCap() {
+			static std::atomic<int> cap{ SIMDAVX512 };
+			return cap;
+		}
+
+		static std::atomic<size_t>& ntThreshold() {
+			static std::atomic<size_t> bytes{ getLastLevelCache() };
+			return bytes;
+		}
+
+		static int getCpuLevel() {
+			static const int level = detectLevel();
+			return level;
+		}
+
+		static int detectLevel() {
+#if defined(TINYSTL_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx512f"))
+				return SIMDAVX512;
+			if (__builtin_cpu_supports("avx2"))
+				return SIMDAVX2;
+			return __builtin_cpu_supports("sse2") ? SIMDSSE2 : SIMDScalar;
+#elif defined(TINYSTL_SIMD_X86) && defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			int maxLeaf = info[0];
+			__cpuid(info, 1);
+			bool sse2 = (info[3] >> 26) & 1;
+			bool osxsave = (info[2] >> 27) & 1;
+			if (!osxsave || maxLeaf < 7)
+				return sse2 ? SIMDSSE2 : SIMDScalar;
+			/* ϵͳлʱҪYMM(12λ)ZMM(57λ)Ĵ */
+			unsigned long long xcr0 = _xgetbv(0);
+			__cpuidex(info, 7, 0);
+			if ((xcr0 & 0xe6) == 0xe6 && ((info[1] >> 16) & 1))
+				return SIMDAVX512;
+			if ((xcr0 & 0x6) == 0x6 && ((info[1] >> 5) & 1))
+				return SIMDAVX2;
+			return sse2 ? SIMDSSE2 : SIMDScalar;
+#else
+			return SIMDScalar;
+#endif
+		}
+
+		// صһֽͬڵƫƣȫͬʱbytes
+		static size_t mismatchScalar(const unsigned char* a, const unsigned char* b, size_t bytes) {
+			size_t i = 0;
+			for (; i + 8 <= bytes; i += 8) {
+				uint64_t x, y;
+				std::memcpy(&x, a + i, 8);
+				std::memcpy(&y, b + i, 8);
+				if (x != y)
+					break;
+			}
+			while (i < bytes && a[i] == b[i])
+				++i;
+			return i;
+		}
+
+		static size_t getLastLevelCache() {
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+			long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+			if (l3 > 0)
+				return (size_t)l3;
+			long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+			if (l2 > 0)
+				return (size_t)l2;
+#endif
+			return (size_t)8 * 1024 * 1024; // 鲻ʱ8MB
+		}
+
+#if defined(TINYSTL_SIMD_X86)
+		// pʼдpatternе㣬pdstƫƶwidthȡģ
+		static const unsigned char* getPhase(const unsigned char* pattern, size_t offset, size_t width) {
+			return pattern + (offset & (width - 1));
+		}
+
+		TINYSTL_TARGET("sse2")
+		static void fillSse2(unsigned char* dst, size_t bytes, const unsigned char* pattern, size_t width, bool nt) {
+			unsigned char* end = dst + bytes;
+			_mm_storeu_si128((__m128i*)dst, _mm_load_si128((const __m128i*)pattern));
+			unsigned char* p = (unsigned char*)(((uintptr_t)dst + 16) & ~(uintptr_t)15);
+			/* 32ֽڵֵһŲ£ڵд */
+			__m128i v0 = _mm_loadu_si128((const __m128i*)getPhase(pattern, (size_t)(p - dst), width));
+			__m128i v1 = _mm_loadu_si128((const __m128i*)getPhase(pattern, (size_t)(p - dst) + 16, width));
+			if (nt) {
+				for (; p + 64 <= end; p += 64) {
+					_mm_stream_si128((__m128i*)p, v0);
+					_mm_stream_si128((__m128i*)(p + 16), v1);
+					_mm_stream_si128((__m128i*)(p + 32), v0);
+					_mm_stream_si128((__m128i*)(p + 48), v1);
+				}
+				_mm_sfence();
+			}
+			for (; p + 32 <= end; p += 32) {
+				_mm_store_si128((__m128i*)p, v0);
+				_mm_store_si128((__m128i*)(p + 16), v1);
+			}
+			if (p + 16 <= end) {
+				_mm_store_si128((__m128i*)p, v0);
+				p += 16;
+			}
+			if (p != end) {
+				unsigned char* last = end - 16;
+				_mm_storeu_si128((__m128i*)last,
+					_mm_loadu_si128((const __m128i*)getPhase(pattern, (size_t)(last - dst), width)));
+			}
+		}
+
+		TINYSTL_TARGET("avx2")
+		static void fillAvx2(unsigned char* dst, size_t bytes, const unsigned char* pattern, size_t width, bool nt) {
+			unsigned char* end = dst + bytes;
+			_mm256_storeu_si256((__m256i*)dst, _mm256_load_si256((const __m256i*)pattern));
+			unsigned char* p = (unsigned char*)(((uintptr_t)dst + 32) & ~(uintptr_t)31);
+			__m256i v = _mm256_loadu_si256((const __m256i*)getPhase(pattern, (size_t)(p - dst), width));
+			if (nt) {
+				for (; p + 128 <= end; p += 128) {
+					_mm256_stream_si256((__m256i*)p, v);
+					_mm256_stream_si256((__m256i*)(p + 32), v);
+					_mm256_stream_si256((__m256i*)(p + 64), v);
+					_mm256_stream_si256((__m256i*)(p + 96), v);
+				}
+				_mm_sfence();
+			}
+			for (; p + 128 <= end; p += 128) {
+				_mm256_store_si256((__m256i*)p, v);
+				_mm256_store_si256((__m256i*)(p + 32), v);
+				_mm256_store_si256((__m256i*)(p + 64), v);
+				_mm256_store_si256((__m256i*)(p + 96), v);
+			}
+			for (; p + 32 <= end; p += 32)
+				_mm256_store_si256((__m256i*)p, v);
+			if (p != end) {
+				unsigned char* last = end - 32;
+				_mm256_storeu_si256((__m256i*)last,
+					_mm256_loadu_si256((const __m256i*)getPhase(pattern, (size_t)(last - dst), width)));
+			}
+			_mm256_zeroupper();
+		}
+
+		TINYSTL_TARGET("avx512f")
+		static void fillAvx512(unsigned char* dst, size_t bytes, const unsigned char* pattern, size_t width, bool nt) {
+			unsigned char* end = dst + bytes;
+			_mm512_storeu_si512((void*)dst, _mm512_load_si512((const void*)pattern));
+			unsigned char* p = (unsigned char*)(((uintptr_t)dst + 64) & ~(uintptr_t)63);
+			__m512i v = _mm512_loadu_si512((const void*)getPhase(pattern, (size_t)(p - dst), width));
+			if (nt) {
+				for (; p + 256 <= end; p += 256) {
+					_mm512_stream_si512((__m512i*)p, v);
+					_mm512_stream_si512((__m512i*)(p + 64), v);
+					_mm512_stream_si512((__m512i*)(p + 128), v);
+					_mm512_stream_si512((__m512i*)(p + 192), v);
+				}
+				_mm_sfence();
+			}
+			for (; p + 256 <= end; p += 256) {
+				_mm512_store_si512((void*)p, v);
+				_mm512_store_si512((void*)(p + 64), v);
+				_mm512_store_si512((void*)(p + 128), v);
+				_mm512_store_si512((void*)(p + 192), v);
+			}
+			for (; p + 64 <= end; p += 64)
+				_mm512_store_si512((void*)p, v);
+			if (p != end) {
+				unsigned char* last = end - 64;
+				_mm512_storeu_si512((void*)last,
+					_mm512_loadu_si512((const void*)getPhase(pattern, (size_t)(last - dst), width)));
+			}
+			_mm256_zeroupper();
+		}
+
+		static unsigned countTrailingZeros(uint32_t x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+			unsigned long i;
+			_BitScanForward(&i, x);
+			return (unsigned)i;
+#else
+			return (unsigned)__builtin_ctz(x);
+#endif
+		}
+
+		// bytesΪ16
+		TINYSTL_TARGET("sse2")
+		static size_t mismatchSse2(const unsigned char* a, const unsigned char* b, size_t bytes) {
+			size_t i = 0;
+			unsigned mask = 0xFFFF;
+			for (; i + 16 <= bytes; i += 16) {
+				mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(
+					_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i))));
+				if (mask != 0xFFFF)
+					break;
+			}
+			if (mask == 0xFFFF && i != bytes) {
+				i = bytes - 16;
+				mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(
+					_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i))));
+			}
+			return mask == 0xFFFF ? bytes : i + countTrailingZeros(~mask);
+		}
+
+		// bytesΪ32ÿαȽʱֻҪһκϲĽ
+		TINYSTL_TARGET("avx2")
+		static size_t mismatchAvx2(const unsigned char* a, const unsigned char* b, size_t bytes) {
+			size_t i = 0;
+			uint32_t mask = 0xFFFFFFFFu;
+			for (; i + 64 <= bytes; i += 64) {
+				__m256i e0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i)),
+					_mm256_loadu_si256((const __m256i*)(b + i)));
+				__m256i e1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i + 32)),
+					_mm256_loadu_si256((const __m256i*)(b + i + 32)));
+				if ((uint32_t)_mm256_movemask_epi8(_mm256_and_si256(e0, e1)) != 0xFFFFFFFFu) {
+					mask = (uint32_t)_mm256_movemask_epi8(e0);
+					if (mask == 0xFFFFFFFFu) {
+						i += 32;
+						mask = (uint32_t)_mm256_movemask_epi8(e1);
+					}
+					break;
+				}
+			}
+			for (; mask == 0xFFFFFFFFu && i + 32 <= bytes; i += 32) {
+				mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+					_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i))));
+				if (mask != 0xFFFFFFFFu)
+					break;
+			}
+			if (mask == 0xFFFFFFFFu && i != bytes) {
+				i = bytes - 32;
+				mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+					_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i))));
+			}
+			_mm256_zeroupper();
+			return mask == 0xFFFFFFFFu ? bytes : i + countTrailingZeros(~mask);
+		}
+
+		/*
+		 * bytesΪ64AVX-512FûаֽڱȽϵָ(ҪAVX-512BW)4ֽڱȽҵһ
+		 * ͬ4ֽڣٴߵһֽͬ
+		 */
+		TINYSTL_TARGET("avx512f")
+		static size_t mismatchAvx512(const unsigned char* a, const unsigned char* b, size_t bytes) {
+			size_t i = 0;
+			uint32_t mask = 0;
+			for (; i + 64 <= bytes; i += 64) {
+				mask = (uint32_t)_mm512_cmpneq_epi32_mask(_mm512_loadu_si512((const void*)(a + i)),
+					_mm512_loadu_si512((const void*)(b + i)));
+				if (mask)
+					break;
+			}
+			if (!mask && i != bytes) {
+				i = bytes - 64;
+				mask = (uint32_t)_mm512_cmpneq_epi32_mask(_mm512_loadu_si512((const void*)(a + i)),
+					_mm512_loadu_si512((const void*)(b + i)));
+			}
+			_mm256_zeroupper();
+			if (!mask)
+				return bytes;
+			i += 4 * (size_t)countTrailingZeros(mask);
+			uint32_t x, y;
+			std::memcpy(&x, a + i, 4);
+			std::memcpy(&y, b + i, 4);
+			return i + countTrailingZeros(x ^ y) / 8;
+		}
+#endif
+	};
+}
@@ -76,4 +76,28 @@ namespace tinySTL {
 	template<typename T, ::std::size_t N>
 	struct is_bounded_array<T[N]> : std::true_type {};
 
+	// is_trivially_relocatable
+	// ѶֽڸƵµַ֮ԭĶȲʹҲЧ"ƶ쵽µַ
+	// ԭ"ȫһǿƽضλģһĶֻҪһmemcpy
+	// ƽɸƵͶ㣻ҪʽػΪtrueָֻͳȵunique_ptr
+	// shared_ptrbasic_stringбָԼڲָ(ַŻ)
+	// 𴦼¼˶ַͲػ
+
+	template<typename T>
+	struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+	template<typename T>
+	struct is_trivially_relocatable<const T> : is_trivially_relocatable<T> {};
+
+	// is_bitwise_comparable
+	// ==ȽȵҽǵÿһֽڶͬȽһĶֱӰֽ
+	// Ƚϡöٺָ붼㣻(+0.0-0.0ȣNaNԼ)
+	// ûֽڡoperator==ȽгԱPODʽػΪtrue
+	template<typename T>
+	struct is_bitwise_comparable : std::integral_constant<bool,
+		std::is_integral<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value> {};
+
+	template<typename T>
+	struct is_bitwise_comparable<const T> : is_bitwise_comparable<T> {};
+
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstring>
+
 #include "algobase.h"
 #include "construct.h"
 #include "iterator.h"
@@ -44,7 +46,7 @@ namespace tinySTL {
 	// unubutialized_copy_n [first, first + n)ϵݸƵresultΪʼĿռ䣬ظƽλ
 
 	template<typename InputIter, typename Size, typename ForwardIter>
-	ForwardIter uninit_copy_n(InputIter first, Size n, ForwardIter result,
+	ForwardIter unchecked_uninit_copy_n(InputIter first, Size n, ForwardIter result,
 		std::true_type) {
 		return tinySTL::copy_n(first, n, result).second;
 	}
@@ -232,4 +234,69 @@ namespace tinySTL {
 			typename iterator_traits<InputIter>::
 			value_type>{});
 	}
+
+	// uninitialized_relocate [first, last)ϵĶᵽresultΪʼδʼռ䣬ذƽλá
+	// uninitialized_move֮ͬԭĶѾڣ߲ǡ
+	// ƽضλ(is_trivially_relocatable)ָֻһmemmove
+	// صƶԭ䲻صƶ׳쳣ʱѾ
+	// ¶ԭĶ󶼻
+
+	template<typename ForwardIter1, typename ForwardIter2>
+	ForwardIter2 unchecked_uninit_relocate(ForwardIter1 first, ForwardIter1 last, ForwardIter2 result,
+		std::false_type) {
+		auto cur = result;
+		try {
+			for (auto it = first; it != last; ++it, ++cur) {
+				tinySTL::construct(&*cur, tinySTL::move(*it));
+			}
+		}
+		catch (...) {
+			tinySTL::destroy(result, cur);
+			throw;
+		}
+		tinySTL::destroy(first, last);
+		return cur;
+	}
+
+	template<typename T>
+	T* unchecked_uninit_relocate(T* first, T* last, T* result, std::true_type) {
+		const size_t n = static_cast<size_t>(last - first);
+		if (n != 0)
+			std::memmove((void*)result, (const void*)first, n * sizeof(T));
+		return result + n;
+	}
+
+	template<typename ForwardIter1, typename ForwardIter2>
+	ForwardIter2 uninitialized_relocate(ForwardIter1 first, ForwardIter1 last, ForwardIter2 result) {
+		return tinySTL::unchecked_uninit_relocate(first, last, result, std::false_type{});
+	}
+
+	template<typename T>
+	T* uninitialized_relocate(T* first, T* last, T* result) {
+		return tinySTL::unchecked_uninit_relocate(first, last, result, is_trivially_relocatable<T>{});
+	}
+
+	// relocate_n [first, first + n)ϵĶᵽresultΪʼδʼռ䣬ذƽλ
+
+	template<typename ForwardIter1, typename Size, typename ForwardIter2>
+	ForwardIter2 relocate_n(ForwardIter1 first, Size n, ForwardIter2 result) {
+		auto cur = result;
+		auto it = first;
+		try {
+			for (Size i = 0; i < n; ++i, ++it, ++cur) {
+				tinySTL::construct(&*cur, tinySTL::move(*it));
+			}
+		}
+		catch (...) {
+			tinySTL::destroy(result, cur);
+			throw;
+		}
+		tinySTL::destroy(first, it);
+		return cur;
+	}
+
+	template<typename T, typename Size>
+	T* relocate_n(T* first, Size n, T* result) {
+		return tinySTL::uninitialized_relocate(first, first + n, result);
+	}
 }
\ No newline at end of file